@@ -55,7 +55,16 @@ common:
 linux64:
 	# binary libraries, these will be usually parsed from the file system but some 
 	# libraries need to passed to the linker in a specific order 
-	#nothing yet
+	# not shipped: build OpenFace 2.x and dlib and copy their static libraries here, see the README
+	ADDON_LIBS = libs_openFace/FaceAnalyser/lib/linux64/libFaceAnalyser.a
+	ADDON_LIBS += libs_openFace/GazeAnalyser/lib/linux64/libGazeAnalyser.a
+	ADDON_LIBS += libs_openFace/LandmarkDetector/lib/linux64/libLandmarkDetector.a
+	ADDON_LIBS += libs_openFace/Utilities/lib/linux64/libUtilities.a
+	ADDON_LIBS += libs_others/dlib/lib/linux64/libdlib.a
+
+	# the system's OpenCV, OpenBLAS and TBB, a TBB 2020 or older to match the headers in libs_others/tbb (oneTBB has no tbb::atomic)
+	ADDON_PKG_CONFIG_LIBRARIES = opencv4
+	ADDON_LDFLAGS = -lopenblas -ltbb
 	
 linux:
 	#nothing yet
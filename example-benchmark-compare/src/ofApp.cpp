@@ -0,0 +1,395 @@
+#include "ofApp.h"
+
+#define OFAPP_RANDOM_SEED 20190101
+
+ofApp::ofApp(const vector<string>& vArgsValue) : rng(OFAPP_RANDOM_SEED) {
+    vArgs = vArgsValue;
+}
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+    if (!parseArguments()) {
+        printUsage();
+        ofExit(1);
+        return;
+    }
+    ofJson baseline;
+    ofJson current;
+    if (!load(sBaseline, baseline) || !load(sCurrent, current)) {
+        ofExit(1);
+        return;
+    }
+    if (baseline.count("runs") && current.count("runs")) {
+        compareBenchmarks(baseline, current);
+    } else if (baseline.count("results") && current.count("results")) {
+        compareMicrobenchmarks(baseline, current);
+    } else {
+        ofLogError("ofApp", "'" + sBaseline + "' and '" + sCurrent + "' are not results of the same benchmark");
+        ofExit(1);
+        return;
+    }
+    saveReport();
+
+    int nRegressions = 0;
+    int nInconclusive = 0;
+    for (auto& c : vComparisons) {
+        nRegressions += c.bRegression ? 1 : 0;
+        nInconclusive += c.bInconclusive ? 1 : 0;
+    }
+    for (auto& a : vAccuracies) {
+        nRegressions += a.bFailed ? 1 : 0;
+    }
+    if (nInconclusive > 0) {
+        ofLogWarning("ofApp", ofToString(nInconclusive) + " inconclusive comparison(s), with fewer than " + ofToString(nMinSamples) + " samples a side");
+    }
+    if (nRegressions > 0 || !vMissing.empty() || (bOtherInput && !bAllowOtherInput)) {
+        ofLogError("ofApp", ofToString(nRegressions) + " regression(s), " + ofToString(vMissing.size()) + " missing from '" + sCurrent + "'"
+                   + (bOtherInput ? ", a different input" : ""));
+        ofExit(1);
+    } else if (bOtherInput) {
+        ofLogWarning("ofApp", "No regressions in the timings, the landmarks of a different input could not be compared: inconclusive");
+        ofExit(2);
+    } else {
+        ofLogNotice("ofApp", "No regressions");
+        ofExit(0);
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::update(){
+}
+
+//--------------------------------------------------------------
+bool ofApp::load(const string& sPath, ofJson& json) {
+    if (!ofFile::doesFileExist(sPath)) {
+        ofLogError("ofApp", "Could not find '" + sPath + "'");
+        return false;
+    }
+    json = ofLoadJson(sPath);
+    if (json.is_null()) {
+        ofLogError("ofApp", "Could not read '" + sPath + "'");
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::compareBenchmarks(const ofJson& baseline, const ofJson& current) {
+    auto getName = [](const ofJson& run) {
+        return run["detector"].get<string>() + " / " + run["landmarks"].get<string>() + ", " + ofToString(run["maxFaces"].get<int>()) + " faces";
+    };
+    // Older results have no per pass samples, their overall rate is a single one
+    auto getSamples = [](const ofJson& run) {
+        vector<double> vSamples;
+        if (run.count("passMsPerFrame")) {
+            vSamples = run["passMsPerFrame"].get<vector<double>>();
+        } else if (run["fps"].get<double>() > 0.0) {
+            vSamples.push_back(1000.0 / run["fps"].get<double>());
+        }
+        return vSamples;
+    };
+
+    bOtherInput = baseline.value("input", string()) != current.value("input", string());
+    if (bOtherInput) {
+        string sInputs = "'" + baseline.value("input", string()) + "' and '" + current.value("input", string()) + "'";
+        if (bAllowOtherInput) {
+            ofLogWarning("ofApp", "The runs replayed different inputs, " + sInputs + ", the landmarks are not compared");
+        } else {
+            ofLogError("ofApp", "The runs replayed different inputs, " + sInputs + ", use --allow-other-input to compare the timings alone");
+        }
+    }
+    for (auto& runBaseline : baseline["runs"]) {
+        string sName = getName(runBaseline);
+        const ofJson* pRunCurrent = nullptr;
+        for (auto& runCurrent : current["runs"]) {
+            if (getName(runCurrent) == sName) {
+                pRunCurrent = &runCurrent;
+                break;
+            }
+        }
+        if (pRunCurrent == nullptr) {
+            ofLogError("ofApp", "'" + sName + "' is not in '" + sCurrent + "'");
+            vMissing.push_back(sName);
+            continue;
+        }
+        vComparisons.push_back(compare(sName, getSamples(runBaseline), getSamples(*pRunCurrent)));
+        if (bOtherInput || !runBaseline.count("landmarkPoints")) {
+            continue;
+        }
+        if (!pRunCurrent->count("landmarkPoints")) {
+            ofLogError("ofApp", "'" + sName + "' has no landmarks in '" + sCurrent + "', run it with --save-landmarks");
+            vMissing.push_back(sName + " landmarks");
+            continue;
+        }
+        vAccuracies.push_back(compareLandmarks(sName, runBaseline["landmarkPoints"], (*pRunCurrent)["landmarkPoints"]));
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::compareMicrobenchmarks(const ofJson& baseline, const ofJson& current) {
+    auto getName = [](const ofJson& result) {
+        return result["kernel"].get<string>() + " [" + result["size"].get<string>() + "]";
+    };
+    auto getSamples = [](const ofJson& result) {
+        return result.count("samplesNsPerOp") ? result["samplesNsPerOp"].get<vector<double>>() : vector<double>(1, result["nsPerOp"].get<double>());
+    };
+
+    for (auto& resultBaseline : baseline["results"]) {
+        string sName = getName(resultBaseline);
+        const ofJson* pResultCurrent = nullptr;
+        for (auto& resultCurrent : current["results"]) {
+            if (getName(resultCurrent) == sName) {
+                pResultCurrent = &resultCurrent;
+                break;
+            }
+        }
+        if (pResultCurrent == nullptr) {
+            ofLogError("ofApp", "'" + sName + "' is not in '" + sCurrent + "'");
+            vMissing.push_back(sName);
+            continue;
+        }
+        vComparisons.push_back(compare(sName, getSamples(resultBaseline), getSamples(*pResultCurrent)));
+    }
+}
+
+//--------------------------------------------------------------
+ofApp::Comparison ofApp::compare(const string& sName, const vector<double>& vBaseline, const vector<double>& vCurrent) {
+    Comparison c;
+    c.sName = sName;
+    c.nSamplesBaseline = vBaseline.size();
+    c.nSamplesCurrent = vCurrent.size();
+    if (vBaseline.empty() || vCurrent.empty()) {
+        ofLogWarning("ofApp", "'" + sName + "' has no samples");
+        c.bInconclusive = true;
+        return c;
+    }
+    c.fBaseline = median(vBaseline);
+    c.fCurrent = median(vCurrent);
+    c.fRatio = c.fBaseline > 0.0 ? c.fCurrent / c.fBaseline : 1.0;
+
+    // Bootstrap: resample both sides with replacement, the spread of the ratios of the medians gives the interval
+    vector<double> vRatios;
+    vRatios.reserve(nResamples);
+    vector<double> vResampledBaseline(vBaseline.size());
+    vector<double> vResampledCurrent(vCurrent.size());
+    std::uniform_int_distribution<size_t> pickBaseline(0, vBaseline.size() - 1);
+    std::uniform_int_distribution<size_t> pickCurrent(0, vCurrent.size() - 1);
+    for (int i = 0; i < nResamples; i++) {
+        for (auto& f : vResampledBaseline) {
+            f = vBaseline[pickBaseline(rng)];
+        }
+        for (auto& f : vResampledCurrent) {
+            f = vCurrent[pickCurrent(rng)];
+        }
+        double fMedianBaseline = median(vResampledBaseline);
+        if (fMedianBaseline > 0.0) {
+            vRatios.push_back(median(vResampledCurrent) / fMedianBaseline);
+        }
+    }
+    if (!vRatios.empty()) {
+        std::sort(vRatios.begin(), vRatios.end());
+        double fTail = (1.0 - fConfidence) / 2.0;
+        c.fRatioLow = vRatios[(size_t)(fTail * (vRatios.size() - 1))];
+        c.fRatioHigh = vRatios[(size_t)((1.0 - fTail) * (vRatios.size() - 1))];
+    }
+
+    double fThreshold = fThresholdPercent / 100.0;
+    c.bInconclusive = MIN(c.nSamplesBaseline, c.nSamplesCurrent) < nMinSamples;
+    c.bRegression = !c.bInconclusive && c.fRatioLow > 1.0 + fThreshold;
+    c.bImprovement = !c.bInconclusive && c.fRatioHigh < 1.0 - fThreshold;
+    ofLogNotice("ofApp") << (c.bRegression ? "REGRESSION  " : c.bImprovement ? "improvement " : c.bInconclusive ? "inconclusive" : "            ") << sName << ": "
+        << ofToString(c.fBaseline, 3) << " -> " << ofToString(c.fCurrent, 3) << " (" << ofToString((c.fRatio - 1.0) * 100.0, 1) << "%, "
+        << ofToString(fConfidence * 100.0f, 0) << "% interval " << ofToString((c.fRatioLow - 1.0) * 100.0, 1) << "% to " << ofToString((c.fRatioHigh - 1.0) * 100.0, 1) << "%)";
+    return c;
+}
+
+//--------------------------------------------------------------
+ofApp::Accuracy ofApp::compareLandmarks(const string& sName, const ofJson& baseline, const ofJson& current) {
+    Accuracy a;
+    a.sName = sName;
+    a.nFrames = MIN(baseline.size(), current.size());
+    // The frames no longer line up, or some went unprocessed: the faces cannot be paired
+    a.bFramesDiffer = baseline.size() != current.size();
+    if (a.bFramesDiffer) {
+        ofLogError("ofApp", "'" + sName + "': " + ofToString(baseline.size()) + " frames of landmarks against " + ofToString(current.size()));
+    }
+
+    // The mean distance between the same landmarks of two faces, -1 when they have different models
+    auto getError = [](const vector<float>& vA, const vector<float>& vB) {
+        if (vA.size() != vB.size() || vA.empty()) {
+            return -1.0;
+        }
+        double fSum = 0.0;
+        for (size_t i = 0; i + 1 < vA.size(); i += 2) {
+            fSum += sqrt((vA[i] - vB[i]) * (vA[i] - vB[i]) + (vA[i + 1] - vB[i + 1]) * (vA[i + 1] - vB[i + 1]));
+        }
+        return fSum / (vA.size() / 2);
+    };
+
+    double fErrorSum = 0.0;
+    int nMatched = 0;
+    for (int f = 0; f < a.nFrames; f++) {
+        vector<vector<float>> vFacesBaseline = baseline[f].get<vector<vector<float>>>();
+        vector<vector<float>> vFacesCurrent = current[f].get<vector<vector<float>>>();
+        a.nFaces += vFacesBaseline.size();
+
+        // Greedy, closest pair first: few faces per frame, and the same face lies far closer than any other
+        vector<bool> vUsedCurrent(vFacesCurrent.size(), false);
+        vector<bool> vUsedBaseline(vFacesBaseline.size(), false);
+        while (true) {
+            int nBestBaseline = -1;
+            int nBestCurrent = -1;
+            double fBestError = 0.0;
+            for (size_t b = 0; b < vFacesBaseline.size(); b++) {
+                for (size_t c = 0; c < vFacesCurrent.size(); c++) {
+                    if (vUsedBaseline[b] || vUsedCurrent[c]) {
+                        continue;
+                    }
+                    double fError = getError(vFacesBaseline[b], vFacesCurrent[c]);
+                    if (fError >= 0.0 && (nBestBaseline < 0 || fError < fBestError)) {
+                        nBestBaseline = b;
+                        nBestCurrent = c;
+                        fBestError = fError;
+                    }
+                }
+            }
+            if (nBestBaseline < 0) {
+                break;
+            }
+            vUsedBaseline[nBestBaseline] = true;
+            vUsedCurrent[nBestCurrent] = true;
+            fErrorSum += fBestError;
+            a.fMaxErrorPx = MAX(a.fMaxErrorPx, fBestError);
+            nMatched++;
+        }
+        a.nMissing += std::count(vUsedBaseline.begin(), vUsedBaseline.end(), false);
+        a.nExtra += std::count(vUsedCurrent.begin(), vUsedCurrent.end(), false);
+    }
+    a.fMeanErrorPx = nMatched > 0 ? fErrorSum / nMatched : 0.0;
+
+    float fUnmatchedPercent = 100.0f * (a.nMissing + a.nExtra) / MAX(a.nFaces, 1);
+    a.bFailed = a.bFramesDiffer || a.fMeanErrorPx > fLandmarkTolerancePx || fUnmatchedPercent > fMaxMissingPercent;
+    ofLogNotice("ofApp") << (a.bFailed ? "INACCURATE  " : "            ") << sName << ": landmarks off by " << ofToString(a.fMeanErrorPx, 3)
+        << " px on average, " << ofToString(a.fMaxErrorPx, 3) << " px at most, " << a.nMissing << " faces lost and " << a.nExtra
+        << " new of " << a.nFaces << " in " << a.nFrames << " frames";
+    return a;
+}
+
+//--------------------------------------------------------------
+void ofApp::saveReport() {
+    ofJson json;
+    json["baseline"] = sBaseline;
+    json["current"] = sCurrent;
+    json["thresholdPercent"] = fThresholdPercent;
+    json["confidence"] = fConfidence;
+    json["resamples"] = nResamples;
+    json["landmarkTolerancePx"] = fLandmarkTolerancePx;
+    json["maxMissingPercent"] = fMaxMissingPercent;
+    json["minSamples"] = nMinSamples;
+    json["missing"] = vMissing;
+    json["otherInput"] = bOtherInput;
+    json["comparisons"] = ofJson::array();
+    for (auto& c : vComparisons) {
+        ofJson jsonComparison;
+        jsonComparison["name"] = c.sName;
+        jsonComparison["samplesBaseline"] = c.nSamplesBaseline;
+        jsonComparison["samplesCurrent"] = c.nSamplesCurrent;
+        jsonComparison["medianBaseline"] = c.fBaseline;
+        jsonComparison["medianCurrent"] = c.fCurrent;
+        jsonComparison["ratio"] = c.fRatio;
+        jsonComparison["ratioLow"] = c.fRatioLow;
+        jsonComparison["ratioHigh"] = c.fRatioHigh;
+        jsonComparison["regression"] = c.bRegression;
+        jsonComparison["improvement"] = c.bImprovement;
+        jsonComparison["inconclusive"] = c.bInconclusive;
+        json["comparisons"].push_back(jsonComparison);
+    }
+    json["landmarks"] = ofJson::array();
+    for (auto& a : vAccuracies) {
+        ofJson jsonAccuracy;
+        jsonAccuracy["name"] = a.sName;
+        jsonAccuracy["frames"] = a.nFrames;
+        jsonAccuracy["framesDiffer"] = a.bFramesDiffer;
+        jsonAccuracy["faces"] = a.nFaces;
+        jsonAccuracy["missing"] = a.nMissing;
+        jsonAccuracy["extra"] = a.nExtra;
+        jsonAccuracy["meanErrorPx"] = a.fMeanErrorPx;
+        jsonAccuracy["maxErrorPx"] = a.fMaxErrorPx;
+        jsonAccuracy["failed"] = a.bFailed;
+        json["landmarks"].push_back(jsonAccuracy);
+    }
+    ofSavePrettyJson(sReport + ".json", json);
+}
+
+//--------------------------------------------------------------
+double ofApp::median(vector<double> v) {
+    if (v.empty()) {
+        return 0.0;
+    }
+    size_t nMiddle = v.size() / 2;
+    std::nth_element(v.begin(), v.begin() + nMiddle, v.end());
+    double fMedian = v[nMiddle];
+    if (v.size() % 2 == 0) {
+        fMedian = (fMedian + *std::max_element(v.begin(), v.begin() + nMiddle)) / 2.0;
+    }
+    return fMedian;
+}
+
+//--------------------------------------------------------------
+bool ofApp::parseArguments() {
+    for (size_t i = 0; i < vArgs.size(); i++) {
+        const string& sArg = vArgs[i];
+        if (sArg == "--allow-other-input") {
+            bAllowOtherInput = true;
+        } else if (i + 1 >= vArgs.size()) {
+            ofLogError("ofApp", "Unknown argument or missing value: '" + sArg + "'");
+            return false;
+        } else if (sArg == "--baseline") {
+            sBaseline = vArgs[++i];
+        } else if (sArg == "--current") {
+            sCurrent = vArgs[++i];
+        } else if (sArg == "--report") {
+            sReport = vArgs[++i];
+        } else if (sArg == "--data") {
+            ofSetDataPathRoot(ofFilePath::getAbsolutePath(vArgs[++i], false));
+        } else if (sArg == "--threshold") {
+            fThresholdPercent = MAX(ofToFloat(vArgs[++i]), 0.0f);
+        } else if (sArg == "--confidence") {
+            fConfidence = ofClamp(ofToFloat(vArgs[++i]), 0.5f, 0.999f);
+        } else if (sArg == "--resamples") {
+            nResamples = MAX(ofToInt(vArgs[++i]), 100);
+        } else if (sArg == "--landmark-tolerance") {
+            fLandmarkTolerancePx = MAX(ofToFloat(vArgs[++i]), 0.0f);
+        } else if (sArg == "--max-missing") {
+            fMaxMissingPercent = MAX(ofToFloat(vArgs[++i]), 0.0f);
+        } else if (sArg == "--min-samples") {
+            nMinSamples = MAX(ofToInt(vArgs[++i]), 1);
+        } else {
+            ofLogError("ofApp", "Unknown argument: '" + sArg + "'");
+            return false;
+        }
+    }
+    if (sBaseline.empty() || sCurrent.empty()) {
+        ofLogError("ofApp", "A baseline and a current result are both needed.");
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::printUsage() {
+    ofLogNotice("ofApp") << "Usage: example-benchmark-compare --baseline <json> --current <json> [options]\n"
+        << "  results of example-benchmark or of example-microbenchmark, relative to the data folder\n"
+        << "  --report <name>             the comparison in <name>.json in the data folder (comparison)\n"
+        << "  --data <path>               the data folder\n"
+        << "  --threshold <percent>       slowdown allowed before it counts as a regression (5)\n"
+        << "  --confidence <level>        of the bootstrap interval (0.95)\n"
+        << "  --resamples <n>             bootstrap resamples (2000)\n"
+        << "  --landmark-tolerance <px>   mean landmark error allowed, with --save-landmarks results (1)\n"
+        << "  --max-missing <percent>     faces found in only one of the runs (1)\n"
+        << "  --min-samples <n>           samples a side below which a timing is inconclusive and not gated (5)\n"
+        << "  --allow-other-input         compare the timings of runs that replayed different inputs, the landmarks are skipped\n"
+        << "  Exits with 1 on any regression, when a baseline combination, kernel or its landmarks are missing from the current run,\n"
+        << "  when the landmarks cover a different number of frames, or when the runs replayed different inputs.\n"
+        << "  With --allow-other-input and different inputs, exits with 2 when the timings did not regress: inconclusive.";
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ofMain.h"
+#include <random>
+
+// Compares the JSON of two example-benchmark or example-microbenchmark runs, a baseline and a current one.
+// Timings: the median of the current samples against the median of the baseline's, with a bootstrap confidence interval of their ratio.
+// Only a slowdown whose whole interval lies beyond the threshold is a regression, so noisy kernels do not fail the gate.
+// With fewer than nMinSamples samples on a side the interval means little, the comparison is inconclusive and not gated.
+// Landmarks: when the baseline saved them, the current run must have too, for as many frames, and the faces of every frame are matched
+// and their mean point distance must stay within tolerance.
+// Exits with 1 when anything regressed, a baseline combination or its landmarks are missing from the current run, or the runs replayed
+// different inputs, for use as a gate. With --allow-other-input, different inputs are inconclusive instead and exit with 2.
+class ofApp : public ofBaseApp{
+
+	public:
+		ofApp(const vector<string>& vArgs);
+		void setup();
+		void update();
+
+    private:
+        struct Comparison {
+            string      sName;
+            int         nSamplesBaseline = 0;
+            int         nSamplesCurrent = 0;
+            double      fBaseline = 0.0; // medians, lower is better
+            double      fCurrent = 0.0;
+            double      fRatio = 1.0; // current / baseline
+            double      fRatioLow = 1.0; // the confidence interval of the ratio
+            double      fRatioHigh = 1.0;
+            bool        bRegression = false;
+            bool        bImprovement = false;
+            bool        bInconclusive = false; // too few samples to gate on
+        };
+        struct Accuracy {
+            string      sName;
+            int         nFrames = 0; // compared, the fewer of the two
+            bool        bFramesDiffer = false; // the runs saved landmarks for a different number of frames, a failure
+            int         nFaces = 0; // of the baseline
+            int         nMissing = 0; // baseline faces with no current face
+            int         nExtra = 0; // current faces with no baseline face
+            double      fMeanErrorPx = 0.0; // mean distance of the landmarks of the matched faces
+            double      fMaxErrorPx = 0.0; // of the worst face
+            bool        bFailed = false;
+        };
+
+        bool parseArguments();
+        bool load(const string& sPath, ofJson& json);
+        void compareBenchmarks(const ofJson& baseline, const ofJson& current);
+        void compareMicrobenchmarks(const ofJson& baseline, const ofJson& current);
+        Comparison compare(const string& sName, const vector<double>& vBaseline, const vector<double>& vCurrent);
+        Accuracy compareLandmarks(const string& sName, const ofJson& baseline, const ofJson& current);
+        void saveReport();
+        static double median(vector<double> v);
+        static void printUsage();
+
+        vector<string>                  vArgs;
+        string                          sBaseline;
+        string                          sCurrent;
+        string                          sReport = "comparison"; // <sReport>.json in the data folder
+        float                           fThresholdPercent = 5.0f; // slowdowns below it are noise
+        float                           fConfidence = 0.95f;
+        int                             nResamples = 2000;
+        float                           fLandmarkTolerancePx = 1.0f; // the mean landmark error allowed
+        float                           fMaxMissingPercent = 1.0f; // faces found in one run and not in the other
+        int                             nMinSamples = 5; // per side, to gate on a comparison
+        bool                            bAllowOtherInput = false; // different inputs are inconclusive rather than an error
+        bool                            bOtherInput = false; // the runs replayed different inputs
+        std::mt19937                    rng; // fixed seed, the same inputs give the same intervals
+        vector<Comparison>              vComparisons;
+        vector<Accuracy>                vAccuracies;
+        vector<string>                  vMissing; // of the baseline, not in the current run
+};
@@ -0,0 +1,428 @@
+#include "ofApp.h"
+#include "SequenceCapture.h"
+#include "ofxOpenFaceMemory.h"
+
+ofApp::ofApp(const vector<string>& vArgsValue) {
+    vArgs = vArgsValue;
+}
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+    if (!parseArguments()) {
+        printUsage();
+        ofExit(1);
+        return;
+    }
+    if (settings.bSelfTest) {
+        ofExit(runSelfTest() ? 0 : 1);
+        return;
+    }
+    if (!loadFrames()) {
+        ofExit(1);
+        return;
+    }
+
+    // Every combination, each one is run in turn from update()
+    for (auto eLandmarks : settings.vDetectorsLandmarks) {
+        for (auto eFace : settings.vDetectorsFace) {
+            for (auto nMaxFaces : settings.vMaxFaces) {
+                Run run;
+                run.eDetectorFace = eFace;
+                run.eDetectorLandmarks = eLandmarks;
+                run.nMaxFaces = nMaxFaces;
+                vRuns.push_back(run);
+            }
+        }
+    }
+    ofLogNotice("ofApp", ofToString(vFrames.size()) + " frames, " + ofToString(vRuns.size()) + " combinations");
+}
+
+//--------------------------------------------------------------
+void ofApp::update(){
+    if (nNextRun >= (int)vRuns.size()) {
+        return;
+    }
+    Run& run = vRuns[nNextRun];
+    ofLogNotice("ofApp", "Running " + ofxOpenFace::FaceDetectorToString(run.eDetectorFace) + " / " + ofxOpenFace::LandmarkDetectorToString(run.eDetectorLandmarks)
+                + ", " + ofToString(run.nMaxFaces) + " faces (" + ofToString(nNextRun + 1) + "/" + ofToString(vRuns.size()) + ")");
+    runBenchmark(run);
+    ofLogNotice("ofApp", ofToString(run.fFps, 1) + " fps, p50 " + ofToString(run.stats[ofxOpenFaceStats::STAGE_FRAME].fP50Ms, 1)
+                + " ms, p99 " + ofToString(run.stats[ofxOpenFaceStats::STAGE_FRAME].fP99Ms, 1) + " ms");
+    ofLogNotice("ofApp", "Fits: " + run.fitStats.toString() + ", " + ofToString(run.nFrames > 0 ? (float)run.fitStats.nIterations / run.nFrames : 0.0f, 1) + " iterations per frame");
+
+    // Save after every run, an interrupted benchmark keeps what it measured
+    nNextRun++;
+    saveResults();
+    if (nNextRun == (int)vRuns.size()) {
+        ofExit(0);
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::runBenchmark(Run& run) {
+    // Where the peak cannot be reset it is the process' so far, and is not reported per run
+    run.bPeakMeasured = ofxOpenFaceMemory::resetPeakResidentBytes();
+
+    // A new instance per run, so every combination starts from a loaded model and empty face slots
+    unique_ptr<ofxOpenFace> pOpenFace(new ofxOpenFace());
+    pOpenFace->setAsyncDetection(settings.bAsyncDetection);
+    pOpenFace->setFitPrediction(settings.bFitPrediction);
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    pOpenFace->setup(true, vFrames[0].cols, vFrames[0].rows, run.eDetectorFace, run.eDetectorLandmarks, camSettings, 30, 200, run.nMaxFaces);
+    run.fSetupMs = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f;
+    ofAddListener(pOpenFace->eventDataMultipleRaw, this, &ofApp::onFaces);
+
+    // No worker thread: every frame is processed on this thread as soon as it is set, nothing is dropped
+    for (int i = 0; i < settings.nWarmupFrames; i++) {
+        pOpenFace->setImage(vFrames[i % vFrames.size()]);
+        pOpenFace->processNextFrame();
+    }
+    pOpenFace->resetStats();
+    pOpenFace->resetFitStats();
+    nFacesSeen = 0;
+
+    nTimeStartUs = ofGetElapsedTimeMicros();
+    for (int nPass = 0; nPass < settings.nPasses; nPass++) {
+        pLandmarksRecording = (settings.bSaveLandmarks && nPass == 0) ? &run.vLandmarks : nullptr;
+        uint64_t nTimePassUs = ofGetElapsedTimeMicros();
+        for (auto& frame : vFrames) {
+            pOpenFace->setImage(frame);
+            pOpenFace->processNextFrame();
+        }
+        run.vPassMsPerFrame.push_back((ofGetElapsedTimeMicros() - nTimePassUs) / 1000.0f / vFrames.size());
+    }
+    pLandmarksRecording = nullptr;
+    run.fSeconds = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000000.0f;
+    run.nFrames = vFrames.size() * settings.nPasses;
+    run.fFps = run.fSeconds > 0.0f ? run.nFrames / run.fSeconds : 0.0f;
+    run.fFacesPerFrame = run.nFrames > 0 ? (float)nFacesSeen / run.nFrames : 0.0f;
+    run.stats = pOpenFace->getStats();
+    run.fitStats = pOpenFace->getFitStats();
+    run.nResidentBytes = ofxOpenFaceMemory::getResidentBytes();
+    run.nPeakResidentBytes = run.bPeakMeasured ? ofxOpenFaceMemory::getPeakResidentBytes() : 0;
+
+    ofRemoveListener(pOpenFace->eventDataMultipleRaw, this, &ofApp::onFaces);
+    pOpenFace->exit();
+}
+
+//--------------------------------------------------------------
+void ofApp::onFaces(vector<ofxOpenFaceDataSingleFace>& data) {
+    if (pLandmarksRecording != nullptr) {
+        pLandmarksRecording->push_back(vector<vector<float>>());
+    }
+    for (auto& d : data) {
+        if (!d.detected) {
+            continue;
+        }
+        nFacesSeen++;
+        if (pLandmarksRecording != nullptr) {
+            vector<float> vPoints;
+            for (auto& p : d.allLandmarks2D) {
+                vPoints.push_back(p.x);
+                vPoints.push_back(p.y);
+            }
+            pLandmarksRecording->back().push_back(vPoints);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+bool ofApp::loadFrames() {
+    Utilities::SequenceCapture capture;
+    string sPath = ofToDataPath(settings.sInput, true);
+    bool bOpened = ofDirectory(sPath).isDirectory() ? capture.OpenImageSequence(sPath) : capture.OpenVideoFile(sPath);
+    if (!bOpened) {
+        ofLogError("ofApp", "Could not open '" + sPath + "'");
+        return false;
+    }
+    camSettings.fx = capture.fx;
+    camSettings.fy = capture.fy;
+    camSettings.cx = capture.cx;
+    camSettings.cy = capture.cy;
+
+    cv::Mat frame = capture.GetNextFrame();
+    while (!frame.empty() && (settings.nFrames <= 0 || (int)vFrames.size() < settings.nFrames)) {
+        // OpenCV reads BGR, ofxOpenFace takes RGB like the rest of openFrameworks
+        cv::Mat rgb;
+        cv::cvtColor(frame, rgb, cv::COLOR_BGR2RGB);
+        vFrames.push_back(rgb);
+        frame = capture.GetNextFrame();
+    }
+    capture.Close();
+    if (vFrames.empty()) {
+        ofLogError("ofApp", "No frames in '" + sPath + "'");
+        return false;
+    }
+    ofLogNotice("ofApp", "Loaded " + ofToString(vFrames.size()) + " frames of " + ofToString(vFrames[0].cols) + "x" + ofToString(vFrames[0].rows) + " from '" + sPath + "'");
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::saveResults() {
+    ofJson json;
+    json["input"] = settings.sInput;
+    json["frames"] = (int)vFrames.size();
+    json["passes"] = settings.nPasses;
+    json["warmupFrames"] = settings.nWarmupFrames;
+    json["asyncDetection"] = settings.bAsyncDetection;
+    json["fitPrediction"] = settings.bFitPrediction;
+    json["threads"] = (int)std::thread::hardware_concurrency();
+
+    bool bPeak = true;
+    for (int i = 0; i < nNextRun; i++) {
+        bPeak = bPeak && vRuns[i].bPeakMeasured;
+    }
+
+    // One CSV row per run, the stages as p50/p95/p99 columns
+    string sCsv = "detector,landmarks,maxFaces,frames,setupMs,seconds,fps,facesPerFrame,residentBytes";
+    if (bPeak) {
+        sCsv += ",peakResidentBytes";
+    }
+    for (int s = 0; s < ofxOpenFaceStats::STAGE_COUNT; s++) {
+        string sStage = ofxOpenFaceStats::StageToString((ofxOpenFaceStats::Stage)s);
+        sCsv += "," + sStage + " p50," + sStage + " p95," + sStage + " p99," + sStage + " max";
+    }
+    sCsv += "\n";
+
+    for (int i = 0; i < nNextRun; i++) {
+        const Run& run = vRuns[i];
+        ofJson jsonRun;
+        jsonRun["detector"] = ofxOpenFace::FaceDetectorToString(run.eDetectorFace);
+        jsonRun["landmarks"] = ofxOpenFace::LandmarkDetectorToString(run.eDetectorLandmarks);
+        jsonRun["maxFaces"] = run.nMaxFaces;
+        jsonRun["frames"] = run.nFrames;
+        jsonRun["setupMs"] = run.fSetupMs;
+        jsonRun["seconds"] = run.fSeconds;
+        jsonRun["fps"] = run.fFps;
+        jsonRun["facesPerFrame"] = run.fFacesPerFrame;
+        jsonRun["residentBytes"] = run.nResidentBytes;
+        if (run.bPeakMeasured) {
+            jsonRun["peakResidentBytes"] = run.nPeakResidentBytes;
+        }
+        jsonRun["passMsPerFrame"] = run.vPassMsPerFrame;
+        jsonRun["fits"] = run.fitStats.nFits;
+        jsonRun["fitsNarrowed"] = run.fitStats.nFitsCheap;
+        jsonRun["iterationsPerFit"] = run.fitStats.getIterationsPerFit();
+        jsonRun["iterationsPerFrame"] = run.nFrames > 0 ? (float)run.fitStats.nIterations / run.nFrames : 0.0f;
+        jsonRun["predictionResidualPx"] = run.fitStats.getResidualPxMean();
+        if (!run.vLandmarks.empty()) {
+            jsonRun["landmarkPoints"] = run.vLandmarks;
+        }
+        sCsv += jsonRun["detector"].get<string>() + "," + jsonRun["landmarks"].get<string>() + "," + ofToString(run.nMaxFaces) + "," + ofToString(run.nFrames)
+                + "," + ofToString(run.fSetupMs) + "," + ofToString(run.fSeconds) + "," + ofToString(run.fFps) + "," + ofToString(run.fFacesPerFrame)
+                + "," + ofToString(run.nResidentBytes) + (bPeak ? "," + ofToString(run.nPeakResidentBytes) : "");
+        for (int s = 0; s < ofxOpenFaceStats::STAGE_COUNT; s++) {
+            const ofxOpenFaceHistogram::Summary& h = run.stats.stages[s];
+            ofJson jsonStage;
+            jsonStage["count"] = h.nCount;
+            jsonStage["meanMs"] = h.fMeanMs;
+            jsonStage["p50Ms"] = h.fP50Ms;
+            jsonStage["p95Ms"] = h.fP95Ms;
+            jsonStage["p99Ms"] = h.fP99Ms;
+            jsonStage["maxMs"] = h.fMaxMs;
+            jsonRun["stages"][ofxOpenFaceStats::StageToString((ofxOpenFaceStats::Stage)s)] = jsonStage;
+            sCsv += "," + ofToString(h.fP50Ms) + "," + ofToString(h.fP95Ms) + "," + ofToString(h.fP99Ms) + "," + ofToString(h.fMaxMs);
+        }
+        sCsv += "\n";
+        json["runs"].push_back(jsonRun);
+    }
+
+    ofSavePrettyJson(settings.sOutput + ".json", json);
+    ofBuffer buffer;
+    buffer.set(sCsv);
+    ofBufferToFile(settings.sOutput + ".csv", buffer);
+}
+
+//--------------------------------------------------------------
+bool ofApp::runSelfTest() {
+    ofxOpenFaceModelLoader loader;
+    loader.setComponents(true, false, false);
+    loader.load(LandmarkDetector::FaceModelParameters::CLNF_DETECTOR);
+    unique_ptr<LandmarkDetector::CLNF> pModel(loader.pModel);
+    if (!pModel || !pModel->loaded_successfully) {
+        ofLogError("ofApp", "Self test: no landmark model, see --data.");
+        return false;
+    }
+    LandmarkDetector::CLNF& model = *pModel;
+
+    // A smooth texture moving by ptMotion every frame, under a frontal face placed where it is on each frame
+    const cv::Point2f ptMotion(3.0f, 2.0f);
+    const cv::Rect_<float> rFace(220, 140, 200, 200);
+    cv::Mat_<uchar> texture(480, 640);
+    cv::RNG rng(0x0F0FACE);
+    rng.fill(texture, cv::RNG::UNIFORM, 0, 256);
+    cv::GaussianBlur(texture, texture, cv::Size(0, 0), 4.0);
+    auto getFrame = [&](int nFrame) {
+        cv::Mat_<uchar> frame;
+        cv::Matx23f M(1.0f, 0.0f, ptMotion.x * nFrame, 0.0f, 1.0f, ptMotion.y * nFrame);
+        cv::warpAffine(texture, frame, M, texture.size(), cv::INTER_LINEAR, cv::BORDER_REFLECT);
+        return frame;
+    };
+    auto placeFace = [&](int nFrame) {
+        cv::Rect_<float> r = rFace;
+        r.x += ptMotion.x * nFrame;
+        r.y += ptMotion.y * nFrame;
+        model.params_local.setTo(0.0f);
+        model.pdm.CalcParams(model.params_global, r, model.params_local);
+        model.pdm.CalcShape2D(model.detected_landmarks, model.params_local, model.params_global);
+        model.detection_certainty = 1.0f;
+    };
+    // Mean motion of the landmarks from where the face is on nFrame
+    auto getMotion = [&](int nFrame) {
+        cv::Mat_<float> landmarks = model.detected_landmarks.clone();
+        cv::Vec6f paramsGlobal = model.params_global;
+        placeFace(nFrame);
+        int n = landmarks.rows / 2;
+        cv::Point2f ptSum;
+        for (int i = 0; i < n; i++) {
+            ptSum += cv::Point2f(landmarks(i) - model.detected_landmarks(i), landmarks(i + n) - model.detected_landmarks(i + n));
+        }
+        landmarks.copyTo(model.detected_landmarks);
+        model.params_global = paramsGlobal;
+        return ptSum * (1.0f / MAX(n, 1));
+    };
+    auto isMotion = [&](const cv::Point2f& pt) { return cv::norm(pt - ptMotion) < 0.5; };
+
+    ofxOpenFaceFlowTracker flow;
+    flow.setup(1);
+    flow.setEnabled(true, 5, 0.5f);
+    bool bPassed = true;
+
+    // Fitted on frame 0, carried by the flow on frame 1
+    placeFace(0);
+    flow.update(0, getFrame(0), model, true);
+    bool bTracked = flow.track(0, getFrame(1), model);
+    cv::Point2f ptMotionFlow = getMotion(0);
+    if (!bTracked || !isMotion(ptMotionFlow)) {
+        ofLogError("ofApp", "Self test: the flow moved the face by " + ofToString(ptMotionFlow) + " instead of " + ofToString(ptMotion));
+        bPassed = false;
+    }
+
+    // Fitted on frame 0, predicted on frame 1 as ofxOpenFace does for the faces it skips, so frame 2 is fitted, and frame 3 is
+    // carried by the flow from frame 2 only
+    flow.reset(0);
+    placeFace(0);
+    flow.update(0, getFrame(0), model, true);
+    flow.shift(0, model, cv::Vec2f(ptMotion.x, ptMotion.y));
+    cv::Point2f ptMotionPredicted = getMotion(0);
+    if (!isMotion(ptMotionPredicted)) {
+        ofLogError("ofApp", "Self test: the prediction moved the face by " + ofToString(ptMotionPredicted) + " instead of " + ofToString(ptMotion));
+        bPassed = false;
+    }
+    if (flow.track(0, getFrame(2), model)) {
+        ofLogError("ofApp", "Self test: the flow carried a predicted face from a patch older than its landmarks");
+        bPassed = false;
+    }
+    placeFace(2);
+    flow.update(0, getFrame(2), model, true);
+    bTracked = flow.track(0, getFrame(3), model);
+    ptMotionFlow = getMotion(2);
+    if (!bTracked || !isMotion(ptMotionFlow)) {
+        ofLogError("ofApp", "Self test: after a prediction, the flow moved the face by " + ofToString(ptMotionFlow) + " instead of " + ofToString(ptMotion));
+        bPassed = false;
+    }
+
+    if (bPassed) {
+        ofLogNotice("ofApp", "Self test passed");
+    }
+    return bPassed;
+}
+
+//--------------------------------------------------------------
+bool ofApp::parseArguments() {
+    auto toList = [](const string& s) { return ofSplitString(s, ",", true, true); };
+    for (size_t i = 0; i < vArgs.size(); i++) {
+        const string& sArg = vArgs[i];
+        bool bHasValue = i + 1 < vArgs.size();
+        if (sArg == "--async") {
+            settings.bAsyncDetection = true;
+        } else if (sArg == "--predict") {
+            settings.bFitPrediction = true;
+        } else if (sArg == "--save-landmarks") {
+            settings.bSaveLandmarks = true;
+        } else if (sArg == "--self-test") {
+            settings.bSelfTest = true;
+        } else if (!bHasValue) {
+            ofLogError("ofApp", "Unknown argument or missing value: '" + sArg + "'");
+            return false;
+        } else if (sArg == "--input") {
+            settings.sInput = vArgs[++i];
+        } else if (sArg == "--output") {
+            settings.sOutput = vArgs[++i];
+        } else if (sArg == "--data") {
+            ofSetDataPathRoot(ofFilePath::getAbsolutePath(vArgs[++i], false));
+        } else if (sArg == "--frames") {
+            settings.nFrames = ofToInt(vArgs[++i]);
+        } else if (sArg == "--warmup") {
+            settings.nWarmupFrames = MAX(ofToInt(vArgs[++i]), 0);
+        } else if (sArg == "--passes") {
+            settings.nPasses = MAX(ofToInt(vArgs[++i]), 1);
+        } else if (sArg == "--faces") {
+            for (auto& s : toList(vArgs[++i])) {
+                settings.vMaxFaces.push_back(MAX(ofToInt(s), 1));
+            }
+        } else if (sArg == "--detectors") {
+            for (auto& s : toList(ofToUpper(vArgs[++i]))) {
+                if (s == "HAAR") {
+                    settings.vDetectorsFace.push_back(LandmarkDetector::FaceModelParameters::HAAR_DETECTOR);
+                } else if (s == "HOG" || s == "HOG_SVM") {
+                    settings.vDetectorsFace.push_back(LandmarkDetector::FaceModelParameters::HOG_SVM_DETECTOR);
+                } else if (s == "MTCNN") {
+                    settings.vDetectorsFace.push_back(LandmarkDetector::FaceModelParameters::MTCNN_DETECTOR);
+                } else {
+                    ofLogError("ofApp", "Unknown face detector '" + s + "'");
+                    return false;
+                }
+            }
+        } else if (sArg == "--landmarks") {
+            for (auto& s : toList(ofToUpper(vArgs[++i]))) {
+                if (s == "CLM") {
+                    settings.vDetectorsLandmarks.push_back(LandmarkDetector::FaceModelParameters::CLM_DETECTOR);
+                } else if (s == "CLNF") {
+                    settings.vDetectorsLandmarks.push_back(LandmarkDetector::FaceModelParameters::CLNF_DETECTOR);
+                } else if (s == "CECLM" || s == "CE-CLM") {
+                    settings.vDetectorsLandmarks.push_back(LandmarkDetector::FaceModelParameters::CECLM_DETECTOR);
+                } else {
+                    ofLogError("ofApp", "Unknown landmark detector '" + s + "'");
+                    return false;
+                }
+            }
+        } else {
+            ofLogError("ofApp", "Unknown argument: '" + sArg + "'");
+            return false;
+        }
+    }
+    if (settings.sInput.empty() && !settings.bSelfTest) {
+        ofLogError("ofApp", "No input given.");
+        return false;
+    }
+
+    // Everything unless told otherwise
+    if (settings.vDetectorsFace.empty()) {
+        settings.vDetectorsFace = {LandmarkDetector::FaceModelParameters::HAAR_DETECTOR, LandmarkDetector::FaceModelParameters::HOG_SVM_DETECTOR, LandmarkDetector::FaceModelParameters::MTCNN_DETECTOR};
+    }
+    if (settings.vDetectorsLandmarks.empty()) {
+        settings.vDetectorsLandmarks = {LandmarkDetector::FaceModelParameters::CLM_DETECTOR, LandmarkDetector::FaceModelParameters::CLNF_DETECTOR, LandmarkDetector::FaceModelParameters::CECLM_DETECTOR};
+    }
+    if (settings.vMaxFaces.empty()) {
+        settings.vMaxFaces = {1, 4};
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::printUsage() {
+    ofLogNotice("ofApp") << "Usage: example-benchmark --input <video file or image directory> [options]\n"
+        << "  --output <name>       results in <name>.json and <name>.csv in the data folder (benchmark)\n"
+        << "  --data <path>         the data folder holding model/, e.g. ../../example/bin/data\n"
+        << "  --frames <n>          frames read from the input, 0 for all (300)\n"
+        << "  --warmup <n>          frames processed before measuring (10)\n"
+        << "  --passes <n>          times the frames are replayed, one timing sample each (5)\n"
+        << "  --faces <list>        max faces, e.g. 1,4 (1,4)\n"
+        << "  --detectors <list>    HAAR,HOG,MTCNN (all)\n"
+        << "  --landmarks <list>    CLM,CLNF,CECLM (all)\n"
+        << "  --async               detect faces on their own thread\n"
+        << "  --predict             seed the landmark fits with a motion prediction\n"
+        << "  --save-landmarks      keep the landmarks of the first pass, for example-benchmark-compare\n"
+        << "  --self-test           only check the tracking paths on synthetic frames, exits with 1 on a failure";
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOpenFace.h"
+
+// What to run, from the command line
+class benchmarkSettings {
+    public:
+        string sInput; // a video file or a directory of images
+        string sOutput = "benchmark"; // the results go to <sOutput>.json and <sOutput>.csv in the data folder
+        int nFrames = 300; // frames read from the input, 0 for all of them
+        int nWarmupFrames = 10; // processed before measuring
+        int nPasses = 5; // times the frames are replayed per combination, each pass is one sample for the comparisons
+        bool bAsyncDetection = false;
+        bool bFitPrediction = false; // seed the fits with a motion prediction, to compare the iterations with a run without
+        bool bSaveLandmarks = false; // keep the landmarks of the first pass, to check the accuracy against a baseline
+        bool bSelfTest = false; // only check the tracking paths on synthetic frames, no input needed
+        vector<LandmarkDetector::FaceModelParameters::FaceDetector> vDetectorsFace;
+        vector<LandmarkDetector::FaceModelParameters::LandmarkDetector> vDetectorsLandmarks;
+        vector<int> vMaxFaces;
+};
+
+// Replays recorded frames through every face detector, landmark detector and max faces combination as fast as possible,
+// then writes throughput, latency percentiles, memory and the per-stage timings as JSON and CSV.
+class ofApp : public ofBaseApp{
+
+	public:
+		ofApp(const vector<string>& vArgs);
+		void setup();
+		void update();
+
+    private:
+        // One combination and what it measured
+        struct Run {
+            LandmarkDetector::FaceModelParameters::FaceDetector         eDetectorFace;
+            LandmarkDetector::FaceModelParameters::LandmarkDetector     eDetectorLandmarks;
+            int                                                         nMaxFaces = 1;
+            int                                                         nFrames = 0; // measured, without the warmup
+            float                                                       fSetupMs = 0.0f; // loading the model and the face slots
+            float                                                       fSeconds = 0.0f;
+            float                                                       fFps = 0.0f;
+            float                                                       fFacesPerFrame = 0.0f; // detected faces, on average
+            uint64_t                                                    nResidentBytes = 0; // after the run
+            uint64_t                                                    nPeakResidentBytes = 0; // of this run alone, if bPeakMeasured
+            bool                                                        bPeakMeasured = false; // the peak could be reset before the run
+            ofxOpenFaceStats::Snapshot                                  stats;
+            ofxOpenFaceFitPredictor::Stats                              fitStats; // the optimisation iterations the fits were given
+            vector<float>                                               vPassMsPerFrame; // one sample per pass
+            vector<vector<vector<float>>>                               vLandmarks; // frame -> face -> x0, y0, x1, y1...
+        };
+
+        bool parseArguments();
+        bool loadFrames();
+        // A face predicted on one frame then carried by the optical flow must move by its motion, not twice
+        bool runSelfTest();
+        void runBenchmark(Run& run);
+        void saveResults();
+        void onFaces(vector<ofxOpenFaceDataSingleFace>& data);
+        static void printUsage();
+
+        vector<string>                  vArgs;
+        benchmarkSettings               settings;
+        vector<cv::Mat>                 vFrames; // decoded up front, so decoding is not measured
+        ofxOpenFace::CameraSettings     camSettings;
+        vector<Run>                     vRuns;
+        int                             nNextRun = 0;
+        uint64_t                        nFacesSeen = 0;
+        vector<vector<vector<float>>>*  pLandmarksRecording = nullptr; // where the faces of the frames go, when recording
+};
@@ -0,0 +1,14 @@
+#include "ofMain.h"
+#include "ofApp.h"
+#include "ofAppNoWindow.h"
+
+//========================================================================
+int main(int argc, char* argv[]){
+	// No window and no OpenGL, so it runs on a headless box
+	ofAppNoWindow window;
+	ofSetupOpenGL(&window, 0, 0, OF_WINDOW);
+
+	vector<string> vArgs(argv + 1, argv + argc);
+	ofRunApp(new ofApp(vArgs));
+	return ofGetMainLoop()->getExitCode();
+}
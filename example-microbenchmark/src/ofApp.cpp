@@ -0,0 +1,486 @@
+#include "ofApp.h"
+#include "CNN_utils.h"
+#include "Face_utils.h"
+#include "SVM_static_lin.h"
+#include "SVR_static_lin_regressors.h"
+#include <chrono>
+
+#define OFAPP_RANDOM_SEED 0x0F0FACE
+
+ofApp::ofApp(const vector<string>& vArgsValue) : rng(OFAPP_RANDOM_SEED) {
+    vArgs = vArgsValue;
+}
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+    if (!parseArguments()) {
+        printUsage();
+        ofExit(1);
+        return;
+    }
+    ofFile fModel(OFX_OPENFACE_MODEL_CECLM);
+    if (!fModel.exists()) {
+        ofLogError("ofApp", "No model at '" + fModel.getAbsolutePath() + "', see --data.");
+        ofExit(1);
+        return;
+    }
+
+    // One thread, the kernels are measured on their own
+    cv::setNumThreads(1);
+    benchmarkPatchExperts();
+    benchmarkPDM();
+    benchmarkCNN();
+    benchmarkValidator();
+    benchmarkFaceAnalyser();
+    saveResults();
+    ofExit(0);
+}
+
+//--------------------------------------------------------------
+void ofApp::update(){
+}
+
+//--------------------------------------------------------------
+bool ofApp::isSelected(const vector<string>& vNames) const {
+    for (auto& sName : vNames) {
+        if (sFilter.empty() || ofToLower(sName).find(ofToLower(sFilter)) != string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+LandmarkDetector::CLNF& ofApp::getModel(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks) {
+    auto& pModel = models[(int)eDetectorLandmarks];
+    if (!pModel) {
+        ofxOpenFaceModelLoader loader;
+        loader.setComponents(true, false, false);
+        loader.load(eDetectorLandmarks);
+        pModel.reset(loader.pModel);
+    }
+    return *pModel;
+}
+
+//--------------------------------------------------------------
+void ofApp::measure(const string& sName, const string& sSize, double fFlopsPerOp, function<void()> op, function<void()> restore) {
+    if (!isSelected({sName})) {
+        return;
+    }
+    typedef std::chrono::steady_clock clock;
+    auto getNs = [](clock::time_point t0) { return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count(); };
+    auto run = [&](uint64_t nCalls, bool bOp) {
+        auto t0 = clock::now();
+        for (uint64_t i = 0; i < nCalls; i++) {
+            if (restore) {
+                restore();
+            }
+            if (bOp) {
+                op();
+            }
+        }
+        return getNs(t0);
+    };
+
+    // The first call fills the caches, the lazy allocations and the precomputed DFTs
+    run(1, true);
+    double fNsOnce = MAX(run(1, true), 1.0);
+    uint64_t nCalls = MAX((uint64_t)(nMinSampleMs * 1e6 / fNsOnce), (uint64_t)1);
+
+    Result result;
+    for (int s = 0; s < nSamples; s++) {
+        double fNs = run(nCalls, true);
+        if (restore) {
+            fNs = MAX(fNs - run(nCalls, false), 0.0);
+        }
+        result.vSamplesNsPerOp.push_back(fNs / nCalls);
+    }
+    vector<double> vNsPerOp = result.vSamplesNsPerOp;
+    std::sort(vNsPerOp.begin(), vNsPerOp.end());
+
+    result.sName = sName;
+    result.sSize = sSize;
+    result.fNsPerOp = vNsPerOp[vNsPerOp.size() / 2];
+    result.fNsPerOpMin = vNsPerOp.front();
+    result.fFlopsPerOp = fFlopsPerOp;
+    vResults.push_back(result);
+    ofLogNotice("ofApp", sName + " [" + sSize + "]: " + ofToString(result.fNsPerOp, 0) + " ns/op"
+                + (fFlopsPerOp > 0.0 ? ", " + ofToString(result.getGFlops(), 2) + " GFLOP/s" : ""));
+}
+
+//--------------------------------------------------------------
+void ofApp::benchmarkPatchExperts() {
+    // The response maps of one landmark of the frontal view, at every scale, as in one fitting iteration.
+    // Mirrored landmarks have no expert of their own, the first landmark with one is taken.
+    int nResponse = nWindowSize * nWindowSize;
+
+    // CE-CLM
+    if (isSelected({"CEN_patch_expert::Response", "CEN_patch_expert::ResponseSparse"})) {
+        auto& vScales = getModel(LandmarkDetector::FaceModelParameters::CECLM_DETECTOR).patch_experts.cen_expert_intensity;
+        for (size_t scale = 0; scale < vScales.size(); scale++) {
+            for (auto& expert : vScales[scale][0]) {
+                if (expert.weights.empty()) {
+                    continue;
+                }
+                int nWidth = nWindowSize + expert.width_support - 1;
+                int nHeight = nWindowSize + expert.height_support - 1;
+                cv::Mat_<float> areaLeft(nHeight, nWidth), areaRight(nHeight, nWidth);
+                rng.fill(areaLeft, cv::RNG::UNIFORM, 0.0f, 255.0f);
+                rng.fill(areaRight, cv::RNG::UNIFORM, 0.0f, 255.0f);
+                cv::Mat_<float> responseLeft, responseRight, mapMatrix, im2colLeft, im2colRight;
+                LandmarkDetector::interpolationMatrix(mapMatrix, nWindowSize, nWindowSize, nWidth, nHeight);
+                // The multiply-adds of the layers, for every response pixel
+                double fFlopsPerPixel = 0.0;
+                for (auto& w : expert.weights) {
+                    fFlopsPerPixel += 2.0 * w.rows * w.cols;
+                }
+                string sSize = "scale " + ofToString(scale) + ", " + ofToString(nWidth) + "x" + ofToString(nHeight) + " area";
+                measure("CEN_patch_expert::Response", sSize, fFlopsPerPixel * nResponse, [&] {
+                    expert.Response(areaLeft, responseLeft);
+                });
+                // Counted as two dense responses, the sparse one computes part of them and interpolates the rest
+                measure("CEN_patch_expert::ResponseSparse", sSize + " x2", 2.0 * fFlopsPerPixel * nResponse, [&] {
+                    expert.ResponseSparse(areaLeft, areaRight, responseLeft, responseRight, mapMatrix, im2colLeft, im2colRight);
+                });
+                break;
+            }
+        }
+    }
+
+    // CLNF
+    if (isSelected({"CCNF_patch_expert::ResponseOpenBlas"})) {
+        auto& vScales = getModel(LandmarkDetector::FaceModelParameters::CLNF_DETECTOR).patch_experts.ccnf_expert_intensity;
+        for (size_t scale = 0; scale < vScales.size(); scale++) {
+            for (auto& expert : vScales[scale][0]) {
+                if (expert.neurons.empty()) {
+                    continue;
+                }
+                // The Sigmas only exist for the window sizes of the model
+                int nWindow = expert.window_sizes.empty() ? nWindowSize : expert.window_sizes[0];
+                int nWidth = nWindow + expert.width - 1;
+                int nHeight = nWindow + expert.height - 1;
+                cv::Mat_<float> area(nHeight, nWidth);
+                rng.fill(area, cv::RNG::UNIFORM, 0.0f, 255.0f);
+                cv::Mat_<float> response(nWindow, nWindow), im2col;
+                // Every neuron correlates its weights over the area, then the response goes through a Sigma
+                double fPixels = nWindow * nWindow;
+                double fFlops = expert.neurons.size() * 2.0 * fPixels * expert.width * expert.height + 2.0 * fPixels * fPixels;
+                measure("CCNF_patch_expert::ResponseOpenBlas", "scale " + ofToString(scale) + ", " + ofToString(nWidth) + "x" + ofToString(nHeight) + " area, "
+                        + ofToString(expert.neurons.size()) + " neurons", fFlops, [&] {
+                    expert.ResponseOpenBlas(area, response, im2col);
+                });
+                break;
+            }
+        }
+    }
+
+    // CLM
+    if (isSelected({"Multi_SVR_patch_expert::Response"})) {
+        auto& vScales = getModel(LandmarkDetector::FaceModelParameters::CLM_DETECTOR).patch_experts.svr_expert_intensity;
+        for (size_t scale = 0; scale < vScales.size(); scale++) {
+            for (auto& expert : vScales[scale][0]) {
+                if (expert.svr_patch_experts.empty()) {
+                    continue;
+                }
+                int nWidth = nWindowSize + expert.width - 1;
+                int nHeight = nWindowSize + expert.height - 1;
+                cv::Mat_<float> area(nHeight, nWidth);
+                rng.fill(area, cv::RNG::UNIFORM, 0.0f, 255.0f);
+                cv::Mat_<float> response(nWindowSize, nWindowSize);
+                double fFlops = expert.svr_patch_experts.size() * 2.0 * nResponse * expert.width * expert.height;
+                measure("Multi_SVR_patch_expert::Response", "scale " + ofToString(scale) + ", " + ofToString(nWidth) + "x" + ofToString(nHeight) + " area, "
+                        + ofToString(expert.svr_patch_experts.size()) + " modalities", fFlops, [&] {
+                    expert.Response(area, response);
+                });
+                break;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::benchmarkPDM() {
+    if (!isSelected({"PDM::CalcShape2D", "PDM::ComputeJacobian"})) {
+        return;
+    }
+    LandmarkDetector::PDM& pdm = getModel(LandmarkDetector::FaceModelParameters::CECLM_DETECTOR).pdm;
+    int n = pdm.NumberOfPoints();
+    int m = pdm.NumberOfModes();
+
+    // A slightly turned face of 200 pixels
+    cv::Mat_<float> paramsLocal(m, 1);
+    rng.fill(paramsLocal, cv::RNG::NORMAL, 0.0f, 1.0f);
+    for (int i = 0; i < m; i++) {
+        paramsLocal(i) *= sqrt(pdm.eigen_values(i)) * 0.5f;
+    }
+    cv::Vec6f paramsGlobal;
+    pdm.CalcParams(paramsGlobal, cv::Rect_<float>(220, 140, 200, 200), paramsLocal, cv::Vec3f(0.1f, 0.2f, 0.0f));
+    cv::Mat_<float> shape, jacobian, jacobianTW;
+    cv::Mat_<float> W = cv::Mat_<float>::eye(2 * n, 2 * n);
+
+    string sSize = ofToString(n) + " points, " + ofToString(m) + " modes";
+    measure("PDM::CalcShape2D", sSize, 2.0 * 3 * n * m + 15.0 * n, [&] {
+        pdm.CalcShape2D(shape, paramsLocal, paramsGlobal);
+    });
+    // The Jacobian itself, then its product with the weights
+    measure("PDM::ComputeJacobian", sSize, 2.0 * 3 * n * m + 2.0 * (6 + m) * (2 * n) * (2 * n), [&] {
+        pdm.ComputeJacobian(paramsLocal, paramsGlobal, jacobian, W, jacobianTW);
+    });
+}
+
+//--------------------------------------------------------------
+void ofApp::benchmarkCNN() {
+    // The layers of the landmark validator's CNN (frontal view), each fed the output of the one before, as in DetectionValidator::Check()
+    if (!isSelected({"CNN_utils::convolution_direct_blas", "CNN_utils::convolution_fft2", "CNN_utils::PReLU", "CNN_utils::max_pooling", "CNN_utils::fully_connected"})) {
+        return;
+    }
+    LandmarkDetector::DetectionValidator& validator = getModel(LandmarkDetector::FaceModelParameters::CECLM_DETECTOR).landmark_validator;
+    if (validator.cnn_layer_types.empty()) {
+        ofLogWarning("ofApp", "The model has no validator CNN, skipping the CNN layers.");
+        return;
+    }
+    const int nView = 0;
+    cv::Mat_<uchar> maskWarp = validator.paws[nView].pixel_mask;
+    cv::Mat_<float> input(maskWarp.rows, maskWarp.cols);
+    rng.fill(input, cv::RNG::NORMAL, 0.0f, 1.0f);
+    vector<cv::Mat_<float>> vInput = {input};
+    vector<cv::Mat_<float>> vOutput;
+    auto describe = [](const vector<cv::Mat_<float>>& v) { return ofToString(v.size()) + "x" + ofToString(v[0].rows) + "x" + ofToString(v[0].cols); };
+
+    int nConvolution = 0;
+    int nFullyConnected = 0;
+    for (size_t layer = 0; layer < validator.cnn_layer_types[nView].size(); layer++) {
+        int nType = validator.cnn_layer_types[nView][layer];
+        string sLayer = "layer " + ofToString(layer) + ", " + describe(vInput);
+        if (nType == 0) {
+            const cv::Mat_<float>& weights = validator.cnn_convolutional_layers_weights[nView][nConvolution];
+            const cv::Mat_<float>& kernel = validator.cnn_convolutional_layers[nView][nConvolution][0][0];
+            int nKernelHeight = kernel.rows;
+            int nKernelWidth = kernel.cols;
+            LandmarkDetector::convolution_direct_blas(vOutput, vInput, weights, nKernelHeight, nKernelWidth);
+            int nIn = vInput.size();
+            int nOut = vOutput.size();
+            double fFlops = 2.0 * vOutput[0].total() * nOut * nIn * nKernelHeight * nKernelWidth;
+            sLayer += " -> " + describe(vOutput) + ", " + ofToString(nKernelHeight) + "x" + ofToString(nKernelWidth) + " kernels";
+            measure("CNN_utils::convolution_direct_blas", sLayer, fFlops, [&] {
+                LandmarkDetector::convolution_direct_blas(vOutput, vInput, weights, nKernelHeight, nKernelWidth);
+            });
+
+            // The same shapes through the FFT path, with fixed-seed kernels laid out as it expects them (output -> input)
+            vector<vector<cv::Mat_<float>>> vKernels(nOut, vector<cv::Mat_<float>>(nIn));
+            for (auto& vIn : vKernels) {
+                for (auto& k : vIn) {
+                    k.create(nKernelHeight, nKernelWidth);
+                    rng.fill(k, cv::RNG::NORMAL, 0.0f, 0.1f);
+                }
+            }
+            vector<float> vBiases(nOut, 0.0f);
+            vector<map<int, vector<cv::Mat_<double>>>> vPrecomputed(MAX(nIn, nOut));
+            vector<cv::Mat_<float>> vOutputFFT;
+            // Counted as the direct convolution, for comparison
+            measure("CNN_utils::convolution_fft2", sLayer, fFlops, [&] {
+                LandmarkDetector::convolution_fft2(vOutputFFT, vInput, vKernels, vBiases, vPrecomputed);
+            });
+
+            // PReLU is not in the validator, measured on the same maps as in MTCNN, where it follows every convolution
+            cv::Mat_<float> preluWeights(1, nOut);
+            rng.fill(preluWeights, cv::RNG::UNIFORM, 0.0f, 0.5f);
+            // PReLU works in place, it starts from the same maps every time, the copy is not counted
+            vector<cv::Mat_<float>> vPReLU(vOutput.size());
+            measure("CNN_utils::PReLU", describe(vOutput), 2.0 * nOut * vOutput[0].total(), [&] {
+                LandmarkDetector::PReLU(vPReLU, preluWeights);
+            }, [&] {
+                for (size_t k = 0; k < vOutput.size(); k++) {
+                    vOutput[k].copyTo(vPReLU[k]);
+                }
+            });
+            nConvolution++;
+        } else if (nType == 1) {
+            LandmarkDetector::max_pooling(vOutput, vInput, 2, 2, 2, 2);
+            measure("CNN_utils::max_pooling", sLayer + " -> " + describe(vOutput), 0.0, [&] {
+                LandmarkDetector::max_pooling(vOutput, vInput, 2, 2, 2, 2);
+            });
+        } else if (nType == 2) {
+            // fully_connected() multiplies the weights with the flattened input, the stored orientation varies between models
+            cv::Mat_<float> weights = validator.cnn_fully_connected_layers_weights[nView][nFullyConnected];
+            size_t nInputs = vInput.size() * vInput[0].total();
+            if ((size_t)weights.cols != nInputs && (size_t)weights.cols != vInput.size()) {
+                weights = weights.t();
+            }
+            const cv::Mat_<float>& biases = validator.cnn_fully_connected_layers_biases[nView][nFullyConnected];
+            LandmarkDetector::fully_connected(vOutput, vInput, weights, biases);
+            measure("CNN_utils::fully_connected", sLayer + " -> " + describe(vOutput), 2.0 * weights.total(), [&] {
+                LandmarkDetector::fully_connected(vOutput, vInput, weights, biases);
+            });
+            nFullyConnected++;
+        } else if (nType == 3) {
+            // ReLU
+            vOutput.clear();
+            for (auto& m : vInput) {
+                cv::Mat_<float> out;
+                cv::threshold(m, out, 0, 0, cv::THRESH_TOZERO);
+                vOutput.push_back(out);
+            }
+        } else {
+            // Sigmoid, the last layer
+            vOutput = vInput;
+        }
+        vInput = vOutput;
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::benchmarkValidator() {
+    if (!isSelected({"PAW::Warp", "DetectionValidator::Check"})) {
+        return;
+    }
+    LandmarkDetector::CLNF& model = getModel(LandmarkDetector::FaceModelParameters::CECLM_DETECTOR);
+    LandmarkDetector::DetectionValidator& validator = model.landmark_validator;
+    LandmarkDetector::PDM& pdm = model.pdm;
+
+    // A frontal face of 200 pixels in a VGA frame of noise
+    cv::Mat_<uchar> gray(480, 640);
+    rng.fill(gray, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat_<float> paramsLocal(pdm.NumberOfModes(), 1, 0.0f);
+    cv::Vec6f paramsGlobal;
+    pdm.CalcParams(paramsGlobal, cv::Rect_<float>(220, 140, 200, 200), paramsLocal);
+    cv::Mat_<float> landmarks;
+    pdm.CalcShape2D(landmarks, paramsLocal, paramsGlobal);
+
+    if (!validator.paws.empty()) {
+        cv::Mat_<float> grayFloat;
+        gray.convertTo(grayFloat, CV_32F);
+        cv::Mat warped;
+        LandmarkDetector::PAW& paw = validator.paws[0];
+        measure("PAW::Warp", "640x480 to " + ofToString(paw.pixel_mask.cols) + "x" + ofToString(paw.pixel_mask.rows), 0.0, [&] {
+            paw.Warp(grayFloat, warped, landmarks);
+        });
+    }
+    measure("DetectionValidator::Check", "640x480, frontal", 0.0, [&] {
+        validator.Check(cv::Vec3d(0, 0, 0), gray, landmarks);
+    });
+}
+
+//--------------------------------------------------------------
+void ofApp::benchmarkFaceAnalyser() {
+    if (!isSelected({"FaceAnalysis::Extract_FHOG_descriptor", "SVR_static_lin_regressors::Predict", "SVM_static_lin::Predict"})) {
+        return;
+    }
+    // An aligned face as the face analyser makes them, 112x112 pixels
+    cv::Mat face(112, 112, CV_8UC3);
+    rng.fill(face, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat_<double> descriptor;
+    int nRows = 0;
+    int nCols = 0;
+    FaceAnalysis::Extract_FHOG_descriptor(descriptor, face, nRows, nCols);
+    measure("FaceAnalysis::Extract_FHOG_descriptor", "112x112, 8 pixel cells", 0.0, [&] {
+        FaceAnalysis::Extract_FHOG_descriptor(descriptor, face, nRows, nCols);
+    });
+
+    // The static linear predictors of AU01, on the descriptor and on random geometry features
+    auto read = [this, &descriptor](const string& sFile, function<void(std::ifstream&)> readModel, cv::Mat_<double>& hog, cv::Mat_<double>& geometry) {
+        std::ifstream stream(ofToDataPath(sFile, true), std::ios::in | std::ios::binary);
+        if (!stream.is_open()) {
+            ofLogWarning("ofApp", "No predictor at '" + sFile + "'");
+            return false;
+        }
+        // The predictor type, as FaceAnalyser::ReadRegressor() skips it, then the model. Its means tell the number of features.
+        int nType = 0;
+        stream.read((char*)&nType, sizeof(nType));
+        std::streampos posModel = stream.tellg();
+        cv::Mat means;
+        FaceAnalysis::ReadMatBin(stream, means);
+        int nGeometry = (int)means.total() - (int)descriptor.total();
+        if (nGeometry < 0) {
+            ofLogWarning("ofApp", "'" + sFile + "' expects " + ofToString(means.total()) + " features, fewer than the descriptor has.");
+            return false;
+        }
+        stream.seekg(posModel);
+        readModel(stream);
+        hog = descriptor.reshape(1, 1);
+        geometry.create(1, nGeometry);
+        rng.fill(geometry, cv::RNG::NORMAL, 0.0, 1.0);
+        return true;
+    };
+    vector<string> vNames = {"AU01"};
+    vector<double> vPredictions;
+    vector<string> vPredictionNames;
+
+    FaceAnalysis::SVR_static_lin_regressors svr;
+    cv::Mat_<double> hog, geometry;
+    if (read("AU_predictors/svr_combined/AU_1_static_intensity_comb.dat", [&](std::ifstream& s) { svr.Read(s, vNames); }, hog, geometry)) {
+        measure("SVR_static_lin_regressors::Predict", ofToString(hog.total() + geometry.total()) + " features, 1 AU", 3.0 * (hog.total() + geometry.total()), [&] {
+            svr.Predict(vPredictions, vPredictionNames, hog, geometry);
+        });
+    }
+    FaceAnalysis::SVM_static_lin svm;
+    if (read("AU_predictors/svm_combined/AU_1_static.dat", [&](std::ifstream& s) { svm.Read(s, vNames); }, hog, geometry)) {
+        measure("SVM_static_lin::Predict", ofToString(hog.total() + geometry.total()) + " features, 1 AU", 3.0 * (hog.total() + geometry.total()), [&] {
+            svm.Predict(vPredictions, vPredictionNames, hog, geometry);
+        });
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::saveResults() {
+    ofJson json;
+    json["seed"] = OFAPP_RANDOM_SEED;
+    json["samples"] = nSamples;
+    json["minSampleMs"] = nMinSampleMs;
+    string sCsv = "kernel,size,nsPerOp,nsPerOpMin,flopsPerOp,gflops\n";
+    for (auto& r : vResults) {
+        ofJson jsonResult;
+        jsonResult["kernel"] = r.sName;
+        jsonResult["size"] = r.sSize;
+        jsonResult["nsPerOp"] = r.fNsPerOp;
+        jsonResult["nsPerOpMin"] = r.fNsPerOpMin;
+        jsonResult["flopsPerOp"] = r.fFlopsPerOp;
+        jsonResult["gflops"] = r.getGFlops();
+        jsonResult["samplesNsPerOp"] = r.vSamplesNsPerOp;
+        json["results"].push_back(jsonResult);
+        sCsv += r.sName + ",\"" + r.sSize + "\"," + ofToString(r.fNsPerOp) + "," + ofToString(r.fNsPerOpMin) + "," + ofToString(r.fFlopsPerOp) + "," + ofToString(r.getGFlops()) + "\n";
+    }
+    ofSavePrettyJson(sOutput + ".json", json);
+    ofBuffer buffer;
+    buffer.set(sCsv);
+    ofBufferToFile(sOutput + ".csv", buffer);
+    ofLogNotice("ofApp", ofToString(vResults.size()) + " kernels measured, saved to " + sOutput + ".json and " + sOutput + ".csv");
+}
+
+//--------------------------------------------------------------
+bool ofApp::parseArguments() {
+    for (size_t i = 0; i < vArgs.size(); i++) {
+        const string& sArg = vArgs[i];
+        if (i + 1 >= vArgs.size()) {
+            ofLogError("ofApp", "Unknown argument or missing value: '" + sArg + "'");
+            return false;
+        } else if (sArg == "--output") {
+            sOutput = vArgs[++i];
+        } else if (sArg == "--data") {
+            ofSetDataPathRoot(ofFilePath::getAbsolutePath(vArgs[++i], false));
+        } else if (sArg == "--filter") {
+            sFilter = vArgs[++i];
+        } else if (sArg == "--min-sample-ms") {
+            nMinSampleMs = MAX(ofToInt(vArgs[++i]), 1);
+        } else if (sArg == "--samples") {
+            nSamples = MAX(ofToInt(vArgs[++i]), 1);
+        } else if (sArg == "--window") {
+            nWindowSize = MAX(ofToInt(vArgs[++i]), 1);
+        } else {
+            ofLogError("ofApp", "Unknown argument: '" + sArg + "'");
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::printUsage() {
+    ofLogNotice("ofApp") << "Usage: example-microbenchmark [options]\n"
+        << "  --output <name>         results in <name>.json and <name>.csv in the data folder (microbenchmark)\n"
+        << "  --data <path>           the data folder holding model/ and AU_predictors/, e.g. ../../example/bin/data\n"
+        << "  --filter <text>         only the kernels whose name contains it, e.g. CNN_utils\n"
+        << "  --min-sample-ms <n>     the least time of each sample (100)\n"
+        << "  --samples <n>           samples per kernel, the median is reported (5)\n"
+        << "  --window <n>            the response map size of the patch experts (11)";
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOpenFace.h"
+
+// Times the compute kernels of the landmark detector and the face analyser one by one, on the loaded models' own weights
+// and fixed-seed inputs of the sizes used while tracking, and reports ns/op and GFLOP/s as JSON and CSV.
+class ofApp : public ofBaseApp{
+
+	public:
+		ofApp(const vector<string>& vArgs);
+		void setup();
+		void update();
+
+    private:
+        struct Result {
+            string      sName;
+            string      sSize; // what the kernel ran on
+            double      fNsPerOp = 0.0;
+            double      fNsPerOpMin = 0.0;
+            double      fFlopsPerOp = 0.0; // 0 when a flop count means nothing for the kernel
+            vector<double> vSamplesNsPerOp; // every sample, for the comparisons
+            double getGFlops() const { return fNsPerOp > 0.0 ? fFlopsPerOp / fNsPerOp : 0.0; }
+        };
+
+        bool parseArguments();
+        // Whether --filter keeps any of the kernels
+        bool isSelected(const vector<string>& vNames) const;
+        // The landmark model, without face detectors, loaded the first time a kernel needs it
+        LandmarkDetector::CLNF& getModel(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks);
+        // Runs op until each of the samples lasts nMinSampleMs, keeps the median and the fastest sample.
+        // restore, when given, runs before every op to give it the same input, the time it takes alone is subtracted.
+        void measure(const string& sName, const string& sSize, double fFlopsPerOp, function<void()> op, function<void()> restore = nullptr);
+        void benchmarkPatchExperts();
+        void benchmarkPDM();
+        void benchmarkCNN();
+        void benchmarkValidator();
+        void benchmarkFaceAnalyser();
+        void saveResults();
+        static void printUsage();
+
+        vector<string>                  vArgs;
+        string                          sOutput = "microbenchmark";
+        string                          sFilter; // only the kernels whose name contains it
+        int                             nMinSampleMs = 100;
+        int                             nSamples = 5;
+        int                             nWindowSize = 11; // of the response maps, as while tracking
+        cv::RNG                         rng; // fixed seed, every run sees the same inputs
+        vector<Result>                  vResults;
+        map<int, unique_ptr<LandmarkDetector::CLNF>> models; // by landmark detector
+};
@@ -0,0 +1,134 @@
+#include "ofApp.h"
+
+ofApp::ofApp(const vector<string>& vArgsValue) {
+    vArgs = vArgsValue;
+}
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+    if (!parseArguments()) {
+        printUsage();
+        ofExit(1);
+        return;
+    }
+    bool bOk = true;
+    for (auto& sModel : vModels) {
+        bOk = compile(ofFilePath::getAbsolutePath(sModel)) && bOk;
+    }
+    ofExit(bOk ? 0 : 1);
+}
+
+//--------------------------------------------------------------
+void ofApp::update(){
+}
+
+//--------------------------------------------------------------
+bool ofApp::compile(const string& sModelPath) {
+    if (!ofFile::doesFileExist(sModelPath, false)) {
+        ofLogError("ofApp", "Could not find '" + sModelPath + "'");
+        return false;
+    }
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    unique_ptr<LandmarkDetector::CLNF> pModel(new LandmarkDetector::CLNF(sModelPath));
+    float fReadMs = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f;
+    if (!pModel->loaded_successfully) {
+        ofLogError("ofApp", "Could not read the model '" + sModelPath + "'");
+        return false;
+    }
+
+    string sBundlePath = ofxOpenFaceModelBundle::getBundlePath(sModelPath);
+    if (!ofxOpenFaceModelBundle::write(*pModel, sBundlePath)) {
+        return false;
+    }
+
+    // Back from disk, checksums and all
+    nTimeStartUs = ofGetElapsedTimeMicros();
+    unique_ptr<LandmarkDetector::CLNF> pBundled(ofxOpenFaceModelBundle::load(sBundlePath, true));
+    float fMapMs = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f;
+    if (!pBundled || !isSame(*pModel, *pBundled)) {
+        ofLogError("ofApp", "The bundle '" + sBundlePath + "' does not hold the model it was compiled from.");
+        ofFile::removeFile(sBundlePath, false);
+        return false;
+    }
+    ofLogNotice("ofApp", ofFilePath::getFileName(sModelPath) + ": read in " + ofToString(fReadMs, 1) + " ms, mapped and verified in " + ofToString(fMapMs, 1) + " ms");
+    return true;
+}
+
+//--------------------------------------------------------------
+bool ofApp::isSame(const LandmarkDetector::CLNF& a, const LandmarkDetector::CLNF& b) {
+    // Spot checks of every part, the bundle's layout checksum covers the rest of the structure
+    if (!isSame(a.pdm.mean_shape, b.pdm.mean_shape) || !isSame(a.pdm.princ_comp, b.pdm.princ_comp)
+        || a.patch_experts.patch_scaling != b.patch_experts.patch_scaling || a.patch_experts.centers.size() != b.patch_experts.centers.size()
+        || a.landmark_validator.paws.size() != b.landmark_validator.paws.size() || a.hierarchical_models.size() != b.hierarchical_models.size()
+        || a.eye_model != b.eye_model) {
+        return false;
+    }
+    auto& ccnf = a.patch_experts.ccnf_expert_intensity;
+    auto& cen = a.patch_experts.cen_expert_intensity;
+    if (!ccnf.empty() && !ccnf[0].empty() && !ccnf[0][0].empty() && !ccnf[0][0][0].neurons.empty()
+        && !isSame(ccnf[0][0][0].neurons[0].weights, b.patch_experts.ccnf_expert_intensity[0][0][0].neurons[0].weights)) {
+        return false;
+    }
+    if (!cen.empty() && !cen[0].empty() && !cen[0][0].empty() && !cen[0][0][0].weights.empty()
+        && !isSame(cen[0][0][0].weights.back(), b.patch_experts.cen_expert_intensity[0][0][0].weights.back())) {
+        return false;
+    }
+    if (!a.landmark_validator.mean_images.empty() && !isSame(a.landmark_validator.mean_images[0], b.landmark_validator.mean_images[0])) {
+        return false;
+    }
+    for (size_t i = 0; i < a.hierarchical_models.size(); i++) {
+        if (!isSame(a.hierarchical_models[i], b.hierarchical_models[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool ofApp::isSame(const cv::Mat& a, const cv::Mat& b) {
+    if (a.size() != b.size() || a.type() != b.type()) {
+        return false;
+    }
+    return a.empty() || cv::norm(a, b, cv::NORM_INF) == 0.0;
+}
+
+//--------------------------------------------------------------
+bool ofApp::parseArguments() {
+    for (size_t i = 0; i < vArgs.size(); i++) {
+        const string& sArg = vArgs[i];
+        if (i + 1 >= vArgs.size()) {
+            ofLogError("ofApp", "Unknown argument or missing value: '" + sArg + "'");
+            return false;
+        } else if (sArg == "--data") {
+            ofSetDataPathRoot(ofFilePath::getAbsolutePath(vArgs[++i], false));
+        } else if (sArg == "--models") {
+            for (auto& s : ofSplitString(ofToUpper(vArgs[++i]), ",", true, true)) {
+                if (s == "CLM") {
+                    vModels.push_back(OFX_OPENFACE_MODEL_SVRCLM);
+                } else if (s == "CLNF") {
+                    vModels.push_back(OFX_OPENFACE_MODEL_CLNF);
+                } else if (s == "CECLM" || s == "CE-CLM") {
+                    vModels.push_back(OFX_OPENFACE_MODEL_CECLM);
+                } else {
+                    ofLogError("ofApp", "Unknown landmark model '" + s + "'");
+                    return false;
+                }
+            }
+        } else {
+            ofLogError("ofApp", "Unknown argument: '" + sArg + "'");
+            return false;
+        }
+    }
+    if (vModels.empty()) {
+        vModels = {OFX_OPENFACE_MODEL_SVRCLM, OFX_OPENFACE_MODEL_CLNF, OFX_OPENFACE_MODEL_CECLM};
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::printUsage() {
+    ofLogNotice("ofApp") << "Usage: example-model-bundle [options]\n"
+        << "  --data <path>         the data folder holding model/, e.g. ../../example/bin/data\n"
+        << "  --models <list>       CLM,CLNF,CECLM (all)\n"
+        << "  Compile again after changing the model files, older bundles are ignored.";
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOpenFace.h"
+
+// Compiles the landmark models into bundles next to their text files, model/main_ceclm_general.bundle and so on,
+// which ofxOpenFace maps instead of reading the text files from then on. Each bundle is loaded back and checked against the model.
+class ofApp : public ofBaseApp{
+
+	public:
+		ofApp(const vector<string>& vArgs);
+		void setup();
+		void update();
+
+    private:
+        bool parseArguments();
+        bool compile(const string& sModelPath);
+        static bool isSame(const LandmarkDetector::CLNF& a, const LandmarkDetector::CLNF& b);
+        static bool isSame(const cv::Mat& a, const cv::Mat& b);
+        static void printUsage();
+
+        vector<string>                  vArgs;
+        vector<string>                  vModels;
+};
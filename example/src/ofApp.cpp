@@ -92,7 +92,28 @@ void ofApp::setup(){
     camSettings.fy = settings.fy;
     camSettings.cx = settings.cx;
     camSettings.cy = settings.cy;
+    openFace.setPipelined(settings.bPipelined);
+    openFace.setAsyncDetection(settings.bAsyncDetection);
+    openFace.setMotionGating(settings.bMotionGating, settings.nMaxReuseFrames);
+    if (settings.sDetectionSchedule == "budget") {
+        openFace.setDetectionScheduler(make_shared<ofxOpenFaceDetectionSchedulerTimeBudget>(20.0f));
+    } else if (settings.sDetectionSchedule == "adaptive") {
+        openFace.setDetectionScheduler(make_shared<ofxOpenFaceDetectionSchedulerAdaptive>());
+    } else {
+        openFace.setDetectionScheduler(make_shared<ofxOpenFaceDetectionSchedulerCadence>(8));
+    }
+    openFace.setFacePool(settings.nMaxFacesHard);
+    openFace.setTargetFrameMs(settings.fTargetFrameMs);
+    openFace.setFaceScheduling(settings.nFitsPerFrame);
+    openFace.setReacquisition(settings.bReacquisition, settings.nKillAfterDisappearedMs);
+    openFace.setFlowTracking(settings.bFlowTracking);
+    openFace.setLoadProgressCallback([](const ofxOpenFaceModelLoader::Progress& progress) {
+        ofLogNotice("ofApp", "Loaded " + ofxOpenFaceModelLoader::ComponentToString(progress.eComponent) + " (" + ofToString(progress.nDone) + "/" + ofToString(progress.nTotal) + ")");
+    });
     openFace.setup(settings.bMultipleFaces, settings.nCameraWidth, settings.nCameraHeight, settings.eDetectorFace, settings.eDetectorLandmarks, camSettings, settings.nTrackingPersistenceMs, settings.nTrackingTolerancePx, settings.nMaxFaces);
+    if (settings.bMultipleFaces && settings.bWarmUp) {
+        openFace.warmUp();
+    }
     ofxOpenFace::s_fCertaintyNorm = settings.fCertaintyNorm;
     ofxOpenFace::s_nKillAfterDisappearedMs = settings.nKillAfterDisappearedMs;
     
@@ -164,6 +185,28 @@ void ofApp::draw(){
     ofSetColor(ofColor::red);
     ofDrawBitmapString(ofToString((int)ofGetFrameRate()) + " FPS (app)", 40, 40);
     ofDrawBitmapString(ofToString(openFace.getFPS()) + " FPS (tracking)", 40, 60);
+    ofDrawBitmapString(ofToString(openFace.getHandoffLatencyUs()) + " us handoff (max " + ofToString(openFace.getHandoffLatencyMaxUs()) + " us)", 40, 80);
+    ofxOpenFace::LatencyBreakdown l = openFace.getLatencyBreakdown();
+    ofDrawBitmapString(ofToString(l.fTotalMs, 1) + " ms latency (detection " + ofToString(l.fDetectorMs, 1) + " ms, fitting " + ofToString(l.fFittingMs, 1) + " ms)", 40, 100);
+    if (openFace.getDetectionScheduler()) {
+        ofxOpenFaceDetectionScheduler::Stats stats = openFace.getDetectionScheduler()->getStats();
+        ofDrawBitmapString("Detector on " + ofToString(stats.getFiredPercent(), 1) + "% of frames, " + ofToString(stats.getDetectionMsMean(), 1) + " ms per run, " + ofToString(openFace.getDetectionScannedPercent(), 0) + "% of the pixels scanned", 40, 120);
+    }
+    if (settings.bMotionGating) {
+        ofxOpenFace::MotionStats stats = openFace.getMotionStats();
+        ofDrawBitmapString("Static: " + ofToString(stats.nGrayConversionsSkipped) + " frames, " + ofToString(stats.nFitsReused) + " fits reused, " + ofToString(stats.nDetectionsSkipped) + " detections skipped", 40, 140);
+    }
+    if (settings.nFitsPerFrame > 0) {
+        ofxOpenFace::MotionStats stats = openFace.getMotionStats();
+        ofDrawBitmapString("Scheduled: " + ofToString(stats.nFits) + " fits, " + ofToString(stats.nFitsPredicted) + " faces extrapolated", 40, 160);
+    }
+    if (settings.bMultipleFaces && settings.bReacquisition) {
+        ofDrawBitmapString("Lost faces: " + openFace.getReacquisitionStats().toString(), 40, 180);
+    }
+    if (settings.bMultipleFaces && settings.bFlowTracking) {
+        ofxOpenFace::MotionStats stats = openFace.getMotionStats();
+        ofDrawBitmapString("Optical flow: " + ofToString(stats.nFitsFlow) + " faces carried over, " + ofToString(stats.nFits) + " fits", 40, 200);
+    }
     
     gui.draw();
 }
@@ -193,6 +236,20 @@ void ofApp::keyPressed(int key){
     } else if (key == 'h') {
         // Disable OpenFace
         bOpenFaceEnabled = !bOpenFaceEnabled;
+    } else if (key == 's') {
+        // Print the timings of each stage and start over
+        ofLogNotice("ofApp", "\n" + openFace.getStats().toString());
+        ofLogNotice("ofApp", openFace.getExpertResidency().toString());
+        openFace.resetStats();
+    } else if (key == 't') {
+        // Start recording a trace, save it when stopping
+        bTracing = !bTracing;
+        if (bTracing) {
+            openFace.clearTrace();
+        } else {
+            openFace.saveTrace("trace_" + ofGetTimestampString() + ".json");
+        }
+        openFace.setTracing(bTracing);
     }
 }
 
@@ -257,6 +314,17 @@ void ofApp::loadSettings() {
     settings.bDoCvTracking = s.getValue("settings:tracking:doCvTracking", true);
     settings.bMultipleFaces = s.getValue("settings:tracking:multipleFaces", true);
     settings.nMaxFaces = s.getValue("settings:tracking:maxFaces", 4);
+    settings.nMaxFacesHard = s.getValue("settings:tracking:maxFacesHard", -1);
+    settings.fTargetFrameMs = s.getValue("settings:tracking:targetFrameMs", 0.0f);
+    settings.nFitsPerFrame = s.getValue("settings:tracking:fitsPerFrame", 0);
+    settings.bReacquisition = s.getValue("settings:tracking:reacquisition", true);
+    settings.bFlowTracking = s.getValue("settings:tracking:flowTracking", false);
+    settings.bPipelined = s.getValue("settings:tracking:pipelined", false);
+    settings.bAsyncDetection = s.getValue("settings:tracking:asyncDetection", false);
+    settings.sDetectionSchedule = s.getValue("settings:tracking:detector:schedule", "cadence");
+    settings.bMotionGating = s.getValue("settings:tracking:motion:gating", false);
+    settings.nMaxReuseFrames = s.getValue("settings:tracking:motion:maxReuseFrames", 15);
+    settings.bWarmUp = s.getValue("settings:tracking:warmUp", true);
     settings.nTrackingPersistenceMs = s.getValue("settings:tracking:persistenceMs", 30);
     settings.nTrackingTolerancePx = s.getValue("settings:tracking:tolerancePixels", 200);
     settings.nKillAfterDisappearedMs = s.getValue("settings:tracking:killAfterDisappearedMs", 3000);
@@ -279,8 +347,19 @@ void ofApp::saveSettings() {
     s.setValue("settings:tracking:doCvTracking", settings.bDoCvTracking);
     s.setValue("settings:tracking:multipleFaces", settings.bMultipleFaces);
     s.setValue("settings:tracking:maxFaces", settings.nMaxFaces);
+    s.setValue("settings:tracking:maxFacesHard", settings.nMaxFacesHard);
+    s.setValue("settings:tracking:targetFrameMs", settings.fTargetFrameMs);
+    s.setValue("settings:tracking:fitsPerFrame", settings.nFitsPerFrame);
+    s.setValue("settings:tracking:reacquisition", settings.bReacquisition);
+    s.setValue("settings:tracking:flowTracking", settings.bFlowTracking);
+    s.setValue("settings:tracking:pipelined", settings.bPipelined);
+    s.setValue("settings:tracking:asyncDetection", settings.bAsyncDetection);
     s.setValue("settings:tracking:detector:face", (int)settings.eDetectorFace);
     s.setValue("settings:tracking:detector:landmarks", (int)settings.eDetectorLandmarks);
+    s.setValue("settings:tracking:detector:schedule", settings.sDetectionSchedule);
+    s.setValue("settings:tracking:motion:gating", settings.bMotionGating);
+    s.setValue("settings:tracking:motion:maxReuseFrames", settings.nMaxReuseFrames);
+    s.setValue("settings:tracking:warmUp", settings.bWarmUp);
     s.setValue("settings:tracking:persistenceMs", settings.nTrackingPersistenceMs);
     s.setValue("settings:tracking:tolerancePixels", settings.nTrackingTolerancePx);
     s.setValue("settings:tracking:killAfterDisappearedMs", settings.nKillAfterDisappearedMs);
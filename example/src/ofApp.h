@@ -16,6 +16,17 @@ class appSettings {
         bool bMultipleFaces;
         bool bDoCvTracking; // true: perform ofxCv tracking of the face for time alive
         int nMaxFaces;
+        int nMaxFacesHard; // a crowd may take the face pool up to that, -1 to stay at nMaxFaces
+        float fTargetFrameMs; // lower the fitting quality while frames take longer than that, 0 for full quality
+        int nFitsPerFrame; // tracked faces fitted per frame, the others are extrapolated, 0 for all of them
+        bool bReacquisition; // true: a face lost a moment ago is tracked again from its last shape
+        bool bFlowTracking; // true: the faces that barely move are carried over by optical flow between fits
+        bool bPipelined; // true: overlap detection of the next frame with tracking of the current one
+        bool bAsyncDetection; // true: detect new faces on their own thread while the locked ones are tracked
+        string sDetectionSchedule; // when to look for new faces: "cadence", "budget" or "adaptive"
+        bool bMotionGating; // true: skip detection and fitting where nothing moves
+        int nMaxReuseFrames; // frames a static face may keep its previous result
+        bool bWarmUp; // true: fill the models' caches at setup instead of on the first frames
         int nTrackingPersistenceMs; // time allowed for tracking to forget an object
         int nTrackingTolerancePx; // pixels allowed to move for tracking to changes
         float fCertaintyNorm; // normalized certainty below which we do not recognize a face
@@ -90,6 +101,7 @@ class ofApp : public ofBaseApp{
         // Some options
         bool                                    bDrawFaces; // draw the faces
         bool                                    bOpenFaceEnabled; // false: disable OpenFace
+        bool                                    bTracing = false; // true: record a trace of the processing
     
         // A video player
         ofVideoPlayer                           videoPlayer;
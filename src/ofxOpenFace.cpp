@@ -1,5 +1,7 @@
 #include "ofxOpenFace.h"
+#include "ofxOpenFaceEngine.h"
 #include <Face_utils.h>
+#include "tbb/flow_graph.h"
 
 ofEvent<ofxOpenFaceDataSingleFace> ofxOpenFace::eventOpenFaceDataSingleRaw = ofEvent<ofxOpenFaceDataSingleFace>();
 ofEvent<vector<ofxOpenFaceDataSingleFace>> ofxOpenFace::eventOpenFaceDataMultipleRaw = ofEvent<vector<ofxOpenFaceDataSingleFace>>();
@@ -7,6 +9,35 @@ ofEvent<ofxOpenFaceDataSingleFaceTracked> ofxOpenFace::eventOpenFaceDataSingleTr
 ofEvent<bool> ofxOpenFace::eventOpenFaceDataClear = ofEvent<bool>();
 ofEvent<vector<ofxOpenFaceDataSingleFaceTracked>> ofxOpenFace::eventOpenFaceDataMultipleTracked = ofEvent<vector<ofxOpenFaceDataSingleFaceTracked>>();
 
+// The stages of the pipelined engine: while a frame is being fitted and tracked, the next ones are converted and searched for faces
+struct ofxOpenFace::Pipeline {
+    tbb::flow::graph                                                graph;
+    tbb::flow::function_node<FrameJob*, FrameJob*>                  nodeGray;
+    tbb::flow::sequencer_node<FrameJob*>                            nodeOrder; // motion, fitting and tracking need the frames in order
+    tbb::flow::function_node<FrameJob*, FrameJob*>                  nodeDetect;
+    tbb::flow::function_node<FrameJob*, FrameJob*>                  nodeFit;
+    tbb::flow::function_node<FrameJob*, tbb::flow::continue_msg>    nodePublish;
+    vector<FrameJob>                                                vJobs; // one per frame in flight
+    
+    Pipeline(ofxOpenFace* pOwner, int nFramesInFlight) :
+        nodeGray(graph, tbb::flow::unlimited, [pOwner](FrameJob* pJob) { pOwner->convertGray(*pJob); return pJob; }),
+        nodeOrder(graph, [](FrameJob* pJob) { return (size_t)pJob->nSequence; }),
+        nodeDetect(graph, tbb::flow::serial, [pOwner](FrameJob* pJob) { pOwner->detectFaces(*pJob); return pJob; }),
+        nodeFit(graph, tbb::flow::serial, [pOwner](FrameJob* pJob) { pOwner->fitLandmarks(*pJob); return pJob; }),
+        nodePublish(graph, tbb::flow::serial, [pOwner](FrameJob* pJob) {
+            pOwner->publishMultipleFaces(*pJob);
+            pOwner->finishPipelineFrame();
+            return tbb::flow::continue_msg();
+        }),
+        vJobs(nFramesInFlight)
+    {
+        tbb::flow::make_edge(nodeGray, nodeOrder);
+        tbb::flow::make_edge(nodeOrder, nodeDetect);
+        tbb::flow::make_edge(nodeDetect, nodeFit);
+        tbb::flow::make_edge(nodeFit, nodePublish);
+    }
+};
+
 ofxOpenFace::CameraSettings ofxOpenFace::s_camSettings;
 float ofxOpenFace::s_fCertaintyNorm = 0.4f; // the normalized certainty below which we ignore a face
 float ofxOpenFace::s_nKillAfterDisappearedMs = 2000; // the time to wait before killing a face that has not reappared
@@ -42,7 +73,18 @@ ofxOpenFace::ofxOpenFace(){
 
 // Destructor
 ofxOpenFace::~ofxOpenFace(){
+    stop();
     waitForThread(true);
+    // The detector thread uses the model's detectors
+    detector.stop();
+    detector.waitForThread(true);
+    if (pEngine == nullptr) {
+        delete pFace_model;
+    }
+#ifdef OFX_OPENFACE_DO_FACE_ANALYSIS
+    delete pFace_analyser;
+    delete pFace_analysis_params;
+#endif
 }
 
 void ofxOpenFace::setup(bool bTrackMultipleFaces, int nWidth, int nHeight, LandmarkDetector::FaceModelParameters::FaceDetector eDetectorFace, LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks, CameraSettings settings, int persistenceMs, int maxDistancePx, int nMaxFacesTracked) {
@@ -50,7 +92,12 @@ void ofxOpenFace::setup(bool bTrackMultipleFaces, int nWidth, int nHeight, Landm
     nImgHeight = nHeight;
     bMultipleFaces = bTrackMultipleFaces;
     nMaxFaces = nMaxFacesTracked;
-    s_camSettings = settings;
+    camSettings = settings;
+    // The statics are for the faces without intrinsics of their own, only a standalone instance sets them as before
+    if (pEngine == nullptr) {
+        s_camSettings = settings;
+    }
+    mailbox.allocate(nImgWidth, nImgHeight, CV_8UC3);
     
     // Look for missing models
     ofFile fModelCLM = ofFile(OFX_OPENFACE_MODEL_SVRCLM);
@@ -88,28 +135,24 @@ void ofxOpenFace::setupSingleFace(LandmarkDetector::FaceModelParameters::Landmar
     
     det_parameters.curr_face_detector = eDetectorFace;
     det_parameters.curr_landmark_detector = eDetectorLandmarks;
+    det_parameters.refine_hierarchical = det_parameters.refine_hierarchical && (nOutputs & (OUTPUT_EYES_2D | OUTPUT_EYES_3D | OUTPUT_GAZE));
     if (eDetectorFace == LandmarkDetector::FaceModelParameters::FaceDetector::HOG_SVM_DETECTOR) {
         det_parameters.reinit_video_every = -1;
     }
     
-    if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CLNF_DETECTOR) {
-        ofFile fModel = ofFile(OFX_OPENFACE_MODEL_CLNF);
-        pFace_model = new LandmarkDetector::CLNF(fModel.getAbsolutePath());
-    } else if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CLM_DETECTOR) {
-        ofFile fModel = ofFile(OFX_OPENFACE_MODEL_SVRCLM);
-        pFace_model = new LandmarkDetector::CLNF(fModel.getAbsolutePath());
-    } else if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CECLM_DETECTOR) {
-        ofFile fModel = ofFile(OFX_OPENFACE_MODEL_CECLM);
-        pFace_model = new LandmarkDetector::CLNF(fModel.getAbsolutePath());
-    } else {
-        ofLogError("ofxOpenFace", "Unknown landmark detector '" + ofToString((int)eDetectorLandmarks) + "'. Defaulting to CLNF");
-        ofFile fModel = ofFile(OFX_OPENFACE_MODEL_CLNF);
-        pFace_model = new LandmarkDetector::CLNF(fModel.getAbsolutePath());
-    }
-    
-    if (!pFace_model->eye_model) {
-        ofLogError("ofxOpenFace", "No eye model found.");
-    }
+    // The landmark model alone, the single face detection reads its detectors itself
+    ofxOpenFaceModelLoader loader;
+    loader.setProgressCallback(loadProgressCallback);
+    loader.setComponents(true, false, false);
+    loader.load(eDetectorLandmarks);
+    loadReport = loader.getReport();
+    pFace_model = loader.pModel;
+}
+
+LandmarkDetector::CLNF* ofxOpenFace::loadModel(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks) {
+    ofxOpenFaceModelLoader loader;
+    loader.load(eDetectorLandmarks);
+    return loader.pModel;
 }
 
 void ofxOpenFace::setupMultipleFaces(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks, LandmarkDetector::FaceModelParameters::FaceDetector eDetectorFace) {
@@ -130,241 +173,661 @@ void ofxOpenFace::setupMultipleFaces(LandmarkDetector::FaceModelParameters::Land
     auto dp = LandmarkDetector::FaceModelParameters();
     dp.curr_face_detector = eDetectorFace;
     dp.curr_landmark_detector = eDetectorLandmarks;
-    if (eDetectorFace == LandmarkDetector::FaceModelParameters::FaceDetector::HOG_SVM_DETECTOR) {
-        dp.reinit_video_every = -1;
-    }
+    // The eye models only refine the eyes, not worth fitting without eye outputs
+    dp.refine_hierarchical = dp.refine_hierarchical && (nOutputs & (OUTPUT_EYES_2D | OUTPUT_EYES_3D | OUTPUT_GAZE));
+    // The face models have no detectors of their own, detection is done on the whole image by pFace_model
+    dp.reinit_video_every = -1;
     vDet_parameters.push_back(dp);
     
+    // The models, loaded side by side: the landmark model and its detectors unless they are the engine's, and the face analyser
+    ofxOpenFaceModelLoader loader;
+    loader.setProgressCallback(loadProgressCallback);
 #ifdef OFX_OPENFACE_DO_FACE_ANALYSIS
-    // The face analysis logic
-    string rootDir = ofFilePath::getAbsolutePath("");
-    ofLogNotice("ofxOpenFace", "Face analysis root dir: '" + rootDir + "'");
-    pFace_analysis_params = new FaceAnalysis::FaceAnalyserParameters(rootDir);
-    pFace_analysis_params->OptimizeForImages();
-    pFace_analyser = new FaceAnalysis::FaceAnalyser(*pFace_analysis_params);
-    
-    ofLogNotice("ofxOpenFace", "Face analysis model location: '" + pFace_analysis_params->getModelLoc() + "'");
-    
-    if (pFace_analyser->GetAUClassNames().size() == 0 && pFace_analyser->GetAUClassNames().size() == 0)
-    {
-        ofLogWarning("ofxOpenFace", "No Action Unit models found.");
-    }
+    loader.setComponents(pEngine == nullptr, pEngine == nullptr, (nOutputs & OUTPUT_AUS) != 0);
+#else
+    loader.setComponents(pEngine == nullptr, pEngine == nullptr, false);
+#endif
+    uint64_t nMemoryBeforeModel = ofxOpenFaceMemory::getResidentBytes();
+    loader.load(eDetectorLandmarks);
+    loadReport = loader.getReport();
+    pFace_model = pEngine != nullptr ? pEngine->getModel() : loader.pModel;
+#ifdef OFX_OPENFACE_DO_FACE_ANALYSIS
+    pFace_analysis_params = loader.pFaceAnalysisParams;
+    pFace_analyser = loader.pFaceAnalyser;
 #endif
     
-    // The modules that are being used for tracking
-    if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CLNF_DETECTOR) {
-        ofFile fModel = ofFile(OFX_OPENFACE_MODEL_CLNF);
-        pFace_model = new LandmarkDetector::CLNF(fModel.getAbsolutePath());
-    } else if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CLM_DETECTOR) {
-        ofFile fModel = ofFile(OFX_OPENFACE_MODEL_SVRCLM);
-        pFace_model = new LandmarkDetector::CLNF(fModel.getAbsolutePath());
-    } else if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CECLM_DETECTOR) {
-        ofFile fModel = ofFile(OFX_OPENFACE_MODEL_CECLM);
-        pFace_model = new LandmarkDetector::CLNF(fModel.getAbsolutePath());
+    // Which patch experts the faces use, the engine tracks its model for all its streams
+    if (pEngine != nullptr) {
+        pResidency = &pEngine->getResidency();
     } else {
-        ofLogError("ofxOpenFace", "Unknown landmark detector '" + ofToString((int)eDetectorLandmarks) + "'. Defaulting to CLNF");
-        ofFile fModel = ofFile(OFX_OPENFACE_MODEL_CLNF);
-        pFace_model = new LandmarkDetector::CLNF(fModel.getAbsolutePath());
+        residency.setup(*pFace_model);
     }
     
-    pFace_model->face_detector_HAAR.load(fDetectorHAAR.getAbsolutePath());
-    pFace_model->haar_face_detector_location = fDetectorHAAR.getAbsolutePath();
-    pFace_model->face_detector_MTCNN.Read(fDetectorMTCNN.getAbsolutePath());
-    pFace_model->mtcnn_face_detector_location = fDetectorMTCNN.getAbsolutePath();
-    
-    if (!pFace_model->loaded_successfully) {
-        ofLogError("ofxOpenFace", "The face model was not loaded successfully.");
+    // The face detection, streams of an engine take turns with its detectors
+    detector.setup(pFace_model, eDetectorFace, pEngine != nullptr ? &pEngine->getDetectorMutex() : nullptr);
+    detector.setStats(&stats);
+    detector.setTrace(&trace);
+    if (!pDetectionScheduler) {
+        pDetectionScheduler = make_shared<ofxOpenFaceDetectionSchedulerCadence>(8);
     }
-    
-    if (!pFace_model->eye_model) {
-        ofLogError("ofxOpenFace", "No eye model found.");
+    ofLogNotice("ofxOpenFace", "Face detection: " + pDetectionScheduler->getName());
+    motionMask.setup(nImgWidth, nImgHeight, nMotionTileSizePx, fMotionThreshold);
+    if (bAsyncDetection) {
+        detector.startThread();
     }
     
-    vFace_models.reserve(nMaxFaces);
-    vFace_models.push_back(*pFace_model);
-    vActiveModels.push_back(false);
+    // One face model per face, all sharing the weights of the loaded model.
+    // Building them briefly takes the detectors out of the model, the other streams of the engine must not detect meanwhile.
+    // Room for the whole pool, the face models must never move. It grows from the first one.
+    nMaxFaces = MAX(nMaxFaces, 1);
+    nMaxSlots = MAX(nMaxFacesHard, nMaxFaces);
+    vFace_models.reserve(nMaxSlots);
+    uint64_t nMemoryBeforeFaces = ofxOpenFaceMemory::getResidentBytes();
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    if (pEngine != nullptr) {
+        std::lock_guard<std::mutex> lock(pEngine->getDetectorMutex());
+        ofxOpenFaceSharedModel::appendFaceModels(*pFace_model, nMaxFaces, vFace_models);
+    } else {
+        ofxOpenFaceSharedModel::appendFaceModels(*pFace_model, nMaxFaces, vFace_models);
+    }
+    uint64_t nTimeFacesUs = ofGetElapsedTimeMicros() - nTimeStartUs;
+    uint64_t nMemoryAfterFaces = ofxOpenFaceMemory::getResidentBytes();
+    nSlots = vFace_models.size();
+    // Sized for the whole pool, the detection reads which slots are free while the fitting grows it
+    vActiveModels.resize(nMaxSlots);
+    vActiveModels[0] = false;
+    vDataPrevious.resize(nMaxSlots);
+    vReuseFrames.resize(nMaxSlots, 0);
+    vSlotFreeSinceMs.resize(nMaxSlots, 0);
+    vFramesSinceFit.resize(nMaxSlots, 0);
+    vVelocity.resize(nMaxSlots);
+    vLastFitCenter.resize(nMaxSlots);
     
-    for (int i=1; i < nMaxFaces; i++) {
-        vFace_models.push_back(*pFace_model);
-        vActiveModels.push_back(false);
+    for (int i=1; i < nMaxSlots; i++) {
+        vActiveModels[i] = false;
         vDet_parameters.push_back(dp);
     }
+    quality.setup(dp, nMaxSlots);
+    fitPredictor.setup(nMaxSlots);
+    reacquisition.setup(nMaxSlots);
+    flowTracker.setup(nMaxSlots);
+    
+    // Report what a face costs compared to the whole model
+    int64_t nModelBytes = (int64_t)nMemoryBeforeFaces - (int64_t)nMemoryBeforeModel;
+    int64_t nFaceBytes = ((int64_t)nMemoryAfterFaces - (int64_t)nMemoryBeforeFaces) / max(nMaxFaces, 1);
+    ofLogNotice("ofxOpenFace", "Models: " + ofxOpenFaceMemory::toString(nModelBytes) + ", " + ofToString(nMaxFaces) + " face models: " + ofxOpenFaceMemory::toString(nFaceBytes) + " and " + ofToString(nTimeFacesUs / max(nMaxFaces, 1)) + " us per face");
+    // Before, each face model was a deep copy: it cloned all the weights (and the face detectors on top)
+    ofLogNotice("ofxOpenFace", "Face model weights: " + ofxOpenFaceMemory::toString(ofxOpenFaceSharedModel::getWeightBytes(*pFace_model)) + " shared by every face model instead of copied per face");
+    if (ofxOpenFaceSharedModel::hasDetectors(vFace_models[0])) {
+        ofLogWarning("ofxOpenFace", "The face models carry face detectors of their own");
+    }
+    if (nMaxSlots > nMaxFaces) {
+        ofLogNotice("ofxOpenFace", "Face pool: " + ofToString(nMaxFaces) + " slots kept, up to " + ofToString(nMaxSlots) + " in a crowd");
+    }
 }
 
-ofxOpenFaceDataSingleFace ofxOpenFace::processImageSingleFace() {
+ofxOpenFaceDataSingleFace ofxOpenFace::processImageSingleFace(const cv::Mat& rgb_image, uint64_t nFrameNumber) {
+    ofxOpenFaceTrace::Scope span(trace, "processImageSingleFace", nFrameNumber, 0);
     // Reading the images
-    mutexImage.lock();
-    cv::Mat rgb_image = matToProcessColor;
-    cv::Mat grayscale_image;
-    ofxCv::copyGray(rgb_image, grayscale_image);
-    mutexImage.unlock();
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    ofxCv::copyGray(rgb_image, matGray);
+    cv::Mat& grayscale_image = matGray;
+    stats.recordSince(ofxOpenFaceStats::STAGE_GRAY, nTimeStartUs);
     
     // The actual facial landmark detection / tracking
     ofxOpenFaceDataSingleFace faceData;
+    nTimeStartUs = ofGetElapsedTimeMicros();
     faceData.detected = LandmarkDetector::DetectLandmarksInVideo(rgb_image, *pFace_model, det_parameters, grayscale_image);
+    stats.recordSince(ofxOpenFaceStats::STAGE_LANDMARKS, nTimeStartUs);
+    trace.record("DetectLandmarksInVideo", nTimeStartUs, ofGetElapsedTimeMicros(), nFrameNumber, 0);
      
-    // If tracking succeeded and we have an eye model, estimate gaze
-    if (faceData.detected && pFace_model->eye_model)
-    {
-        GazeAnalysis::EstimateGaze(*pFace_model, faceData.gazeLeftEye, s_camSettings.fx, s_camSettings.fy, s_camSettings.cx, s_camSettings.cy, true);
-        GazeAnalysis::EstimateGaze(*pFace_model, faceData.gazeRightEye, s_camSettings.fx, s_camSettings.fy, s_camSettings.cx, s_camSettings.cy, false);
-    }
+    // Gaze, eyes, pose and landmarks, the ones asked for
     faceData.certainty = pFace_model->detection_certainty;
-
-    // Work out the pose of the head from the tracked model
-    faceData.pose = LandmarkDetector::GetPose(*pFace_model, s_camSettings.fx, s_camSettings.fy, s_camSettings.cx, s_camSettings.cy);
-    faceData.eyeLandmarks2D = LandmarkDetector::CalculateAllEyeLandmarks(*pFace_model);
-    faceData.eyeLandmarks3D = LandmarkDetector::Calculate3DEyeLandmarks(*pFace_model, s_camSettings.fx, s_camSettings.fy, s_camSettings.cx, s_camSettings.cy);
-    faceData.allLandmarks2D = LandmarkDetector::CalculateAllLandmarks(*pFace_model);
     faceData.sFaceID = ofToString(1);
-    
-    // Figure out the bounding box of all landmarks
-    vector<ofPoint> vLandmarks2D;
-    for (auto& l : faceData.allLandmarks2D) {
-        vLandmarks2D.push_back(ofPoint(l.x, l.y));
-    }
-    ofPolyline pl;
-    pl.addVertices(vLandmarks2D);
-    pl.close();
-    faceData.rBoundingBox = ofxCv::toCv(pl.getBoundingBox());
+    computeOutputs(*pFace_model, nOutputs, faceData, nFrameNumber, 0);
+    setStreamSettings(faceData);
     
     return faceData;
 }
 
-vector<ofxOpenFaceDataSingleFace> ofxOpenFace::processImageMultipleFaces() {
+void ofxOpenFace::processImageMultipleFaces(FrameJob& job) {
+    ofxOpenFaceTrace::Scope span(trace, "processImageMultipleFaces", job.nFrameNumber);
+    // Run all stages one after the other
+    convertGray(job);
+    detectFaces(job);
+    fitLandmarks(job);
+}
+
+void ofxOpenFace::convertGray(FrameJob& job) {
+    ofxOpenFaceTrace::Scope span(trace, "convertGray", job.nFrameNumber);
+    job.bGray = false;
+    job.latency.fGrayMs = 0.0f;
+    // With motion gating, a static frame may never need it
+    if (!bMotionGating) {
+        ensureGray(job);
+    }
+}
+
+void ofxOpenFace::ensureGray(FrameJob& job) {
+    if (job.bGray) {
+        return;
+    }
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
     // Reading the images
-    mutexImage.lock();
-    cv::Mat rgb_image = matToProcessColor;
-    cv::Mat grayscale_image;
-    ofxCv::copyGray(rgb_image, grayscale_image);
-    mutexImage.unlock();
-    
-    vector<cv::Rect_<float> > face_detections;
+    ofxCv::copyGray(job.rgb, job.gray);
+    job.bGray = true;
+    uint64_t nTimeUs = ofGetElapsedTimeMicros() - nTimeStartUs;
+    job.latency.fGrayMs += nTimeUs / 1000.0f;
+    stats.record(ofxOpenFaceStats::STAGE_GRAY, nTimeUs);
+}
+
+void ofxOpenFace::detectFaces(FrameJob& job) {
+    ofxOpenFaceTrace::Scope span(trace, "detectFaces", job.nFrameNumber);
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    cv::Mat& grayscale_image = job.gray;
+    vector<cv::Rect_<float> >& face_detections = job.detections;
+    face_detections.clear();
+    job.bDetected = false;
     
-    bool all_models_active = true;
-    for(unsigned int model = 0; model < vFace_models.size(); ++model) {
+    ofxOpenFaceDetectionScheduler::FrameState state;
+    state.nSlots = vActiveModels.size();
+    for(unsigned int model = 0; model < vActiveModels.size(); ++model) {
         if(!vActiveModels[model]) {
-            all_models_active = false;
+            state.nFreeSlots++;
+        }
+    }
+    state.nFailingSlots = nFailingModels;
+    
+    // The motion of this frame against the previous one, the frames reach this stage in order
+    job.tiles = ofxOpenFaceMotionMask::Tiles();
+    if (bMotionGating || pDetectionScheduler->needsMotion()) {
+        job.tiles = motionMask.update(job.rgb);
+        state.fMotion = job.tiles.fMotion;
+    }
+    
+    // Get the detections when the scheduler says so (it only does when there are free models available for tracking)
+    if(pDetectionScheduler->shouldDetect(state)) {
+        // Everything that moved since the last detector run, not only on this frame
+        const ofxOpenFaceMotionMask::Tiles& tilesSinceDetection = motionMask.getTilesSinceDetection();
+        if (bMotionGating && tilesSinceDetection.fMovingFraction == 0.0f) {
+            // A face cannot have come in without anything moving
+            pDetectionScheduler->cancelDetection();
+            mutexMotionStats.lock();
+            motionStats.nDetectionsSkipped++;
+            mutexMotionStats.unlock();
+        } else {
+            vector<cv::Rect> vRegions;
+            bool bWholeFrame = !getDetectionRegions(tilesSinceDetection, vRegions);
+            if (!bWholeFrame && vRegions.empty()) {
+                // Nowhere left to look
+                pDetectionScheduler->cancelDetection();
+            } else {
+                motionMask.clearSinceDetection();
+                ensureGray(job);
+                if (bAsyncDetection) {
+                    // The detector thread takes it from here, the fitting picks up its proposals when they are ready
+                    if (bWholeFrame) {
+                        detector.setImage(grayscale_image, job.nFrameNumber);
+                    } else {
+                        detector.setImage(grayscale_image, vRegions, job.nFrameNumber);
+                    }
+                } else if (bWholeFrame) {
+                    ofxOpenFaceTrace::Scope spanDetector(trace, "Face detector", job.nFrameNumber);
+                    detector.detect(grayscale_image, face_detections);
+                    job.bDetected = true;
+                } else {
+                    ofxOpenFaceTrace::Scope spanDetector(trace, "Face detector (regions)", job.nFrameNumber);
+                    detector.detect(grayscale_image, face_detections, vRegions);
+                    job.bDetected = true;
+                }
+            }
+        }
+    }
+    job.latency.fDetectionMs = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f;
+}
+
+bool ofxOpenFace::getDetectionRegions(const ofxOpenFaceMotionMask::Tiles& tiles, vector<cv::Rect>& vRegions) {
+    vRegions.clear();
+    bool bRestricted = false;
+    
+    // Leave out what the tracked faces cover, regions overlapping by half a face keep new faces whole in one of them
+    if (bDetectUncoveredOnly) {
+        mutexCoverage.lock();
+        vector<cv::Rect_<float>> vCovered = vCoveredFaces;
+        mutexCoverage.unlock();
+        if (!vCovered.empty()) {
+            float fFaceSize = 64.0f;
+            for (auto& r : vCovered) {
+                fFaceSize = MAX(fFaceSize, MAX(r.width, r.height));
+            }
+            ofxOpenFaceCoverage::getUncoveredRegions(cv::Size(nImgWidth, nImgHeight), vCovered, fFaceSize / 2, vRegions);
+            bRestricted = true;
         }
     }
     
-    // Get the detections (every 8th frame and when there are free models available for tracking)
-    if(nFrameCount % 8 == 0 && !all_models_active) {
-        vector<float> confidences;
-        if(vDet_parameters[0].curr_face_detector == LandmarkDetector::FaceModelParameters::HOG_SVM_DETECTOR) {
-            LandmarkDetector::DetectFacesHOG(face_detections, grayscale_image, vFace_models[0].face_detector_HOG, confidences);
-        } else if(vDet_parameters[0].curr_face_detector == LandmarkDetector::FaceModelParameters::HAAR_DETECTOR) {
-            LandmarkDetector::DetectFaces(face_detections, grayscale_image, vFace_models[0].face_detector_HAAR);
+    // Only where something moved, when less than half of the frame did
+    bool bMoving = bMotionGating && tiles.fMovingFraction < 0.5f;
+    if (bMoving) {
+        vector<cv::Rect> vMoving;
+        tiles.getMovingRegions(vMoving);
+        if (bRestricted) {
+            vector<cv::Rect> vBoth;
+            ofxOpenFaceCoverage::intersect(vRegions, vMoving, vBoth, 1);
+            vRegions.swap(vBoth);
         } else {
-            LandmarkDetector::DetectFacesMTCNN(face_detections, grayscale_image, vFace_models[0].face_detector_MTCNN, confidences);
+            vRegions.swap(vMoving);
         }
+        bRestricted = true;
+    }
+    
+    // Many overlapping regions can cost more than one full scan
+    if (bRestricted && ofxOpenFaceCoverage::getArea(vRegions) > 0.8f * nImgWidth * nImgHeight) {
+        vRegions.clear();
+        bRestricted = false;
+    }
+    if (bRestricted && bMoving && !vRegions.empty()) {
+        mutexMotionStats.lock();
+        motionStats.nDetectionsRegional++;
+        mutexMotionStats.unlock();
+    }
+    return bRestricted;
+}
+
+void ofxOpenFace::fitLandmarks(FrameJob& job) {
+    ofxOpenFaceTrace::Scope span(trace, "fitLandmarks", job.nFrameNumber);
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    int nOutputsFrame = nOutputs; // the same for all the faces of the frame
+    const cv::Mat& rgb_image = job.rgb;
+    cv::Mat& grayscale_image = job.gray;
+    vector<cv::Rect_<float> >& face_detections = job.detections;
+    
+    // Use the latest proposals of the detector thread, whatever frame they come from
+    job.latency.fProposalsAgeMs = 0.0f;
+    if (bAsyncDetection && detector.takeProposals(face_detections)) {
+        job.latency.fProposalsAgeMs = detector.getProposalsAgeMs();
+        job.bDetected = true;
     }
     
     // Keep only non overlapping detections (also convert to a concurrent vector)
     NonOverlapingDetections(vFace_models, face_detections);
+    if (job.bDetected) {
+        pDetectionScheduler->reportDetection(detector.getLastDetectionMs(), face_detections.size());
+    }
     
-    vector<tbb::atomic<bool>> face_detections_used(face_detections.size());
+    // Faces lost for a few frames give their slot back
+    uint64_t nNowMs = ofGetElapsedTimeMillis();
+    for (unsigned int model = 0; model < vFace_models.size(); ++model) {
+        if (vActiveModels[model] && vFace_models[model].failures_in_a_row > 4) {
+            vActiveModels[model] = false;
+            reacquisition.store(model, nNowMs);
+            vFace_models[model].Reset();
+            vSlotFreeSinceMs[model] = nNowMs;
+            quality.resetSlot(model, vDet_parameters);
+        }
+    }
     
-    vector<ofxOpenFaceDataSingleFace> vData; // the data we will send
+    // Every new face takes a free slot, a crowd grows the pool up to its hard cap
+    vector<int> vFreeSlots;
+    for (unsigned int model = 0; model < vFace_models.size(); ++model) {
+        if (!vActiveModels[model]) {
+            vFreeSlots.push_back(model);
+        }
+    }
+    int nMissing = MIN((int)face_detections.size() - (int)vFreeSlots.size(), nMaxSlots - (int)vFace_models.size());
+    if (nMissing > 0) {
+        int nFirst = vFace_models.size();
+        growFacePool(nMissing);
+        for (int model = nFirst; model < (int)vFace_models.size(); ++model) {
+            vFreeSlots.push_back(model);
+        }
+    }
+    vector<int> vDetectionOfSlot(vFace_models.size(), -1);
+    for (size_t i = 0; i < MIN(vFreeSlots.size(), face_detections.size()); i++) {
+        vDetectionOfSlot[vFreeSlots[i]] = i;
+    }
+    
+    vector<ofxOpenFaceDataSingleFace>& vData = job.vData; // the data we will send
     // Initialize it
-    for (int i=0; i<nMaxFaces; i++) {
+    vData.clear();
+    for (unsigned int model = 0; model < vFace_models.size(); ++model) {
         ofxOpenFaceDataSingleFace d;
         vData.push_back(d);
     }
     
-    // Go through every model and update the tracking
+    // Tracked faces with nothing moving under them keep their previous result for a while.
+    // Only the slots holding a face or taking a new one are fitted.
+    vector<bool> vReuse(vFace_models.size(), false);
+    vector<int> vFitted;
+    for (unsigned int model = 0; model < vFace_models.size(); ++model) {
+        if (bMotionGating && vActiveModels[model] && vFace_models[model].failures_in_a_row == 0 && vDataPrevious[model].detected &&
+            vReuseFrames[model] < nMaxReuseFrames && !job.tiles.isMoving(vDataPrevious[model].rBoundingBox)) {
+            vReuse[model] = true;
+            vData[model] = vDataPrevious[model];
+            vReuseFrames[model]++;
+        } else if (vActiveModels[model] || vDetectionOfSlot[model] >= 0) {
+            vFitted.push_back(model);
+        }
+    }
+    
+    // Over the budget, the less urgent tracked faces are extrapolated instead
+    vector<bool> vPredicted(vFace_models.size(), false);
+    if (faceScheduler.isEnabled()) {
+        vector<ofxOpenFaceFaceScheduler::Face> vFaces;
+        for (int model : vFitted) {
+            if (vActiveModels[model] && vDataPrevious[model].detected) {
+                ofxOpenFaceFaceScheduler::Face face;
+                face.nSlot = model;
+                face.fArea = vDataPrevious[model].rBoundingBox.area();
+                face.fCertainty = vDataPrevious[model].certainty;
+                face.fSpeedPx = cv::norm(vVelocity[model]);
+                face.fPriority = facePriorityCallback ? facePriorityCallback(vDataPrevious[model]) : 1.0f;
+                face.nFramesSinceFit = vFramesSinceFit[model];
+                vFaces.push_back(face);
+            }
+        }
+        vector<bool> vFit(vFace_models.size(), true);
+        faceScheduler.select(vFaces, vFit);
+        vector<int> vFittedScheduled;
+        for (int model : vFitted) {
+            if (vFit[model]) {
+                vFittedScheduled.push_back(model);
+            } else {
+                predictFace(model, vData[model]);
+                vPredicted[model] = true;
+            }
+        }
+        vFitted.swap(vFittedScheduled);
+    }
+    if (!vFitted.empty()) {
+        ensureGray(job);
+    }
+    
+    // New faces where a face was lost a moment ago start from its shape, one detection per lost face
+    vector<bool> vReacquired(vFace_models.size(), false);
+    vector<uint8_t> vFlowTracked(vFace_models.size(), 0); // not a vector<bool>, written by the parallel fits
+    for (int model : vFitted) {
+        if (!vActiveModels[model]) {
+            vReacquired[model] = reacquisition.restore(face_detections[vDetectionOfSlot[model]], nNowMs, vFace_models[model]);
+        }
+    }
+    
+    // Go through every fitted model and update the tracking
 #ifdef OFX_OPENFACE_DO_PARALLEL
-    tbb::parallel_for(0, (int)vFace_models.size(), [&](int model) {
+    tbb::parallel_for(0, (int)vFitted.size(), [&](int i) {
 #else
-    for (unsigned int model = 0; model < vFace_models.size(); ++model) {
+    for (int i = 0; i < (int)vFitted.size(); ++i) {
 #endif
+        int model = vFitted[i];
+        ofxOpenFaceTrace::Scope spanModel(trace, "Face model", job.nFrameNumber, model);
         bool detection_success = false;
         
-        // If the current model has failed more than 4 times in a row, remove it
-        if(vFace_models[model].failures_in_a_row > 4)
+        // A tracked face that barely moved is carried over by the optical flow, without a fit on this frame
+        if (vActiveModels[model] && flowTracker.isEnabled()) {
+            uint64_t nTimeFlowUs = ofGetElapsedTimeMicros();
+            vFlowTracked[model] = flowTracker.track(model, grayscale_image, vFace_models[model]);
+            trace.record("Optical flow", nTimeFlowUs, ofGetElapsedTimeMicros(), job.nFrameNumber, model);
+        }
+        
+        if(vReacquired[model])
         {
-            vActiveModels[model] = false;
+            // Tracked from the shape of the face lost there, with the small windows
+            uint64_t nTimeLandmarksUs = ofGetElapsedTimeMicros();
+            ofxOpenFaceTrace::Scope spanLandmarks(trace, "DetectLandmarksInVideo (re-acquired face)", job.nFrameNumber, model);
+            detection_success = LandmarkDetector::DetectLandmarksInVideo(rgb_image, vFace_models[model], vDet_parameters[model], grayscale_image);
+            stats.recordSince(ofxOpenFaceStats::STAGE_LANDMARKS, nTimeLandmarksUs);
+            reacquisition.recordFit(true, (ofGetElapsedTimeMicros() - nTimeLandmarksUs) / 1000.0f);
+            fitPredictor.reset(model);
+            fitPredictor.correct(model, vFace_models[model], vDet_parameters[model], detection_success);
+            vActiveModels[model] = true;
+        }
+        else if(!vActiveModels[model])
+        {
+            // Reinitialise the model
             vFace_models[model].Reset();
+            
+            // This ensures that a wider window is used for the initial landmark localisation
+            vFace_models[model].detection_success = false;
+            uint64_t nTimeLandmarksUs = ofGetElapsedTimeMicros();
+            ofxOpenFaceTrace::Scope spanLandmarks(trace, "DetectLandmarksInVideo (new face)", job.nFrameNumber, model);
+            detection_success = LandmarkDetector::DetectLandmarksInVideo(rgb_image, face_detections[vDetectionOfSlot[model]], vFace_models[model], vDet_parameters[model], grayscale_image);
+            stats.recordSince(ofxOpenFaceStats::STAGE_LANDMARKS, nTimeLandmarksUs);
+            reacquisition.recordFit(false, (ofGetElapsedTimeMicros() - nTimeLandmarksUs) / 1000.0f);
+            fitPredictor.reset(model);
+            fitPredictor.correct(model, vFace_models[model], vDet_parameters[model], detection_success);
+            
+            // This activates the model
+            vActiveModels[model] = true;
         }
-        
-        // If the model is inactive reactivate it with new detections
-        if(!vActiveModels[model])
+        else if(vFlowTracked[model])
         {
-            for(size_t detection_ind = 0; detection_ind < face_detections.size(); ++detection_ind)
-            {
-                // if it was not taken by another tracker take it (if it is false swap it to true and enter detection, this makes it parallel safe)
-                if(face_detections_used[detection_ind].compare_and_swap(true, false) == false)
-                {
-                    // Reinitialise the model
-                    vFace_models[model].Reset();
-                    
-                    // This ensures that a wider window is used for the initial landmark localisation
-                    vFace_models[model].detection_success = false;
-                    detection_success = LandmarkDetector::DetectLandmarksInVideo(rgb_image, face_detections[detection_ind], vFace_models[model], vDet_parameters[model], grayscale_image);
-                    
-                    // This activates the model
-                    vActiveModels[model] = true;
-                    
-                    // break out of the loop as the tracker has been reinitialised
-                    break;
-                }
-            }
+            detection_success = true;
+            fitPredictor.correct(model, vFace_models[model], vDet_parameters[model], detection_success, false);
         }
         else
         {
-            // The actual facial landmark detection / tracking
-            detection_success = LandmarkDetector::DetectLandmarksInVideo(rgb_image, vFace_models[model], vDet_parameters[model], grayscale_image);
+            // The actual facial landmark detection / tracking, starting where the face is heading when predicting
+            uint64_t nTimeLandmarksUs = ofGetElapsedTimeMicros();
+            LandmarkDetector::FaceModelParameters& params = fitPredictor.predict(model, vFramesSinceFit[model] + 1, vFace_models[model], vDet_parameters[model]);
+            ofxOpenFaceTrace::Scope spanLandmarks(trace, "DetectLandmarksInVideo", job.nFrameNumber, model);
+            detection_success = LandmarkDetector::DetectLandmarksInVideo(rgb_image, vFace_models[model], params, grayscale_image);
+            stats.recordSince(ofxOpenFaceStats::STAGE_LANDMARKS, nTimeLandmarksUs);
+            fitPredictor.correct(model, vFace_models[model], params, detection_success);
+        }
+        pResidency->touch(vFace_models[model], vDet_parameters[model]);
+        if (detection_success) {
+            flowTracker.update(model, grayscale_image, vFace_models[model], !vFlowTracked[model]);
+        } else {
+            flowTracker.reset(model);
         }
         
         vData[model].detected = detection_success;
         vData[model].certainty = vFace_models[model].detection_certainty;
-        vData[model].pose = LandmarkDetector::GetPose(vFace_models[model], s_camSettings.fx, s_camSettings.fy, s_camSettings.cx, s_camSettings.cy);
-        vData[model].eyeLandmarks2D = LandmarkDetector::CalculateAllEyeLandmarks(vFace_models[model]);
-        vData[model].eyeLandmarks3D = LandmarkDetector::Calculate3DEyeLandmarks(vFace_models[model], s_camSettings.fx, s_camSettings.fy, s_camSettings.cx, s_camSettings.cy);
-        vData[model].allLandmarks2D = LandmarkDetector::CalculateAllLandmarks(vFace_models[model]);
         vData[model].sFaceID = ofToString(model + 1);
-        GazeAnalysis::EstimateGaze(vFace_models[model], vData[model].gazeLeftEye, s_camSettings.fx, s_camSettings.fy, s_camSettings.cx, s_camSettings.cy, true);
-        GazeAnalysis::EstimateGaze(vFace_models[model], vData[model].gazeRightEye, s_camSettings.fx, s_camSettings.fy, s_camSettings.cx, s_camSettings.cy, false);
-        
-        // Figure out the bounding box of all landmarks
-        vector<ofPoint> vLandmarks2D;
-        for (auto& l : vData[model].allLandmarks2D) {
-            vLandmarks2D.push_back(ofPoint(l.x, l.y));
-        }
-        ofPolyline pl;
-        pl.addVertices(vLandmarks2D);
-        pl.close();
-        vData[model].rBoundingBox = ofxCv::toCv(pl.getBoundingBox());
+        vData[model].nQualityLevel = quality.getLevel(model);
+        computeOutputs(vFace_models[model], nOutputsFrame, vData[model], job.nFrameNumber, model);
+        setStreamSettings(vData[model]);
+        if (detection_success) {
+            reacquisition.remember(model, vFace_models[model], vData[model].rBoundingBox);
+        }
 #ifdef OFX_OPENFACE_DO_PARALLEL
     });
 #else
     }
 #endif
     
-    // Update the frame count
-    nFrameCount++;
+    // Remember the fitted results, count the work saved
+    MotionStats counted;
+    for (unsigned int model = 0; model < vFace_models.size(); ++model) {
+        if (vReuse[model]) {
+            counted.nFitsReused++;
+        } else {
+            vDataPrevious[model] = vData[model];
+            vReuseFrames[model] = 0;
+            if (vPredicted[model]) {
+                counted.nFitsPredicted++;
+                vFramesSinceFit[model]++;
+            } else if (vActiveModels[model]) {
+                if (vFlowTracked[model]) {
+                    counted.nFitsFlow++;
+                } else {
+                    counted.nFits++;
+                }
+                // The face's motion since its last fit, none for a new face
+                cv::Point2f ptCenter(vData[model].rBoundingBox.x + vData[model].rBoundingBox.width / 2.0f, vData[model].rBoundingBox.y + vData[model].rBoundingBox.height / 2.0f);
+                if (vDetectionOfSlot[model] < 0 && vData[model].detected) {
+                    vVelocity[model] = (ptCenter - vLastFitCenter[model]) * (1.0f / (vFramesSinceFit[model] + 1));
+                } else {
+                    vVelocity[model] = cv::Point2f();
+                }
+                vLastFitCenter[model] = ptCenter;
+                vFramesSinceFit[model] = 0;
+            }
+        }
+    }
+    mutexMotionStats.lock();
+    motionStats.nFrames++;
+    motionStats.nGrayConversionsSkipped += job.bGray ? 0 : 1;
+    motionStats.nFits += counted.nFits;
+    motionStats.nFitsReused += counted.nFitsReused;
+    motionStats.nFitsPredicted += counted.nFitsPredicted;
+    motionStats.nFitsFlow += counted.nFitsFlow;
+    mutexMotionStats.unlock();
+    
+    // Let the scheduler know about faces being lost
+    int nFailing = 0;
+    for (unsigned int model = 0; model < vFace_models.size(); ++model) {
+        if (vActiveModels[model] && vFace_models[model].failures_in_a_row > 0) {
+            nFailing++;
+        }
+    }
+    nFailingModels = nFailing;
+    
+    // What the next detections can leave out
+    vector<cv::Rect_<float>> vCovered;
+    for (unsigned int model = 0; model < vFace_models.size(); ++model) {
+        if (vActiveModels[model]) {
+            vCovered.push_back(vFace_models[model].GetBoundingBox());
+        }
+    }
+    mutexCoverage.lock();
+    vCoveredFaces.swap(vCovered);
+    mutexCoverage.unlock();
+    pResidency->evictIdle();
+    shrinkFacePool();
+    job.latency.fFittingMs = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f;
+    
+    // Trade quality for time when the frames run late, the next fitting uses the new parameters
+    quality.update(job.latency.fDetectionMs + job.latency.fFittingMs, vActiveModels, vDet_parameters);
+}
+
+void ofxOpenFace::growFacePool(int nCount) {
+    // From the first face model, the loaded one's detectors may be in use meanwhile
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    int nFirst = vFace_models.size();
+    ofxOpenFaceSharedModel::appendFaceModels(*pFace_model, vFace_models[0], nCount, vFace_models);
+    uint64_t nNowMs = ofGetElapsedTimeMillis();
+    for (int model = nFirst; model < (int)vFace_models.size(); ++model) {
+        vActiveModels[model] = false;
+        vDataPrevious[model] = ofxOpenFaceDataSingleFace();
+        vReuseFrames[model] = 0;
+        vSlotFreeSinceMs[model] = nNowMs;
+        vFramesSinceFit[model] = 0;
+        vVelocity[model] = cv::Point2f();
+    }
+    nSlots = vFace_models.size();
+    ofLogNotice("ofxOpenFace", "Face pool grown to " + ofToString(vFace_models.size()) + " slots in " + ofToString((ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f, 1) + " ms");
+}
+
+void ofxOpenFace::shrinkFacePool() {
+    // Only from the end, the slots are the face IDs
+    uint64_t nNowMs = ofGetElapsedTimeMillis();
+    int nBefore = vFace_models.size();
+    while ((int)vFace_models.size() > nMaxFaces && !vActiveModels[vFace_models.size() - 1] && nNowMs - vSlotFreeSinceMs[vFace_models.size() - 1] >= (uint64_t)nSlotReleaseMs) {
+        vFace_models.pop_back();
+    }
+    if ((int)vFace_models.size() != nBefore) {
+        nSlots = vFace_models.size();
+        ofLogNotice("ofxOpenFace", "Face pool shrunk to " + ofToString(vFace_models.size()) + " slots");
+    }
+}
+
+void ofxOpenFace::predictFace(int model, ofxOpenFaceDataSingleFace& d) {
+    cv::Point2f ptShift = vVelocity[model];
+    d = vDataPrevious[model];
+    d.predicted = true;
+    for (auto& pt : d.allLandmarks2D) {
+        pt += ptShift;
+    }
+    for (auto& pt : d.eyeLandmarks2D) {
+        pt += ptShift;
+    }
+    d.rBoundingBox.x += cvRound(ptShift.x);
+    d.rBoundingBox.y += cvRound(ptShift.y);
+    
+    // The pose and the 3D eye landmarks are in mm, the shift is at the face's depth
+    if (camSettings.fx > 0 && camSettings.fy > 0) {
+        d.pose[0] += ptShift.x * d.pose[2] / camSettings.fx;
+        d.pose[1] += ptShift.y * d.pose[2] / camSettings.fy;
+        for (auto& pt : d.eyeLandmarks3D) {
+            pt.x += ptShift.x * pt.z / camSettings.fx;
+            pt.y += ptShift.y * pt.z / camSettings.fy;
+        }
+    }
     
-    return vData;
+    // The next fit starts where the face is expected, and the detections around it are still recognized as this face.
+    // The optical flow starts over from that fit, its last patch is of an older frame than the shifted landmarks.
+    flowTracker.shift(model, vFace_models[model], cv::Vec2f(ptShift.x, ptShift.y));
 }
 
-void ofxOpenFace::setImage(ofImage img) {
+void ofxOpenFace::computeOutputs(LandmarkDetector::CLNF& face, int nOutputsFrame, ofxOpenFaceDataSingleFace& d, uint64_t nFrameNumber, int nFace) {
+    if (nOutputsFrame & OUTPUT_POSE) {
+        uint64_t nTimePoseUs = ofGetElapsedTimeMicros();
+        d.pose = LandmarkDetector::GetPose(face, camSettings.fx, camSettings.fy, camSettings.cx, camSettings.cy);
+        stats.recordSince(ofxOpenFaceStats::STAGE_POSE, nTimePoseUs);
+        trace.record("GetPose", nTimePoseUs, ofGetElapsedTimeMicros(), nFrameNumber, nFace);
+    }
+    if (nOutputsFrame & OUTPUT_LANDMARKS_2D) {
+        d.allLandmarks2D = LandmarkDetector::CalculateAllLandmarks(face);
+    }
+    if (nOutputsFrame & (OUTPUT_EYES_2D | OUTPUT_EYES_3D | OUTPUT_GAZE)) {
+        uint64_t nTimeGazeUs = ofGetElapsedTimeMicros();
+        if (nOutputsFrame & OUTPUT_EYES_2D) {
+            d.eyeLandmarks2D = LandmarkDetector::CalculateAllEyeLandmarks(face);
+        }
+        if (nOutputsFrame & OUTPUT_EYES_3D) {
+            d.eyeLandmarks3D = LandmarkDetector::Calculate3DEyeLandmarks(face, camSettings.fx, camSettings.fy, camSettings.cx, camSettings.cy);
+        }
+        // Only with an eye model that tracked
+        if ((nOutputsFrame & OUTPUT_GAZE) && d.detected && face.eye_model) {
+            GazeAnalysis::EstimateGaze(face, d.gazeLeftEye, camSettings.fx, camSettings.fy, camSettings.cx, camSettings.cy, true);
+            GazeAnalysis::EstimateGaze(face, d.gazeRightEye, camSettings.fx, camSettings.fy, camSettings.cx, camSettings.cy, false);
+        }
+        stats.recordSince(ofxOpenFaceStats::STAGE_GAZE, nTimeGazeUs);
+        trace.record("EstimateGaze", nTimeGazeUs, ofGetElapsedTimeMicros(), nFrameNumber, nFace);
+    }
+    
+    // The bounding box of all landmarks, the tracking needs it whatever the outputs
+    int nLandmarks = face.detected_landmarks.rows / 2;
+    if (nLandmarks > 0) {
+        double fMinX, fMaxX, fMinY, fMaxY;
+        cv::minMaxLoc(face.detected_landmarks.rowRange(0, nLandmarks), &fMinX, &fMaxX);
+        cv::minMaxLoc(face.detected_landmarks.rowRange(nLandmarks, 2 * nLandmarks), &fMinY, &fMaxY);
+        d.rBoundingBox = cv::Rect_<float>(fMinX, fMinY, fMaxX - fMinX, fMaxY - fMinY);
+    }
+}
+
+void ofxOpenFace::setImage(const ofImage& img) {
     setImage(img.getPixels());
 }
 
-void ofxOpenFace::setImage(ofPixels img) {
-    setImage(ofxCv::toCv(img));
+void ofxOpenFace::setImage(const ofPixels& img) {
+    // Only wrap the pixels, the mailbox does the copy
+    cv::Mat mat(img.getHeight(), img.getWidth(), CV_MAKETYPE(CV_8U, img.getNumChannels()), (void*)img.getData(), img.getBytesStride());
+    setImage(mat);
 }
                       
-void ofxOpenFace::setImage(cv::Mat img) {
-    mutexImage.lock();
+void ofxOpenFace::setImage(const cv::Mat& img) {
     // Override the current "next image"
-    matToProcessColor = img;
-    bHaveNewImage = true;
+    mailbox.publish(img);
+    // Wake up the worker. Taking the lock makes sure it is either waiting already or will see the new frame.
+    mutexImage.lock();
     mutexImage.unlock();
+    conditionNewImage.notify_one();
+    if (pEngine != nullptr) {
+        pEngine->notifyFrame();
+    }
+}
+
+uint64_t ofxOpenFace::getFramesSuperseded() {
+    return mailbox.getFramesSuperseded();
 }
                       
 void ofxOpenFace::stop() {
+    mutexImage.lock();
     bExit = true;
+    mutexImage.unlock();
+    // Wake up the worker so it can leave its loop
+    conditionNewImage.notify_all();
     ofLogNotice("ofxOpenFace", "Stopping thread.");
 }
 
@@ -372,6 +835,8 @@ void ofxOpenFace::exit() {
     // Clear memory
     stop();
     waitForThread(true);
+    detector.stop();
+    detector.waitForThread(true);
 }
 
 void ofxOpenFace::resetFaceModel() {
@@ -386,59 +851,418 @@ void ofxOpenFace::resetFaceModel() {
     }
 }
 
+const ofxOpenFaceFrameMailbox::Frame* ofxOpenFace::takeFrame() {
+    const ofxOpenFaceFrameMailbox::Frame* pFrame = mailbox.consume();
+    if (pFrame == nullptr) {
+        return nullptr;
+    }
+    uint64_t nLatencyUs = ofGetElapsedTimeMicros() - pFrame->nTimeSetUs;
+    
+    // Keep track of how long the image waited before being picked up
+    stats.record(ofxOpenFaceStats::STAGE_FRAME_WAIT, nLatencyUs);
+    nHandoffLatencyUs = nLatencyUs;
+    if (nLatencyUs > nHandoffLatencyMaxUs) {
+        nHandoffLatencyMaxUs = nLatencyUs;
+    }
+    return pFrame;
+}
+
+bool ofxOpenFace::processNextFrame() {
+    const ofxOpenFaceFrameMailbox::Frame* pFrame = takeFrame();
+    if (pFrame == nullptr) {
+        return false;
+    }
+    processFrame(*pFrame);
+    return true;
+}
+
+bool ofxOpenFace::hasNewFrame() const {
+    return mailbox.hasNewFrame();
+}
+
+void ofxOpenFace::processFrame(const ofxOpenFaceFrameMailbox::Frame& frame) {
+    if (bMultipleFaces) {
+        // The frame stays ours until the next consume()
+        FrameJob& job = jobSerial;
+        job.rgb = frame.mat;
+        job.nTimeSetUs = frame.nTimeSetUs;
+        job.nFrameNumber = frame.nFrameNumber;
+        job.latency.fHandoffMs = nHandoffLatencyUs / 1000.0f;
+        processImageMultipleFaces(job);
+        publishMultipleFaces(job);
+    } else {
+        auto d = processImageSingleFace(frame.mat, frame.nFrameNumber);
+        // Update the tracker
+        uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+        std::vector<ofxOpenFaceDataSingleFace> v;
+        v.push_back(d);
+        tracker.track(v);
+        stats.recordSince(ofxOpenFaceStats::STAGE_TRACKER, nTimeStartUs);
+        trace.record("tracker.track", nTimeStartUs, ofGetElapsedTimeMicros(), frame.nFrameNumber);
+        nTimeStartUs = ofGetElapsedTimeMicros();
+        // Raise the event for the updated faces
+        {
+            ofxOpenFaceTrace::Scope spanEvent(trace, "ofNotifyEvent raw", frame.nFrameNumber);
+            ofNotifyEvent(eventOpenFaceDataSingleRaw, d);
+            ofNotifyEvent(eventDataSingleRaw, d);
+        }
+        // Raise the event for the tracked faces
+        bool val = true;
+        if (tracker.getFollowers().size() > 0) {
+            auto follower = tracker.getFollowers().front();
+            if (follower.getLastSeenMs() > getKillAfterDisappearedMs()) {
+                // Clear tracked
+                ofxOpenFaceTrace::Scope spanEvent(trace, "ofNotifyEvent clear", frame.nFrameNumber);
+                ofNotifyEvent(eventOpenFaceDataClear, val);
+                ofNotifyEvent(eventDataClear, val);
+            } else {
+                ofxOpenFaceTrace::Scope spanEvent(trace, "ofNotifyEvent tracked", frame.nFrameNumber);
+                ofNotifyEvent(eventOpenFaceDataSingleTracked, follower);
+                ofNotifyEvent(eventDataSingleTracked, follower);
+            }
+        } else {
+            // Clear tracked
+            ofxOpenFaceTrace::Scope spanEvent(trace, "ofNotifyEvent clear", frame.nFrameNumber);
+            ofNotifyEvent(eventOpenFaceDataClear, val);
+            ofNotifyEvent(eventDataClear, val);
+        }
+        stats.recordSince(ofxOpenFaceStats::STAGE_EVENTS, nTimeStartUs);
+        stats.recordSince(ofxOpenFaceStats::STAGE_FRAME, frame.nTimeSetUs);
+    }
+    fps_tracker.AddFrame();
+}
+
 void ofxOpenFace::threadedFunction() {
     thread.setName("ofxOpenFace " + thread.name());
     ofLogNotice("ofxOpenFace", "Thread started.");
     
     while(!bExit) {
-        // Do we have an image to process?
-        if (!bHaveNewImage) {
-            ofSleepMillis(20);
-        } else {            
-            nFrameCount = 0;
-            if (bMultipleFaces) {
-                auto v = processImageMultipleFaces();
-                // Update the tracker
-                tracker.track(v);
-                // Raise the event for the updated faces
-                ofNotifyEvent(eventOpenFaceDataMultipleRaw, v);
-                // Raise the event for the tracked faces
-                if (tracker.getFollowers().size() > 0) {
-                    ofNotifyEvent(eventOpenFaceDataMultipleTracked, tracker.getFollowers());
-                } else {
-                    // Clear tracked
-                    bool val = true;
-                    ofNotifyEvent(eventOpenFaceDataClear, val);
-                }
-            } else {
-                auto d = processImageSingleFace();
-                // Update the tracker
-                std::vector<ofxOpenFaceDataSingleFace> v;
-                v.push_back(d);
-                tracker.track(v);
-                // Raise the event for the updated faces
-                ofNotifyEvent(eventOpenFaceDataSingleRaw, d);
-                // Raise the event for the tracked faces
-                if (tracker.getFollowers().size() > 0) {
-                    auto follower = tracker.getFollowers().front();
-                    if (follower.getLastSeenMs() > s_nKillAfterDisappearedMs) {
-                        // Clear tracked
-                        bool val = true;
-                        ofNotifyEvent(eventOpenFaceDataClear, val);
-                    } else {
-                        ofNotifyEvent(eventOpenFaceDataSingleTracked, follower);
-                    }
-                } else {
-                    // Clear tracked
-                    bool val = true;
-                    ofNotifyEvent(eventOpenFaceDataClear, val);
-                }
-            }
-            bHaveNewImage = false; // ready for a new image
+        // Wait until there is an image to process (or until we are asked to stop)
+        std::unique_lock<std::mutex> lock(mutexImage);
+        conditionNewImage.wait(lock, [this] { return (mailbox.hasNewFrame() && nFramesInFlight < nMaxFramesInFlight) || bExit; });
+        lock.unlock();
+        if (bExit) {
+            break;
+        }
+        // Take the newest frame, it is ours until the next consume()
+        const ofxOpenFaceFrameMailbox::Frame* pFrame = takeFrame();
+        if (bMultipleFaces && bPipelined) {
+            // The frame is handed to the pipeline, which publishes the results when they are ready
+            submitToPipeline(*pFrame);
+        } else {
+            processFrame(*pFrame);
+        }
+    }
+    
+    // Let the frames still in the pipeline go through
+    if (pPipeline != nullptr) {
+        pPipeline->graph.wait_for_all();
+        delete pPipeline;
+        pPipeline = nullptr;
+    }
+    ofLogNotice("ofxOpenFace", "Thread stopped.");
+}
+
+void ofxOpenFace::publishMultipleFaces(FrameJob& job) {
+    ofxOpenFaceTrace::Scope span(trace, "publishMultipleFaces", job.nFrameNumber);
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    vector<ofxOpenFaceDataSingleFace>& v = job.vData;
+    // Update the tracker, the labels of the slots are the keys of the lost faces
+    reacquisition.setLabels(v, tracker.track(v));
+    stats.recordSince(ofxOpenFaceStats::STAGE_TRACKER, nTimeStartUs);
+    uint64_t nTimeEventsUs = ofGetElapsedTimeMicros();
+    trace.record("tracker.track", nTimeStartUs, nTimeEventsUs, job.nFrameNumber);
+    // Raise the event for the updated faces
+    {
+        ofxOpenFaceTrace::Scope spanEvent(trace, "ofNotifyEvent raw", job.nFrameNumber);
+        ofNotifyEvent(eventOpenFaceDataMultipleRaw, v);
+        ofNotifyEvent(eventDataMultipleRaw, v);
+    }
+    // Raise the event for the tracked faces
+    if (tracker.getFollowers().size() > 0) {
+        ofxOpenFaceTrace::Scope spanEvent(trace, "ofNotifyEvent tracked", job.nFrameNumber);
+        ofNotifyEvent(eventOpenFaceDataMultipleTracked, tracker.getFollowers());
+        ofNotifyEvent(eventDataMultipleTracked, tracker.getFollowers());
+    } else {
+        // Clear tracked
+        ofxOpenFaceTrace::Scope spanEvent(trace, "ofNotifyEvent clear", job.nFrameNumber);
+        bool val = true;
+        ofNotifyEvent(eventOpenFaceDataClear, val);
+        ofNotifyEvent(eventDataClear, val);
+    }
+    
+    // Keep the timings of this frame
+    uint64_t nTimeEndUs = ofGetElapsedTimeMicros();
+    stats.record(ofxOpenFaceStats::STAGE_EVENTS, nTimeEndUs - nTimeEventsUs);
+    stats.record(ofxOpenFaceStats::STAGE_FRAME, nTimeEndUs - job.nTimeSetUs);
+    job.latency.fPublishMs = (nTimeEndUs - nTimeStartUs) / 1000.0f;
+    job.latency.fTotalMs = (nTimeEndUs - job.nTimeSetUs) / 1000.0f;
+    job.latency.fDetectorMs = detector.getLastDetectionMs();
+    mutexLatency.lock();
+    latencyLast = job.latency;
+    mutexLatency.unlock();
+}
+
+void ofxOpenFace::setStreamSettings(ofxOpenFaceDataSingleFace& d) {
+    d.fx = camSettings.fx;
+    d.fy = camSettings.fy;
+    d.cx = camSettings.cx;
+    d.cy = camSettings.cy;
+    d.bHasIntrinsics = true;
+    d.fCertaintyNorm = fCertaintyNorm;
+    d.nKillAfterDisappearedMs = nKillAfterDisappearedMs;
+}
+
+void ofxOpenFace::setCertaintyNorm(float fValue) {
+    fCertaintyNorm = fValue;
+}
+
+void ofxOpenFace::setKillAfterDisappearedMs(int nValue) {
+    nKillAfterDisappearedMs = nValue;
+}
+
+int ofxOpenFace::getKillAfterDisappearedMs() const {
+    return nKillAfterDisappearedMs >= 0 ? nKillAfterDisappearedMs : s_nKillAfterDisappearedMs;
+}
+
+void ofxOpenFace::setTracing(bool bValue, int nCapacity) {
+    trace.setEnabled(bValue, nCapacity);
+}
+
+bool ofxOpenFace::saveTrace(const string& sPath) {
+    return trace.save(sPath);
+}
+
+void ofxOpenFace::clearTrace() {
+    trace.clear();
+}
+
+ofxOpenFaceStats::Snapshot ofxOpenFace::getStats() {
+    return stats.getSnapshot();
+}
+
+void ofxOpenFace::setLoadProgressCallback(function<void(const ofxOpenFaceModelLoader::Progress&)> callback) {
+    loadProgressCallback = callback;
+}
+
+ofxOpenFaceModelLoader::Report ofxOpenFace::getLoadReport() {
+    return loadReport;
+}
+
+void ofxOpenFace::resetStats() {
+    stats.reset();
+}
+
+void ofxOpenFace::setAsyncDetection(bool bValue) {
+    bAsyncDetection = bValue;
+}
+
+void ofxOpenFace::setDetectionScheduler(shared_ptr<ofxOpenFaceDetectionScheduler> pScheduler) {
+    pDetectionScheduler = pScheduler;
+}
+
+shared_ptr<ofxOpenFaceDetectionScheduler> ofxOpenFace::getDetectionScheduler() {
+    return pDetectionScheduler;
+}
+
+void ofxOpenFace::setMotionGating(bool bValue, int nMaxReuseFramesValue, int nTileSizePx, float fThreshold) {
+    bMotionGating = bValue;
+    nMaxReuseFrames = nMaxReuseFramesValue;
+    nMotionTileSizePx = nTileSizePx;
+    fMotionThreshold = fThreshold;
+}
+
+void ofxOpenFace::setDetectUncoveredOnly(bool bValue) {
+    bDetectUncoveredOnly = bValue;
+}
+
+float ofxOpenFace::getDetectionScannedPercent() {
+    uint64_t nSubmitted = detector.getPixelsSubmitted();
+    return nSubmitted > 0 ? 100.0f * detector.getPixelsScanned() / nSubmitted : 0.0f;
+}
+
+void ofxOpenFace::resetDetectionScanned() {
+    detector.resetPixelCounts();
+}
+
+void ofxOpenFace::setExpertEviction(int nIdleMinutes) {
+    residency.setIdleTime((uint64_t)MAX(nIdleMinutes, 0) * 60000);
+}
+
+ofxOpenFaceModelResidency::Stats ofxOpenFace::getExpertResidency() {
+    return pResidency->getStats();
+}
+
+float ofxOpenFace::warmUp(int nWidth, int nHeight) {
+    if (!bMultipleFaces || pFace_model == nullptr || vFace_models.empty()) {
+        ofLogWarning("ofxOpenFace", "warmUp() needs multiple faces, after setup()");
+        return 0.0f;
+    }
+    // It fills the loaded model's caches, which the face pools of the engine's streams copy from whenever they grow
+    if (pEngine != nullptr && pEngine->isThreadRunning()) {
+        ofLogError("ofxOpenFace", "warmUp() must be called before the engine's startThread().");
+        return 0.0f;
+    }
+    nWidth = nWidth > 0 ? nWidth : nImgWidth;
+    nHeight = nHeight > 0 ? nHeight : nImgHeight;
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    
+    // Textured noise rather than a face, the caches depend on sizes only
+    cv::Mat_<uchar> gray(nHeight, nWidth);
+    cv::RNG rng(20190101);
+    rng.fill(gray, cv::RNG::UNIFORM, 0, 256);
+    cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+    float fSize = MIN(nWidth, nHeight) / 3.0f;
+    cv::Rect_<float> rFace((nWidth - fSize) / 2.0f, (nHeight - fSize) / 2.0f, fSize, fSize);
+    
+    // The loaded model through every view, the face models then share what its experts computed.
+    // The model is the engine's for all its streams, one warm-up at a time. No stream is running, none copies from it meanwhile.
+    if (pEngine != nullptr) {
+        std::lock_guard<std::mutex> lock(pEngine->getDetectorMutex());
+        ofxOpenFaceSharedModel::warmUp(*pFace_model, gray, rFace, vDet_parameters[0]);
+    } else {
+        ofxOpenFaceSharedModel::warmUp(*pFace_model, gray, rFace, vDet_parameters[0]);
+    }
+    for (auto& face : vFace_models) {
+        ofxOpenFaceSharedModel::shareCaches(*pFace_model, face);
+    }
+    uint64_t nTimeModelUs = ofGetElapsedTimeMicros() - nTimeStartUs;
+    
+    // Each face model for the buffers it keeps itself
+    tbb::parallel_for(0, (int)vFace_models.size(), [&](int model) {
+        ofxOpenFaceSharedModel::warmUpFace(vFace_models[model], gray, rFace, vDet_parameters[model]);
+        vActiveModels[model] = false;
+    });
+    uint64_t nTimeFacesUs = ofGetElapsedTimeMicros() - nTimeStartUs - nTimeModelUs;
+    
+    // The face detector at the tracking size
+    vector<cv::Rect_<float>> vDetections;
+    detector.detect(gray, vDetections);
+    
+    resetStats();
+    resetFitStats();
+    reacquisition.resetStats();
+    detector.resetPixelCounts();
+    fWarmUpMs = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f;
+    ofLogNotice("ofxOpenFace", "Warmed up at " + ofToString(nWidth) + "x" + ofToString(nHeight) + " in " + ofToString(fWarmUpMs, 1) + " ms (model: "
+        + ofToString(nTimeModelUs / 1000.0f, 1) + " ms, " + ofToString(vFace_models.size()) + " face models: " + ofToString(nTimeFacesUs / 1000.0f, 1) + " ms)");
+    return fWarmUpMs;
+}
+
+float ofxOpenFace::getWarmUpMs() {
+    return fWarmUpMs;
+}
+
+void ofxOpenFace::setFacePool(int nMaxFacesHardValue, int nReleaseMs) {
+    nMaxFacesHard = nMaxFacesHardValue;
+    nSlotReleaseMs = MAX(nReleaseMs, 0);
+}
+
+void ofxOpenFace::setTargetFrameMs(float fMs) {
+    quality.setTargetFrameMs(fMs);
+}
+
+void ofxOpenFace::setFaceScheduling(int nFitsPerFrame, int nMaxSkipFrames) {
+    faceScheduler.setBudget(nFitsPerFrame, nMaxSkipFrames);
+}
+
+void ofxOpenFace::setFacePriorityCallback(function<float(const ofxOpenFaceDataSingleFace&)> callback) {
+    facePriorityCallback = callback;
+}
+
+void ofxOpenFace::setFitPrediction(bool bValue, float fResidualPx) {
+    fitPredictor.setEnabled(bValue, fResidualPx);
+}
+
+ofxOpenFaceFitPredictor::Stats ofxOpenFace::getFitStats() {
+    return fitPredictor.getStats();
+}
+
+void ofxOpenFace::resetFitStats() {
+    fitPredictor.resetStats();
+}
+
+void ofxOpenFace::setReacquisition(bool bValue, int nLifetimeMs, float fMaxDistance) {
+    reacquisition.setEnabled(bValue, nLifetimeMs, fMaxDistance);
+}
+
+ofxOpenFaceReacquisitionCache::Stats ofxOpenFace::getReacquisitionStats() {
+    return reacquisition.getStats();
+}
+
+void ofxOpenFace::setFlowTracking(bool bValue, int nRefitFrames, float fMinCertainty) {
+    flowTracker.setEnabled(bValue, nRefitFrames, fMinCertainty);
+}
+
+void ofxOpenFace::setOutputs(int nValue) {
+    nOutputs = nValue;
+}
+
+int ofxOpenFace::getOutputs() {
+    return nOutputs;
+}
+
+int ofxOpenFace::getFaceSlots() {
+    return nSlots;
+}
+
+int ofxOpenFace::getFaceSlotsActive() {
+    int nActive = 0;
+    for (int model = 0; model < nSlots; ++model) {
+        if (vActiveModels[model]) {
+            nActive++;
         }
-        fps_tracker.AddFrame();
     }
-    bHaveNewImage = false;
+    return nActive;
+}
+
+ofxOpenFace::MotionStats ofxOpenFace::getMotionStats() {
+    std::lock_guard<std::mutex> lock(mutexMotionStats);
+    return motionStats;
+}
+
+void ofxOpenFace::resetMotionStats() {
+    std::lock_guard<std::mutex> lock(mutexMotionStats);
+    motionStats = MotionStats();
+}
+
+ofxOpenFace::LatencyBreakdown ofxOpenFace::getLatencyBreakdown() {
+    std::lock_guard<std::mutex> lock(mutexLatency);
+    return latencyLast;
+}
+
+void ofxOpenFace::setPipelined(bool bValue, int nFramesInFlightMax) {
+    if (pPipeline != nullptr) {
+        ofLogError("ofxOpenFace", "setPipelined() must be called before the first image is set.");
+        return;
+    }
+    bPipelined = bValue;
+    nMaxFramesInFlight = bValue ? max(nFramesInFlightMax, 1) : 1;
+}
+
+void ofxOpenFace::submitToPipeline(const ofxOpenFaceFrameMailbox::Frame& frame) {
+    if (pPipeline == nullptr) {
+        pPipeline = new Pipeline(this, nMaxFramesInFlight);
+    }
+    // Frames leave the pipeline in order, so the job of the frame nMaxFramesInFlight before this one is free
+    FrameJob& job = pPipeline->vJobs[nPipelineSequence % pPipeline->vJobs.size()];
+    // The mailbox reuses its frame on the next consume(), so the job needs its own copy
+    frame.mat.copyTo(job.rgb);
+    job.nSequence = nPipelineSequence++;
+    job.nTimeSetUs = frame.nTimeSetUs;
+    job.nFrameNumber = frame.nFrameNumber;
+    job.latency.fHandoffMs = (ofGetElapsedTimeMicros() - frame.nTimeSetUs) / 1000.0f;
+    nFramesInFlight++;
+    pPipeline->nodeGray.try_put(&job);
+}
+
+void ofxOpenFace::finishPipelineFrame() {
+    fps_tracker.AddFrame();
+    nFramesInFlight--;
+    // There is room for a new frame, wake up the worker
+    mutexImage.lock();
+    mutexImage.unlock();
+    conditionNewImage.notify_one();
 }
 
 int ofxOpenFace::getFPS() {
@@ -446,6 +1270,19 @@ int ofxOpenFace::getFPS() {
     return nToReturn;
 }
 
+uint64_t ofxOpenFace::getHandoffLatencyUs() {
+    return nHandoffLatencyUs;
+}
+
+uint64_t ofxOpenFace::getHandoffLatencyMaxUs() {
+    return nHandoffLatencyMaxUs;
+}
+
+void ofxOpenFace::resetHandoffLatency() {
+    nHandoffLatencyUs = 0;
+    nHandoffLatencyMaxUs = 0;
+}
+
 void ofxOpenFace::NonOverlapingDetections(const vector<LandmarkDetector::CLNF>& clnf_models, vector<cv::Rect_<float> >& face_detections) {
     // Go over the model and eliminate detections that are not informative (there already is a tracker there)
     for(size_t model = 0; model < clnf_models.size(); ++model)
@@ -29,6 +29,9 @@ namespace ofxCv {
 
 #include <fstream>
 #include <sstream>
+#include <atomic>
+#include <condition_variable>
+#include "tbb/atomic.h"
 
 // OpenCV includes
 #include <opencv2/videoio/videoio.hpp>  // Video write
@@ -39,6 +42,23 @@ namespace ofxCv {
 // ofxOpenFace addon
 #include "ofxOpenFaceDataSingleFace.h"
 #include "ofxOpenFaceDataSingleFaceTracked.h"
+#include "ofxOpenFaceFrameMailbox.h"
+#include "ofxOpenFaceSharedModel.h"
+#include "ofxOpenFaceMemory.h"
+#include "ofxOpenFaceDetector.h"
+#include "ofxOpenFaceDetectionScheduler.h"
+#include "ofxOpenFaceMotionMask.h"
+#include "ofxOpenFaceCoverage.h"
+#include "ofxOpenFaceStats.h"
+#include "ofxOpenFaceTrace.h"
+#include "ofxOpenFaceModelBundle.h"
+#include "ofxOpenFaceModelLoader.h"
+#include "ofxOpenFaceModelResidency.h"
+#include "ofxOpenFaceQualityController.h"
+#include "ofxOpenFaceFaceScheduler.h"
+#include "ofxOpenFaceFitPredictor.h"
+#include "ofxOpenFaceReacquisitionCache.h"
+#include "ofxOpenFaceFlowTracker.h"
 
 // Some useful preprocessor definitions
 //#define OFX_OPENFACE_DO_FACE_ANALYSIS 1 // uncomment to do AU analysis
@@ -52,25 +72,154 @@ namespace ofxCv {
 
 #pragma once
 
+class ofxOpenFaceEngine;
+
 class ofxOpenFace : public ofThread {
+    friend class ofxOpenFaceEngine;
     public:
         struct CameraSettings {
             int fx, fy, cx, cy;
         };
     
+        // What is computed for each face, see setOutputs(). The bounding box, certainty and ID always are.
+        enum Output {
+            OUTPUT_LANDMARKS_2D = 1 << 0, // allLandmarks2D
+            OUTPUT_POSE = 1 << 1, // pose
+            OUTPUT_GAZE = 1 << 2, // gazeLeftEye, gazeRightEye
+            OUTPUT_EYES_2D = 1 << 3, // eyeLandmarks2D
+            OUTPUT_EYES_3D = 1 << 4, // eyeLandmarks3D
+            OUTPUT_AUS = 1 << 5, // loads the face analyser, with OFX_OPENFACE_DO_FACE_ANALYSIS
+            OUTPUT_ALL = (1 << 6) - 1
+        };
+    
+        // Where the time of the last processed frame went, in milliseconds (multiple faces only)
+        struct LatencyBreakdown {
+            float fHandoffMs = 0.0f; // from setImage() to the worker picking the frame up
+            float fGrayMs = 0.0f;
+            float fDetectionMs = 0.0f; // detection on the frame's path, only the handoff to the detector when asynchronous
+            float fFittingMs = 0.0f; // landmarks, gaze and pose of all faces
+            float fPublishMs = 0.0f; // tracker update and events
+            float fTotalMs = 0.0f; // from setImage() to the end of the events
+            float fDetectorMs = 0.0f; // the last detector run, on whichever thread it ran
+            float fProposalsAgeMs = 0.0f; // asynchronous detection: age of the image behind the last proposals used
+        };
+    
+        // The work the motion gating saved, since the last reset
+        struct MotionStats {
+            uint64_t nFrames = 0;
+            uint64_t nGrayConversionsSkipped = 0; // frames that were never converted to grayscale
+            uint64_t nDetectionsSkipped = 0; // scheduled detections dropped because nothing moved since the last run
+            uint64_t nDetectionsRegional = 0; // scheduled detections run on the moving regions only
+            uint64_t nFits = 0; // landmark fits of tracked faces
+            uint64_t nFitsReused = 0; // tracked faces that kept their previous result instead
+            uint64_t nFitsPredicted = 0; // tracked faces extrapolated from their motion instead, see setFaceScheduling()
+            uint64_t nFitsFlow = 0; // tracked faces moved by optical flow instead, see setFlowTracking()
+        };
+    
         ofxOpenFace();
         ~ofxOpenFace();
         void setup(bool bTrackMultipleFaces, int nWidth, int nHeight, LandmarkDetector::FaceModelParameters::FaceDetector eDetectorFace,
                    LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks, CameraSettings settings, int persistenceMs, int maxDistancePx, int nMaxFacesTracked);
-        void setImage(ofPixels img);
-        void setImage(cv::Mat img);
-        void setImage(ofImage img);
+        // The image is copied into a preallocated frame, the caller can reuse its buffer right away.
+        // Call from a single thread.
+        void setImage(const ofPixels& img);
+        void setImage(const cv::Mat& img);
+        void setImage(const ofImage& img);
+        uint64_t getFramesSuperseded(); // frames replaced by a newer one before they were processed
+        // Multiple faces only, call before the first image. When pipelined, the next frames are converted to grayscale and
+        // searched for faces while the current one is fitted and tracked. Results are still delivered in order.
+        void setPipelined(bool bValue, int nFramesInFlightMax = 2);
+        // Multiple faces only, call before setup(). When asynchronous, the face detector runs on its own thread on the newest
+        // frame it can get, and free face models pick up its proposals on the first frame after they are ready.
+        void setAsyncDetection(bool bValue);
+        LatencyBreakdown getLatencyBreakdown();
+        // Multiple faces only, call before setup(). Decides on which frames the face detector runs, every 8th frame by default.
+        void setDetectionScheduler(shared_ptr<ofxOpenFaceDetectionScheduler> pScheduler);
+        shared_ptr<ofxOpenFaceDetectionScheduler> getDetectionScheduler(); // e.g. for its stats
+        // Multiple faces only, call before setup(). With motion gating, new faces are only looked for where the image moved since
+        // the last detector run (when less than half of it did, the whole frame otherwise), no run when nothing moved, and a tracked face with nothing moving under it keeps its previous result for up to nMaxReuseFrames frames.
+        // Tiles of nTileSizePx pixels count as moving when their mean difference with the previous frame is above fThreshold (0-255).
+        void setMotionGating(bool bValue, int nMaxReuseFrames = 15, int nTileSizePx = 32, float fThreshold = 6.0f);
+        MotionStats getMotionStats();
+        void resetMotionStats();
+        // Multiple faces only, on by default. The detector only scans the parts of the frame the tracked faces do not cover.
+        void setDetectUncoveredOnly(bool bValue);
+        float getDetectionScannedPercent(); // share of the submitted pixels the detector actually scanned
+        void resetDetectionScanned();
+        // Multiple faces only. With a model bundle, the patch experts of a scale and view are read from disk the first time a face
+        // needs them. With nIdleMinutes > 0, the ones no face used for that long are handed back to the OS until needed again.
+        // The streams of an engine share its model, use ofxOpenFaceEngine::setExpertEviction() for them.
+        void setExpertEviction(int nIdleMinutes);
+        ofxOpenFaceModelResidency::Stats getExpertResidency(); // the patch experts in memory against all of them
+        // Multiple faces only, call before setup(). The face models are a pool of slots: a face takes one when it is detected and
+        // gives it back once lost, and only the slots holding a face are fitted. The nMaxFacesTracked of setup() are built at setup and kept,
+        // a crowd grows the pool up to nMaxFacesHard (-1 for no growth), the slots above nMaxFacesTracked are freed after nReleaseMs unused.
+        void setFacePool(int nMaxFacesHard, int nReleaseMs = 10000);
+        int getFaceSlots(); // the face models built
+        int getFaceSlotsActive(); // of them, the ones holding a face
+        // Multiple faces only. Lowers the fitting quality of the faces, a level of a face at a time, while frames take longer than fMs
+        // to detect and fit, and raises it back when there is headroom again. 0 (default) for full quality.
+        // The level of each face is in ofxOpenFaceDataSingleFace::nQualityLevel, see ofxOpenFaceQualityController for the levels.
+        void setTargetFrameMs(float fMs);
+        // Multiple faces only. At most nFitsPerFrame tracked faces are fitted per frame (0, the default, for all of them): the largest,
+        // most certain, fastest and highest priority ones first. The others are extrapolated from their motion and flagged as predicted,
+        // none for more than nMaxSkipFrames frames in a row. New faces are always fitted.
+        void setFaceScheduling(int nFitsPerFrame, int nMaxSkipFrames = 4);
+        // Called from the worker with the last result of each tracked face, returns its priority: 1 by default, 0 for a face that can wait
+        void setFacePriorityCallback(function<float(const ofxOpenFaceDataSingleFace&)> callback);
+        // Multiple faces only. Each tracked face's fit starts from a constant velocity prediction of its pose and shape, and only searches
+        // at the finest scale with half the iterations while the predictions land within fResidualPx of the fitted landmarks.
+        void setFitPrediction(bool bValue, float fResidualPx = 1.5f);
+        // The optimisation iterations the fits were given, with or without prediction, and how well the predictions did
+        ofxOpenFaceFitPredictor::Stats getFitStats();
+        void resetFitStats();
+        // Multiple faces only. A face lost for a moment (turning away, occluded) is remembered under its tracker label for nLifetimeMs,
+        // and a new detection within fMaxDistance face widths of it starts tracking from its last good shape instead of from scratch.
+        void setReacquisition(bool bValue, int nLifetimeMs = 2000, float fMaxDistance = 0.5f);
+        // How many new faces were re-acquired, and what their first fits cost compared to the ones initialised from scratch
+        ofxOpenFaceReacquisitionCache::Stats getReacquisitionStats();
+        // Multiple faces only. A tracked face whose landmarks the optical flow follows confidently, after a fit of at least fMinCertainty,
+        // is moved by that flow instead of fitted, with a full fit at least every nRefitFrames frames. Cheap for faces that barely move.
+        void setFlowTracking(bool bValue, int nRefitFrames = 5, float fMinCertainty = 0.7f);
+        // The outputs computed for each face, a combination of Output, OUTPUT_ALL by default. The others are skipped and left empty.
+        // Read at setup() too: without OUTPUT_GAZE, OUTPUT_EYES_2D and OUTPUT_EYES_3D the eye models are not fitted at all,
+        // and without OUTPUT_AUS the face analyser is not loaded.
+        void setOutputs(int nValue);
+        int getOutputs();
+        // Multiple faces only, call after setup() and before the first image, and before the engine's startThread() for its streams.
+        // The patch experts, face models and detector build caches the first time they meet a window size, view or image size,
+        // which makes the first frames slow.
+        // Runs them once on a synthetic image of nWidth x nHeight (the tracking size by default), the face models in parallel.
+        // Returns the time it took in ms and resets the stats, the warm-up frames are not part of them.
+        float warmUp(int nWidth = -1, int nHeight = -1);
+        float getWarmUpMs(); // 0 without a warm-up
         vector<ofxOpenFaceDataSingleFaceTracked> getTracked();
 
         void exit();
         void stop();
         void resetFaceModel();
         int getFPS();
+        uint64_t getHandoffLatencyUs(); // time between the last setImage() and the worker picking it up
+        uint64_t getHandoffLatencyMaxUs(); // worst handoff latency since the last reset
+        void resetHandoffLatency();
+        // Percentiles of every processing stage since the last reset, safe to call while tracking
+        ofxOpenFaceStats::Snapshot getStats();
+        void resetStats();
+        // Call before setup(). Called from the loading threads after each model is loaded, e.g. for a splash screen.
+        void setLoadProgressCallback(function<void(const ofxOpenFaceModelLoader::Progress&)> callback);
+        ofxOpenFaceModelLoader::Report getLoadReport(); // the time each model took to load at setup()
+        // Record a span per stage, face model, detector run and event, with its thread, frame and face slot.
+        // The spans go to a ring buffer of nCapacity, saveTrace() writes them as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+        void setTracing(bool bValue, int nCapacity = 65536);
+        bool saveTrace(const string& sPath);
+        void clearTrace();
+        // Per instance, -1 for the static s_fCertaintyNorm and s_nKillAfterDisappearedMs
+        void setCertaintyNorm(float fValue);
+        void setKillAfterDisappearedMs(int nValue);
+        // Process the newest frame on the calling thread, false if there was none. For callers driving the instance themselves,
+        // such as ofxOpenFaceEngine, instead of startThread(). Not pipelined.
+        bool processNextFrame();
+        bool hasNewFrame() const;
     
         static string FaceDetectorToString(LandmarkDetector::FaceModelParameters::FaceDetector eValue);
         static string LandmarkDetectorToString(LandmarkDetector::FaceModelParameters::LandmarkDetector eValue);
@@ -84,17 +233,60 @@ class ofxOpenFace : public ofThread {
         static ofEvent<vector<ofxOpenFaceDataSingleFaceTracked>>      eventOpenFaceDataMultipleTracked;
         static ofEvent<bool>                                          eventOpenFaceDataClear; // no more faces
     
-        // Camera settings
+        // The same events for this instance only, to tell several cameras apart
+        ofEvent<ofxOpenFaceDataSingleFace>                  eventDataSingleRaw;
+        ofEvent<vector<ofxOpenFaceDataSingleFace>>          eventDataMultipleRaw;
+        ofEvent<ofxOpenFaceDataSingleFaceTracked>           eventDataSingleTracked;
+        ofEvent<vector<ofxOpenFaceDataSingleFaceTracked>>   eventDataMultipleTracked;
+        ofEvent<bool>                                       eventDataClear;
+    
+        static LandmarkDetector::CLNF* loadModel(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks); // with its face detectors
+    
+        // Camera settings of the faces without intrinsics of their own (see ofxOpenFaceDataSingleFace::bHasIntrinsics),
+        // set by the setup() of standalone instances, never by the streams of an engine
         static CameraSettings s_camSettings;
         static float s_fCertaintyNorm; // the normalized certainty below which we ignore a face
         static float s_nKillAfterDisappearedMs; // the time to wait before killing a face that has not reappared
     
     private:
+        // A frame going through the processing stages
+        struct FrameJob {
+            uint64_t                                    nSequence = 0; // position of the frame in the pipeline
+            uint64_t                                    nTimeSetUs = 0; // when the frame was set
+            uint64_t                                    nFrameNumber = 0; // of the mailbox, 1 for the first frame set
+            LatencyBreakdown                            latency;
+            cv::Mat                                     rgb;
+            cv::Mat                                     gray;
+            bool                                        bGray = false; // gray holds this frame
+            ofxOpenFaceMotionMask::Tiles                tiles; // the motion of this frame, when measured
+            vector<cv::Rect_<float>>                    detections;
+            bool                                        bDetected = false; // detections holds the result of a detector run
+            vector<ofxOpenFaceDataSingleFace>           vData;
+        };
+        struct Pipeline;
+    
         void setupSingleFace(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks, LandmarkDetector::FaceModelParameters::FaceDetector eDetectorFace);
         void setupMultipleFaces(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks, LandmarkDetector::FaceModelParameters::FaceDetector eDetectorFace);
-        ofxOpenFaceDataSingleFace processImageSingleFace();
-        vector<ofxOpenFaceDataSingleFace> processImageMultipleFaces();
+        ofxOpenFaceDataSingleFace processImageSingleFace(const cv::Mat& rgb_image, uint64_t nFrameNumber);
+        void processImageMultipleFaces(FrameJob& job);
+        void convertGray(FrameJob& job);
+        void ensureGray(FrameJob& job);
+        void detectFaces(FrameJob& job);
+        bool getDetectionRegions(const ofxOpenFaceMotionMask::Tiles& tiles, vector<cv::Rect>& vRegions); // false to scan the whole frame
+        void fitLandmarks(FrameJob& job);
+        void growFacePool(int nCount); // more face models, for the faces the free slots cannot take
+        void shrinkFacePool(); // frees the slots above nMaxFaces unused for nSlotReleaseMs
+        void predictFace(int model, ofxOpenFaceDataSingleFace& d); // one frame further along the face's motion
+        // The outputs of a fitted face, and its bounding box
+        void computeOutputs(LandmarkDetector::CLNF& face, int nOutputsFrame, ofxOpenFaceDataSingleFace& d, uint64_t nFrameNumber, int nFace);
+        void publishMultipleFaces(FrameJob& job);
+        void submitToPipeline(const ofxOpenFaceFrameMailbox::Frame& frame);
+        void finishPipelineFrame();
         virtual void threadedFunction();
+        const ofxOpenFaceFrameMailbox::Frame* takeFrame(); // consume the newest frame and record its handoff latency
+        void processFrame(const ofxOpenFaceFrameMailbox::Frame& frame); // all stages and the events, on the calling thread
+        void setStreamSettings(ofxOpenFaceDataSingleFace& d);
+        int getKillAfterDisappearedMs() const;
         void setFPS(float value);
     
         static void NonOverlapingDetections(const vector<LandmarkDetector::CLNF>& clnf_models, vector<cv::Rect_<float>>& face_detections);
@@ -102,23 +294,76 @@ class ofxOpenFace : public ofThread {
         int                                             nImgWidth;   // the width of the image used for tracking
         int                                             nImgHeight;  // the height of the image used for tracking
         int                                             nMaxFaces; // the maximum number of faces
-        int                                             nFrameCount; // count the frames being tracked
+        CameraSettings                                  camSettings; // of this instance's camera
+        float                                           fCertaintyNorm = -1.0f;
+        int                                             nKillAfterDisappearedMs = -1;
+        ofxOpenFaceEngine*                              pEngine = nullptr; // shares its model, runs this instance on its workers
+        std::atomic<bool>                               bEngineBusy{false}; // a frame of this instance is being processed by the engine
     
 #ifdef OFX_OPENFACE_DO_FACE_ANALYSIS
         FaceAnalysis::FaceAnalyserParameters*           pFace_analysis_params = nullptr;
         FaceAnalysis::FaceAnalyser*                     pFace_analyser = nullptr;
 #endif
-        vector<LandmarkDetector::CLNF>                  vFace_models;
-        LandmarkDetector::CLNF*                         pFace_model;
-        vector<bool>                                    vActiveModels;
+        vector<LandmarkDetector::CLNF>                  vFace_models; // share the weights of pFace_model
+        LandmarkDetector::CLNF*                         pFace_model = nullptr; // the loaded model, also holds the face detectors, the engine's when there is one
+        vector<tbb::atomic<bool>>                       vActiveModels; // read by the detection while the fitting updates it
         LandmarkDetector::FaceModelParameters           det_parameters;
         vector<LandmarkDetector::FaceModelParameters>   vDet_parameters;
-        bool                                            bExit = false; // flag to close the thread
-        ofMutex                                         mutexImage;
+        std::atomic<bool>                               bExit{false}; // flag to close the thread
+        ofMutex                                         mutexImage; // only guards the worker's sleep, never the frame data
+        std::condition_variable                         conditionNewImage; // wakes the worker when an image arrives or the thread stops
+        std::atomic<uint64_t>                           nHandoffLatencyUs{0};
+        std::atomic<uint64_t>                           nHandoffLatencyMaxUs{0};
         float                                           fTimePerRunMs = 0.0f;
         bool                                            bMultipleFaces;
-        bool                                            bHaveNewImage = false; // there is a new image available
         Utilities::FpsTracker                           fps_tracker;
-        cv::Mat                                         matToProcessColor; // the material to process for tracking
+        ofxOpenFaceFrameMailbox                         mailbox; // the images waiting to be processed
+        cv::Mat                                         matGray; // the grayscale version of the image being processed
+        FrameJob                                        jobSerial; // the frame being processed when not pipelined
+        bool                                            bPipelined = false;
+        int                                             nMaxFramesInFlight = 1;
+        std::atomic<int>                                nFramesInFlight{0};
+        uint64_t                                        nPipelineSequence = 0;
+        Pipeline*                                       pPipeline = nullptr;
+        ofxOpenFaceDetector                             detector; // runs the face detector of pFace_model
+        bool                                            bAsyncDetection = false;
+        ofMutex                                         mutexLatency;
+        LatencyBreakdown                                latencyLast; // of the last published frame
+        ofxOpenFaceStats                                stats;
+        ofxOpenFaceTrace                                trace;
+        function<void(const ofxOpenFaceModelLoader::Progress&)> loadProgressCallback;
+        ofxOpenFaceModelLoader::Report                  loadReport;
+        ofxOpenFaceModelResidency                       residency; // of the model, unless it is the engine's
+        ofxOpenFaceModelResidency*                      pResidency = &residency;
+        float                                           fWarmUpMs = 0.0f;
+        int                                             nMaxFacesHard = -1; // the pool's hard cap, -1 for nMaxFaces
+        int                                             nSlotReleaseMs = 10000;
+        int                                             nMaxSlots = 0; // the pool's hard cap, resolved at setup
+        std::atomic<int>                                nSlots{0}; // the face models built, read while the fitting grows the pool
+        vector<uint64_t>                                vSlotFreeSinceMs; // when each slot last gave its face back
+        ofxOpenFaceQualityController                    quality; // of each slot's fitting
+        ofxOpenFaceFaceScheduler                        faceScheduler; // which tracked faces are fitted on a frame
+        ofxOpenFaceFitPredictor                         fitPredictor; // seeds the fits, counts their iterations
+        ofxOpenFaceReacquisitionCache                   reacquisition; // the faces lost a moment ago
+        ofxOpenFaceFlowTracker                          flowTracker; // the fast path of the faces that barely move
+        std::atomic<int>                                nOutputs{OUTPUT_ALL};
+        function<float(const ofxOpenFaceDataSingleFace&)> facePriorityCallback;
+        vector<int>                                     vFramesSinceFit; // per slot, frames its face was extrapolated for
+        vector<cv::Point2f>                             vVelocity; // per slot, of its face between its last fits, in pixels per frame
+        vector<cv::Point2f>                             vLastFitCenter; // per slot, of its face's bounding box at its last fit
+        shared_ptr<ofxOpenFaceDetectionScheduler>       pDetectionScheduler;
+        std::atomic<int>                                nFailingModels{0}; // active models that failed on the last frame
+        bool                                            bMotionGating = false;
+        int                                             nMaxReuseFrames = 15;
+        int                                             nMotionTileSizePx = 32;
+        float                                           fMotionThreshold = 6.0f;
+        ofxOpenFaceMotionMask                           motionMask;
+        vector<ofxOpenFaceDataSingleFace>               vDataPrevious; // the last fitted result of every face model
+        vector<int>                                     vReuseFrames; // frames every face model has reused its result for
+        ofMutex                                         mutexMotionStats;
+        bool                                            bDetectUncoveredOnly = true;
+        ofMutex                                         mutexCoverage;
+        vector<cv::Rect_<float>>                        vCoveredFaces; // bounding boxes of the tracked faces after the last fitting
+        MotionStats                                     motionStats;
         ofxCv::TrackerFollower<ofxOpenFaceDataSingleFace, ofxOpenFaceDataSingleFaceTracked>  tracker;
 };
@@ -0,0 +1,110 @@
+#include "ofxOpenFaceCoverage.h"
+
+void ofxOpenFaceCoverage::getUncoveredRegions(cv::Size sizeFrame, const vector<cv::Rect_<float>>& vCovered, int nMarginPx, vector<cv::Rect>& vRegions, int nCellPx) {
+    vRegions.clear();
+    cv::Rect rFrame(0, 0, sizeFrame.width, sizeFrame.height);
+    if (vCovered.empty()) {
+        vRegions.push_back(rFrame);
+        return;
+    }
+
+    // Mark the cells lying entirely inside a covered rectangle
+    nCellPx = MAX(1, nCellPx);
+    int nCols = (sizeFrame.width + nCellPx - 1) / nCellPx;
+    int nRows = (sizeFrame.height + nCellPx - 1) / nCellPx;
+    cv::Mat matCovered(nRows, nCols, CV_8U, cv::Scalar(0));
+    for (auto& r : vCovered) {
+        int x0 = ceil(r.x / nCellPx);
+        int y0 = ceil(r.y / nCellPx);
+        int x1 = floor((r.x + r.width) / nCellPx);
+        int y1 = floor((r.y + r.height) / nCellPx);
+        cv::Rect rCells = cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, nCols, nRows);
+        if (rCells.area() > 0) {
+            matCovered(rCells).setTo(255);
+        }
+    }
+
+    // Cut the uncovered cells into bands of rows and into bands of columns, keep whichever scans less
+    vector<cv::Rect> vRows, vColumns;
+    getRegions(matCovered, nCellPx, nMarginPx, rFrame, vRows);
+    cv::Mat matCoveredT = matCovered.t();
+    getRegions(matCoveredT, nCellPx, nMarginPx, cv::Rect(0, 0, rFrame.height, rFrame.width), vColumns);
+    for (auto& r : vColumns) {
+        r = cv::Rect(r.y, r.x, r.height, r.width);
+    }
+    vRegions = (getArea(vColumns) < getArea(vRows)) ? vColumns : vRows;
+}
+
+void ofxOpenFaceCoverage::getRegions(const cv::Mat& matCovered, int nCellPx, int nMarginPx, cv::Rect rFrame, vector<cv::Rect>& vRegions) {
+    // Runs of uncovered cells per row, a run continues the rectangle above it when it spans the same columns
+    struct Open { int x0, x1, y0; };
+    vector<Open> vOpen, vNext;
+    vector<cv::Rect> vCells;
+    for (int y = 0; y <= matCovered.rows; y++) {
+        vNext.clear();
+        if (y < matCovered.rows) {
+            const uchar* pRow = matCovered.ptr<uchar>(y);
+            for (int x = 0; x < matCovered.cols;) {
+                if (pRow[x]) {
+                    x++;
+                    continue;
+                }
+                int x0 = x;
+                while (x < matCovered.cols && !pRow[x]) {
+                    x++;
+                }
+                int y0 = y;
+                for (auto& o : vOpen) {
+                    if (o.x0 == x0 && o.x1 == x) {
+                        y0 = o.y0;
+                        o.x1 = -1; // taken
+                        break;
+                    }
+                }
+                vNext.push_back({x0, x, y0});
+            }
+        }
+        // Whatever did not continue is done
+        for (auto& o : vOpen) {
+            if (o.x1 >= 0) {
+                vCells.push_back(cv::Rect(o.x0, o.y0, o.x1 - o.x0, y - o.y0));
+            }
+        }
+        std::swap(vOpen, vNext);
+    }
+
+    // Back to pixels. A side touching another region gets the whole margin, a face across the border must fit in one of them.
+    // A side touching a tracked face gets half of it, for new faces partly hidden behind it.
+    cv::Rect rCells(0, 0, matCovered.cols, matCovered.rows);
+    vRegions.clear();
+    for (auto& c : vCells) {
+        cv::Rect rAbove = cv::Rect(c.x, c.y - 1, c.width, 1) & rCells;
+        cv::Rect rBelow = cv::Rect(c.x, c.y + c.height, c.width, 1) & rCells;
+        int nTop = (rAbove.area() > 0 && cv::countNonZero(matCovered(rAbove)) < rAbove.area()) ? nMarginPx : nMarginPx / 2;
+        int nBottom = (rBelow.area() > 0 && cv::countNonZero(matCovered(rBelow)) < rBelow.area()) ? nMarginPx : nMarginPx / 2;
+        // Runs end on covered cells or on the frame, never on another run
+        int nSide = nMarginPx / 2;
+        cv::Rect r(c.x * nCellPx - nSide, c.y * nCellPx - nTop, c.width * nCellPx + 2 * nSide, c.height * nCellPx + nTop + nBottom);
+        vRegions.push_back(r & rFrame);
+    }
+}
+
+void ofxOpenFaceCoverage::intersect(const vector<cv::Rect>& vA, const vector<cv::Rect>& vB, vector<cv::Rect>& vResult, int nMinSizePx) {
+    vResult.clear();
+    for (auto& a : vA) {
+        for (auto& b : vB) {
+            cv::Rect r = a & b;
+            if (r.width >= nMinSizePx && r.height >= nMinSizePx) {
+                vResult.push_back(r);
+            }
+        }
+    }
+}
+
+uint64_t ofxOpenFaceCoverage::getArea(const vector<cv::Rect>& vRegions) {
+    uint64_t nArea = 0;
+    for (auto& r : vRegions) {
+        nArea += r.area();
+    }
+    return nArea;
+}
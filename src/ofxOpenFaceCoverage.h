@@ -0,0 +1,19 @@
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#pragma once
+
+// Splits a frame into the rectangles the face detector still has to scan, given the faces already being tracked
+class ofxOpenFaceCoverage {
+public:
+    // Rectangles covering every part of the frame outside vCovered. They overlap by nMarginPx, so a face up to twice that size
+    // with its centre outside vCovered is whole in one of them. Works on cells of nCellPx pixels: a cell only counts as covered
+    // when a face covers all of it.
+    static void getUncoveredRegions(cv::Size sizeFrame, const vector<cv::Rect_<float>>& vCovered, int nMarginPx, vector<cv::Rect>& vRegions, int nCellPx = 16);
+    // The parts of vA that are also in vB, dropping the ones smaller than nMinSizePx on a side
+    static void intersect(const vector<cv::Rect>& vA, const vector<cv::Rect>& vB, vector<cv::Rect>& vResult, int nMinSizePx);
+    static uint64_t getArea(const vector<cv::Rect>& vRegions); // sum of the areas, overlaps counted twice
+
+private:
+    static void getRegions(const cv::Mat& matCovered, int nCellPx, int nMarginPx, cv::Rect rFrame, vector<cv::Rect>& vRegions);
+};
@@ -15,7 +15,9 @@ void ofxOpenFaceDataSingleFace::draw(bool bForceDraw) {
     // Draw the pose
     auto vis_certainty = certainty;
     //auto color = cv::Scalar(vis_certainty*255.0, 0, (1 - vis_certainty) * 255);
-    auto lines = Utilities::CalculateBox(pose, ofxOpenFace::s_camSettings.fx, ofxOpenFace::s_camSettings.fy, ofxOpenFace::s_camSettings.cx, ofxOpenFace::s_camSettings.cy);
+    float fxCam, fyCam, cxCam, cyCam;
+    getIntrinsics(fxCam, fyCam, cxCam, cyCam);
+    auto lines = Utilities::CalculateBox(pose, fxCam, fyCam, cxCam, cyCam);
     ofSetLineWidth(nThickness);
     ofColor colorBox(vis_certainty*255.0, 0, (1 - vis_certainty) * 255);
     ofSetColor(colorBox);
@@ -103,7 +105,9 @@ void ofxOpenFaceDataSingleFace::drawGazes() {
     }
     
     // Now draw the gaze lines themselves
-    cv::Mat cameraMat = (cv::Mat_<double>(3, 3) << ofxOpenFace::s_camSettings.fx, 0, ofxOpenFace::s_camSettings.cx, 0, ofxOpenFace::s_camSettings.fy, ofxOpenFace::s_camSettings.cy, 0, 0, 0);
+    float fxCam, fyCam, cxCam, cyCam;
+    getIntrinsics(fxCam, fyCam, cxCam, cyCam);
+    cv::Mat cameraMat = (cv::Mat_<double>(3, 3) << fxCam, 0, cxCam, 0, fyCam, cyCam, 0, 0, 0);
     
     // Grabbing the pupil location, to draw eye gaze need to know where the pupil is
     cv::Point3f pupil_left(0, 0, 0);
@@ -127,7 +131,7 @@ void ofxOpenFaceDataSingleFace::drawGazes() {
     // TODO: figure out why 3D gaze is not drawn
     cv::Mat_<float> proj_points;
     cv::Mat_<float> mesh_0 = (cv::Mat_<float>(2, 3) << points_left[0].x, points_left[0].y, points_left[0].z, points_left[1].x, points_left[1].y, points_left[1].z);
-    Utilities::Project(proj_points, mesh_0, ofxOpenFace::s_camSettings.fx, ofxOpenFace::s_camSettings.fy, ofxOpenFace::s_camSettings.cx, ofxOpenFace::s_camSettings.cy);
+    Utilities::Project(proj_points, mesh_0, fxCam, fyCam, cxCam, cyCam);
     
     ofSetColor(ofColor::aquamarine);
     cv::Point2d cvPt1(cvRound(proj_points.at<double>(0, 0) * (double)draw_multiplier), cvRound(proj_points.at<double>(0, 1) * (double)draw_multiplier));
@@ -139,9 +143,23 @@ void ofxOpenFaceDataSingleFace::drawGazes() {
     ofDrawLine(pt1, pt2);
     
     cv::Mat_<float> mesh_1 = (cv::Mat_<float>(2, 3) << points_right[0].x, points_right[0].y, points_right[0].z, points_right[1].x, points_right[1].y, points_right[1].z);
-    Utilities::Project(proj_points, mesh_1, ofxOpenFace::s_camSettings.fx, ofxOpenFace::s_camSettings.fy, ofxOpenFace::s_camSettings.cx, ofxOpenFace::s_camSettings.cy);
+    Utilities::Project(proj_points, mesh_1, fxCam, fyCam, cxCam, cyCam);
     
     cvPt1 = cv::Point(cvRound(proj_points.at<double>(0, 0) * (double)draw_multiplier), cvRound(proj_points.at<double>(0, 1) * (double)draw_multiplier));
     cvPt2 = cv::Point(cvRound(proj_points.at<double>(1, 0) * (double)draw_multiplier), cvRound(proj_points.at<double>(1, 1) * (double)draw_multiplier));
     ofDrawLine(pt1, pt2);
 }
+
+void ofxOpenFaceDataSingleFace::getIntrinsics(float& fxOut, float& fyOut, float& cxOut, float& cyOut) const {
+    if (!bHasIntrinsics) {
+        fxOut = ofxOpenFace::s_camSettings.fx;
+        fyOut = ofxOpenFace::s_camSettings.fy;
+        cxOut = ofxOpenFace::s_camSettings.cx;
+        cyOut = ofxOpenFace::s_camSettings.cy;
+    } else {
+        fxOut = fx;
+        fyOut = fy;
+        cxOut = cx;
+        cyOut = cy;
+    }
+}
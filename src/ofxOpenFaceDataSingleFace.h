@@ -8,6 +8,7 @@ class ofxOpenFaceDataSingleFace {
 public:
     bool                    cleared = false; // ignore data if true
     bool                    detected = false;
+    bool                    predicted = false; // extrapolated from the face's motion, not fitted on this frame
     cv::Point3f             gazeLeftEye;
     cv::Point3f             gazeRightEye;
     cv::Vec6d               pose;
@@ -17,7 +18,15 @@ public:
     double                  certainty = 0.0f;
     cv::Rect                rBoundingBox;
     string                  sFaceID = "";
+    int                     fx = 0, fy = 0, cx = 0, cy = 0; // the intrinsics of the camera that saw the face, when bHasIntrinsics
+    bool                    bHasIntrinsics = false; // false: the face comes from elsewhere, ofxOpenFace::s_camSettings are used
+    float                   fCertaintyNorm = -1.0f; // the settings of the instance that saw the face, -1 for the ofxOpenFace statics
+    int                     nKillAfterDisappearedMs = -1;
+    int                     nQualityLevel = 0; // of the fitting, 0 for full quality, see ofxOpenFaceQualityController
     
     void drawGazes();
     void draw(bool bForceDraw = false);
+    
+protected:
+    void getIntrinsics(float& fxOut, float& fyOut, float& cxOut, float& cyOut) const;
 };
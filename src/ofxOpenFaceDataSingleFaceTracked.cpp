@@ -4,6 +4,7 @@
 // Copy all data from the child class.
 ofxOpenFaceDataSingleFaceTracked::ofxOpenFaceDataSingleFaceTracked(const ofxOpenFaceDataSingleFace& d) {
     this->detected = d.detected;
+    this->predicted = d.predicted;
     this->gazeLeftEye = d.gazeLeftEye;
     this->gazeRightEye = d.gazeRightEye;
     this->pose = d.pose;
@@ -13,6 +14,14 @@ ofxOpenFaceDataSingleFaceTracked::ofxOpenFaceDataSingleFaceTracked(const ofxOpen
     this->certainty = d.certainty;
     this->rBoundingBox = d.rBoundingBox;
     this->sFaceID = d.sFaceID;
+    this->fx = d.fx;
+    this->fy = d.fy;
+    this->cx = d.cx;
+    this->cy = d.cy;
+    this->bHasIntrinsics = d.bHasIntrinsics;
+    this->fCertaintyNorm = d.fCertaintyNorm;
+    this->nKillAfterDisappearedMs = d.nKillAfterDisappearedMs;
+    this->nQualityLevel = d.nQualityLevel;
 }
 
 void ofxOpenFaceDataSingleFaceTracked::setup(const ofxOpenFaceDataSingleFace& track) {
@@ -22,7 +31,9 @@ void ofxOpenFaceDataSingleFaceTracked::setup(const ofxOpenFaceDataSingleFace& tr
 }
 
 void ofxOpenFaceDataSingleFaceTracked::update(const ofxOpenFaceDataSingleFace& track) {
-    if (track.certainty >= ofxOpenFace::s_fCertaintyNorm) {
+    float fCertaintyMin = track.fCertaintyNorm >= 0.0f ? track.fCertaintyNorm : ofxOpenFace::s_fCertaintyNorm;
+    int nForgetAfterMs = track.nKillAfterDisappearedMs >= 0 ? track.nKillAfterDisappearedMs : ofxOpenFace::s_nKillAfterDisappearedMs;
+    if (track.certainty >= fCertaintyMin) {
         // Remember those values
         auto nTimeAppearedMsPrevious = nTimeAppearedMs;
         auto nTimeLastSeenMsPrevious = nTimeLastSeenMs;
@@ -31,7 +42,7 @@ void ofxOpenFaceDataSingleFaceTracked::update(const ofxOpenFaceDataSingleFace& t
         nTimeAppearedMs = nTimeAppearedMsPrevious; // keep previous value
         // Did it reappear after having disappeared?
         auto timeSinceLastSeenMs = ofGetElapsedTimeMillis() - nTimeLastSeenMsPrevious;
-        if (timeSinceLastSeenMs > ofxOpenFace::s_nKillAfterDisappearedMs) {
+        if (timeSinceLastSeenMs > nForgetAfterMs) {
             // Refresh time appeared
             nTimeAppearedMs = ofGetElapsedTimeMillis();
         }
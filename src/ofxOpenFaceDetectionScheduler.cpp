@@ -0,0 +1,144 @@
+#include "ofxOpenFaceDetectionScheduler.h"
+
+bool ofxOpenFaceDetectionScheduler::shouldDetect(const FrameState& state) {
+    std::lock_guard<std::mutex> lock(mutexScheduler);
+    stats.nFrames++;
+    bool bDetect = decide(state);
+    if (bDetect) {
+        stats.nFired++;
+    }
+    return bDetect;
+}
+
+void ofxOpenFaceDetectionScheduler::reportDetection(float fDetectionMs, int nFacesFound) {
+    std::lock_guard<std::mutex> lock(mutexScheduler);
+    stats.nReported++;
+    stats.nFacesFound += nFacesFound;
+    stats.fDetectionMsTotal += fDetectionMs;
+    onDetection(fDetectionMs, nFacesFound);
+}
+
+void ofxOpenFaceDetectionScheduler::cancelDetection() {
+    std::lock_guard<std::mutex> lock(mutexScheduler);
+    if (stats.nFired > 0) {
+        stats.nFired--;
+    }
+    onCancel();
+}
+
+ofxOpenFaceDetectionScheduler::Stats ofxOpenFaceDetectionScheduler::getStats() {
+    std::lock_guard<std::mutex> lock(mutexScheduler);
+    return stats;
+}
+
+void ofxOpenFaceDetectionScheduler::resetStats() {
+    std::lock_guard<std::mutex> lock(mutexScheduler);
+    stats = Stats();
+}
+
+//--------------------------------------------------------------
+ofxOpenFaceDetectionSchedulerCadence::ofxOpenFaceDetectionSchedulerCadence(int nEveryFrames) {
+    nCadence = MAX(1, nEveryFrames);
+}
+
+string ofxOpenFaceDetectionSchedulerCadence::getName() const {
+    return "Every " + ofToString(nCadence) + " frames";
+}
+
+bool ofxOpenFaceDetectionSchedulerCadence::decide(const FrameState& state) {
+    // Count all frames, so that the cadence holds whether the slots are free or not
+    bool bDue = (nFrame++ % nCadence) == 0 || bOverdue;
+    if (!bDue || state.nFreeSlots <= 0) {
+        return false;
+    }
+    bOverdue = false;
+    return true;
+}
+
+void ofxOpenFaceDetectionSchedulerCadence::onCancel() {
+    bOverdue = true;
+}
+
+//--------------------------------------------------------------
+ofxOpenFaceDetectionSchedulerTimeBudget::ofxOpenFaceDetectionSchedulerTimeBudget(float fBudgetPercent) {
+    fBudget = ofClamp(fBudgetPercent / 100.0f, 0.01f, 1.0f);
+}
+
+string ofxOpenFaceDetectionSchedulerTimeBudget::getName() const {
+    return ofToString(fBudget * 100.0f, 0) + "% time budget";
+}
+
+bool ofxOpenFaceDetectionSchedulerTimeBudget::decide(const FrameState& state) {
+    // Earn credit with the time going by, never more than a second's worth
+    uint64_t nTimeUs = ofGetElapsedTimeMicros();
+    if (nTimeLastUs > 0) {
+        fCreditMs = MIN(fCreditMs + fBudget * (nTimeUs - nTimeLastUs) / 1000.0f, 1000.0f * fBudget);
+    }
+    nTimeLastUs = nTimeUs;
+
+    if (state.nFreeSlots <= 0 || fCreditMs < fCostMs) {
+        return false;
+    }
+    // Pay for it now with the estimate, onDetection() corrects it with the actual cost
+    fChargedMs = fCostMs;
+    fCreditMs -= fChargedMs;
+    return true;
+}
+
+void ofxOpenFaceDetectionSchedulerTimeBudget::onCancel() {
+    fCreditMs += fChargedMs;
+    fChargedMs = 0.0f;
+}
+
+void ofxOpenFaceDetectionSchedulerTimeBudget::onDetection(float fDetectionMs, int nFacesFound) {
+    fCreditMs += fCostMs - fDetectionMs;
+    fCostMs = (fCostMs == 0.0f) ? fDetectionMs : 0.8f * fCostMs + 0.2f * fDetectionMs;
+}
+
+//--------------------------------------------------------------
+ofxOpenFaceDetectionSchedulerAdaptive::ofxOpenFaceDetectionSchedulerAdaptive(int nMin, int nMax, float fThreshold) {
+    nCadenceMin = MAX(1, nMin);
+    nCadenceMax = MAX(nCadenceMin, nMax);
+    fMotionThreshold = fThreshold;
+    nCadence = nCadenceMin;
+    nFramesSinceDetection = nCadenceMax; // look on the first frame
+}
+
+string ofxOpenFaceDetectionSchedulerAdaptive::getName() const {
+    return "Adaptive, every " + ofToString(nCadenceMin) + " to " + ofToString(nCadenceMax) + " frames";
+}
+
+bool ofxOpenFaceDetectionSchedulerAdaptive::needsMotion() const {
+    return fMotionThreshold >= 0.0f;
+}
+
+bool ofxOpenFaceDetectionSchedulerAdaptive::decide(const FrameState& state) {
+    // Something changed, look again soon
+    bool bSlotFreed = nFreeSlotsLast >= 0 && state.nFreeSlots > nFreeSlotsLast;
+    bool bMoving = fMotionThreshold >= 0.0f && state.fMotion > fMotionThreshold;
+    if (bSlotFreed || state.nFailingSlots > 0 || bMoving) {
+        nCadence = nCadenceMin;
+    }
+    nFreeSlotsLast = state.nFreeSlots;
+
+    nFramesSinceDetection++;
+    if (state.nFreeSlots <= 0 || nFramesSinceDetection < nCadence) {
+        return false;
+    }
+    nFramesSinceDetectionCancelled = nFramesSinceDetection;
+    nFramesSinceDetection = 0;
+    return true;
+}
+
+void ofxOpenFaceDetectionSchedulerAdaptive::onCancel() {
+    nFramesSinceDetection = nFramesSinceDetectionCancelled;
+}
+
+void ofxOpenFaceDetectionSchedulerAdaptive::onDetection(float fDetectionMs, int nFacesFound) {
+    // Nothing new: wait twice as long before the next look
+    if (nFacesFound > 0) {
+        nCadence = nCadenceMin;
+    } else {
+        nCadence = MIN(nCadence * 2, nCadenceMax);
+    }
+}
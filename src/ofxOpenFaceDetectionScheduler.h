@@ -0,0 +1,103 @@
+#include "ofMain.h"
+
+#pragma once
+
+// Decides on which frames the full-frame face detector runs when tracking multiple faces.
+// Derive from it and implement decide() to plug in a policy of your own, see ofxOpenFace::setDetectionScheduler().
+// ofxOpenFace calls shouldDetect() once per frame and reportDetection() once the detections of a run reach the fitting,
+// or cancelDetection() right away when it drops a run shouldDetect() asked for (nothing moved, nowhere left to look).
+class ofxOpenFaceDetectionScheduler {
+public:
+    // What the scheduler knows about the current frame
+    struct FrameState {
+        int     nSlots = 0; // face models
+        int     nFreeSlots = 0; // face models not tracking a face
+        int     nFailingSlots = 0; // tracking face models that failed on their last frame(s)
+        float   fMotion = -1.0f; // mean absolute difference with the previous frame (0-255), -1 if not measured
+    };
+
+    struct Stats {
+        uint64_t    nFrames = 0; // frames the scheduler was asked about
+        uint64_t    nFired = 0; // frames it ran the detector on
+        uint64_t    nReported = 0; // detector runs whose results reached the fitting
+        uint64_t    nFacesFound = 0; // new faces those runs proposed
+        float       fDetectionMsTotal = 0.0f;
+        float getFiredPercent() const { return nFrames > 0 ? 100.0f * nFired / nFrames : 0.0f; }
+        float getDetectionMsMean() const { return nReported > 0 ? fDetectionMsTotal / nReported : 0.0f; }
+    };
+
+    virtual ~ofxOpenFaceDetectionScheduler() {}
+    virtual string getName() const = 0;
+    virtual bool needsMotion() const { return false; } // true to get FrameState::fMotion measured
+
+    bool shouldDetect(const FrameState& state);
+    void reportDetection(float fDetectionMs, int nFacesFound); // nFacesFound: detections not overlapping a tracked face
+    void cancelDetection(); // the last run shouldDetect() asked for did not happen, it is neither counted nor paid for
+    Stats getStats();
+    void resetStats();
+
+protected:
+    // All are called under the scheduler's lock
+    virtual bool decide(const FrameState& state) = 0;
+    virtual void onDetection(float fDetectionMs, int nFacesFound) {}
+    virtual void onCancel() {} // undo what the last decide() returning true committed
+
+private:
+    ofMutex     mutexScheduler; // the detection and fitting stages can run at the same time
+    Stats       stats;
+};
+
+// Runs the detector every nth frame while a face model is free
+class ofxOpenFaceDetectionSchedulerCadence : public ofxOpenFaceDetectionScheduler {
+public:
+    ofxOpenFaceDetectionSchedulerCadence(int nEveryFrames = 8);
+    string getName() const;
+
+protected:
+    bool decide(const FrameState& state);
+    void onCancel();
+
+    int         nCadence;
+    uint64_t    nFrame = 0;
+    bool        bOverdue = false; // the last due run was cancelled, run on the next frame with a free slot
+};
+
+// Lets the detector take at most a share of the wall clock time while a face model is free
+class ofxOpenFaceDetectionSchedulerTimeBudget : public ofxOpenFaceDetectionScheduler {
+public:
+    ofxOpenFaceDetectionSchedulerTimeBudget(float fBudgetPercent = 20.0f);
+    string getName() const;
+
+protected:
+    bool decide(const FrameState& state);
+    void onDetection(float fDetectionMs, int nFacesFound);
+    void onCancel();
+
+    float       fBudget; // 0-1
+    float       fCreditMs = 0.0f; // detection time earned and not spent yet
+    float       fCostMs = 0.0f; // running estimate of one detection
+    float       fChargedMs = 0.0f; // paid by the last run, refunded when it is cancelled
+    uint64_t    nTimeLastUs = 0;
+};
+
+// Detects often right after something changed and backs off while nothing new turns up.
+// A frame counts as a change when a slot gets freed, a tracked face starts failing or the scene moves.
+class ofxOpenFaceDetectionSchedulerAdaptive : public ofxOpenFaceDetectionScheduler {
+public:
+    ofxOpenFaceDetectionSchedulerAdaptive(int nCadenceMin = 2, int nCadenceMax = 32, float fMotionThreshold = 3.0f);
+    string getName() const;
+    bool needsMotion() const;
+
+protected:
+    bool decide(const FrameState& state);
+    void onDetection(float fDetectionMs, int nFacesFound);
+    void onCancel();
+
+    int         nCadenceMin;
+    int         nCadenceMax;
+    float       fMotionThreshold; // set < 0 to ignore the motion
+    int         nCadence; // the current one, between min and max
+    int         nFramesSinceDetection = 0;
+    int         nFramesSinceDetectionCancelled = 0; // before the last run, restored when it is cancelled
+    int         nFreeSlotsLast = -1;
+};
@@ -0,0 +1,174 @@
+#include "ofxOpenFaceDetector.h"
+
+ofxOpenFaceDetector::~ofxOpenFaceDetector() {
+    stop();
+    waitForThread(true);
+}
+
+void ofxOpenFaceDetector::setup(LandmarkDetector::CLNF* pModelDetectors, LandmarkDetector::FaceModelParameters::FaceDetector eFaceDetector, ofMutex* pMutexShared) {
+    pModel = pModelDetectors;
+    eDetector = eFaceDetector;
+    pMutexModel = pMutexShared;
+}
+
+void ofxOpenFaceDetector::detect(const cv::Mat& gray, vector<cv::Rect_<float>>& vDetections) {
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    detectIn(gray, vDetections);
+    nPixelsScanned += gray.total();
+    nPixelsSubmitted += gray.total();
+    uint64_t nTimeUs = ofGetElapsedTimeMicros() - nTimeStartUs;
+    fLastDetectionMs = nTimeUs / 1000.0f;
+    if (pStats != nullptr) {
+        pStats->record(ofxOpenFaceStats::STAGE_DETECTION, nTimeUs);
+    }
+}
+
+void ofxOpenFaceDetector::detect(const cv::Mat& gray, vector<cv::Rect_<float>>& vDetections, const vector<cv::Rect>& vRegions) {
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    vDetections.clear();
+    vector<cv::Rect_<float>> vRegionDetections;
+    cv::Rect rFrame(0, 0, gray.cols, gray.rows);
+    for (auto& r : vRegions) {
+        cv::Rect rRegion = r & rFrame;
+        if (rRegion.width < MIN_REGION_SIZE || rRegion.height < MIN_REGION_SIZE) {
+            continue;
+        }
+        // Detect in a view of the region and move the results back to frame coordinates (MTCNN takes no roi, views work for all)
+        detectIn(gray(rRegion), vRegionDetections);
+        nPixelsScanned += rRegion.area();
+        for (auto& d : vRegionDetections) {
+            cv::Rect_<float> rDetection(d.x + rRegion.x, d.y + rRegion.y, d.width, d.height);
+            // Regions overlap by a margin, keep the larger of two detections of the same face
+            bool bNew = true;
+            for (auto& other : vDetections) {
+                float fIntersection = (other & rDetection).area();
+                if (fIntersection > 0.5f * MIN(other.area(), rDetection.area())) {
+                    if (rDetection.area() > other.area()) {
+                        other = rDetection;
+                    }
+                    bNew = false;
+                    break;
+                }
+            }
+            if (bNew) {
+                vDetections.push_back(rDetection);
+            }
+        }
+    }
+    nPixelsSubmitted += gray.total();
+    uint64_t nTimeUs = ofGetElapsedTimeMicros() - nTimeStartUs;
+    fLastDetectionMs = nTimeUs / 1000.0f;
+    if (pStats != nullptr) {
+        pStats->record(ofxOpenFaceStats::STAGE_DETECTION, nTimeUs);
+    }
+}
+
+void ofxOpenFaceDetector::detectIn(const cv::Mat& gray, vector<cv::Rect_<float>>& vDetections) {
+    vDetections.clear();
+    vector<float> confidences;
+    std::unique_lock<std::mutex> lock;
+    if (pMutexModel != nullptr) {
+        lock = std::unique_lock<std::mutex>(*pMutexModel);
+    }
+    if (eDetector == LandmarkDetector::FaceModelParameters::HOG_SVM_DETECTOR) {
+        LandmarkDetector::DetectFacesHOG(vDetections, gray, pModel->face_detector_HOG, confidences);
+    } else if (eDetector == LandmarkDetector::FaceModelParameters::HAAR_DETECTOR) {
+        LandmarkDetector::DetectFaces(vDetections, gray, pModel->face_detector_HAAR);
+    } else {
+        LandmarkDetector::DetectFacesMTCNN(vDetections, gray, pModel->face_detector_MTCNN, confidences);
+    }
+}
+
+void ofxOpenFaceDetector::setImage(const cv::Mat& gray, uint64_t nFrameNumber) {
+    setImage(gray, vector<cv::Rect>(), nFrameNumber);
+}
+
+void ofxOpenFaceDetector::setImage(const cv::Mat& gray, const vector<cv::Rect>& vRegions, uint64_t nFrameNumber) {
+    // The regions and the frame number travel with the image
+    mailbox.publish(gray, nFrameNumber, vRegions);
+    // Taking the lock makes sure the worker is either waiting already or will see the new image
+    mutexProposals.lock();
+    mutexProposals.unlock();
+    conditionNewImage.notify_one();
+}
+
+bool ofxOpenFaceDetector::takeProposals(vector<cv::Rect_<float>>& vDetections) {
+    std::lock_guard<std::mutex> lock(mutexProposals);
+    if (!bHaveProposals) {
+        return false;
+    }
+    vDetections = vProposals;
+    bHaveProposals = false;
+    fProposalsAgeMs = (ofGetElapsedTimeMicros() - nProposalsTimeSetUs) / 1000.0f;
+    return true;
+}
+
+void ofxOpenFaceDetector::stop() {
+    mutexProposals.lock();
+    bExit = true;
+    mutexProposals.unlock();
+    conditionNewImage.notify_all();
+}
+
+float ofxOpenFaceDetector::getLastDetectionMs() {
+    return fLastDetectionMs;
+}
+
+float ofxOpenFaceDetector::getProposalsAgeMs() {
+    return fProposalsAgeMs;
+}
+
+uint64_t ofxOpenFaceDetector::getPixelsScanned() {
+    return nPixelsScanned;
+}
+
+uint64_t ofxOpenFaceDetector::getPixelsSubmitted() {
+    return nPixelsSubmitted;
+}
+
+void ofxOpenFaceDetector::setStats(ofxOpenFaceStats* pStatsValue) {
+    pStats = pStatsValue;
+}
+
+void ofxOpenFaceDetector::setTrace(ofxOpenFaceTrace* pTraceValue) {
+    pTrace = pTraceValue;
+}
+
+void ofxOpenFaceDetector::resetPixelCounts() {
+    nPixelsScanned = 0;
+    nPixelsSubmitted = 0;
+}
+
+void ofxOpenFaceDetector::threadedFunction() {
+    thread.setName("ofxOpenFaceDetector " + thread.name());
+    vector<cv::Rect_<float>> vDetections;
+
+    while (!bExit) {
+        // Wait for an image
+        std::unique_lock<std::mutex> lock(mutexProposals);
+        conditionNewImage.wait(lock, [this] { return mailbox.hasNewFrame() || bExit; });
+        lock.unlock();
+        if (bExit) {
+            break;
+        }
+
+        // Always work on the newest image
+        const ofxOpenFaceFrameMailbox::Frame* pFrame = mailbox.consume();
+        uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+        if (pFrame->vRegions.empty()) {
+            detect(pFrame->mat, vDetections);
+        } else {
+            detect(pFrame->mat, vDetections, pFrame->vRegions);
+        }
+        if (pTrace != nullptr) {
+            pTrace->record("Face detector (async)", nTimeStartUs, ofGetElapsedTimeMicros(), pFrame->nFrameNumber);
+        }
+
+        // Replace the previous proposals, whether they were taken or not
+        lock.lock();
+        vProposals = vDetections;
+        bHaveProposals = true;
+        nProposalsTimeSetUs = pFrame->nTimeSetUs;
+        lock.unlock();
+    }
+}
@@ -0,0 +1,58 @@
+#include "ofMain.h"
+#include "ofThread.h"
+#include "LandmarkCoreIncludes.h"
+#include "ofxOpenFaceFrameMailbox.h"
+#include "ofxOpenFaceStats.h"
+#include "ofxOpenFaceTrace.h"
+#include <atomic>
+#include <condition_variable>
+
+#pragma once
+
+// Runs the face detector of a loaded model, either on the calling thread or on its own thread.
+// When asynchronous, it works on the newest grayscale image it was given and keeps its latest proposals until they are taken.
+class ofxOpenFaceDetector : public ofThread {
+public:
+    ~ofxOpenFaceDetector();
+    // pMutexShared: held during detections, when other detectors run the same model's detectors
+    void setup(LandmarkDetector::CLNF* pModel, LandmarkDetector::FaceModelParameters::FaceDetector eDetector, ofMutex* pMutexShared = nullptr);
+    void detect(const cv::Mat& gray, vector<cv::Rect_<float>>& vDetections); // synchronous, on the calling thread
+    // Only inside the regions, faces found in several overlapping regions are reported once
+    void detect(const cv::Mat& gray, vector<cv::Rect_<float>>& vDetections, const vector<cv::Rect>& vRegions);
+
+    // Asynchronous use, after startThread()
+    // nFrameNumber: of the camera frame, only for the trace
+    void setImage(const cv::Mat& gray, uint64_t nFrameNumber = 0); // copies the image and returns right away
+    void setImage(const cv::Mat& gray, const vector<cv::Rect>& vRegions, uint64_t nFrameNumber = 0); // only detect inside the regions
+    bool takeProposals(vector<cv::Rect_<float>>& vDetections); // false if there is nothing new since the last call
+    void stop();
+    float getLastDetectionMs(); // how long the last detection took
+    float getProposalsAgeMs(); // age of the image behind the last proposals taken, when they were taken
+    uint64_t getPixelsScanned(); // pixels the detector ran on since the last reset
+    uint64_t getPixelsSubmitted(); // pixels of the images it was given, so the scanned fraction is scanned / submitted
+    void resetPixelCounts();
+    void setStats(ofxOpenFaceStats* pStatsValue); // records every detection there
+    void setTrace(ofxOpenFaceTrace* pTraceValue); // records the asynchronous detections there
+
+private:
+    void threadedFunction();
+    void detectIn(const cv::Mat& gray, vector<cv::Rect_<float>>& vDetections);
+    static const int MIN_REGION_SIZE = 48; // the detectors do not find faces smaller than this
+
+    LandmarkDetector::CLNF*                                 pModel = nullptr; // owns the detectors
+    LandmarkDetector::FaceModelParameters::FaceDetector     eDetector = LandmarkDetector::FaceModelParameters::HAAR_DETECTOR;
+    ofMutex*                                                pMutexModel = nullptr; // guards the model's detectors when shared
+    ofxOpenFaceStats*                                       pStats = nullptr;
+    ofxOpenFaceTrace*                                       pTrace = nullptr;
+    ofxOpenFaceFrameMailbox                                 mailbox; // the images waiting for detection, with their regions and frame numbers
+    ofMutex                                                 mutexProposals; // guards the proposals and the worker's sleep
+    std::condition_variable                                 conditionNewImage;
+    std::atomic<bool>                                       bExit{false};
+    vector<cv::Rect_<float>>                                vProposals;
+    bool                                                    bHaveProposals = false;
+    uint64_t                                                nProposalsTimeSetUs = 0; // when the image behind the proposals was set
+    std::atomic<float>                                      fLastDetectionMs{0.0f};
+    std::atomic<float>                                      fProposalsAgeMs{0.0f};
+    std::atomic<uint64_t>                                   nPixelsScanned{0};
+    std::atomic<uint64_t>                                   nPixelsSubmitted{0};
+};
@@ -0,0 +1,138 @@
+#include "ofxOpenFaceEngine.h"
+#include "tbb/task_scheduler_init.h"
+
+ofxOpenFaceEngine::~ofxOpenFaceEngine() {
+    stop();
+    // The streams use the model's detectors until they are gone
+    vStreams.clear();
+    delete pModel;
+}
+
+void ofxOpenFaceEngine::setup(LandmarkDetector::FaceModelParameters::LandmarkDetector eLandmarks, LandmarkDetector::FaceModelParameters::FaceDetector eFace, int nThreadsValue) {
+    eDetectorLandmarks = eLandmarks;
+    eDetectorFace = eFace;
+    nThreads = nThreadsValue > 0 ? nThreadsValue : tbb::task_scheduler_init::default_num_threads();
+    // No slot is kept for the dispatcher, it only enqueues
+    arena.initialize(nThreads, 0);
+
+    uint64_t nMemoryBefore = ofxOpenFaceMemory::getResidentBytes();
+    pModel = ofxOpenFace::loadModel(eDetectorLandmarks);
+    residency.setup(*pModel);
+    ofLogNotice("ofxOpenFaceEngine", "Model: " + ofxOpenFaceMemory::toString((int64_t)ofxOpenFaceMemory::getResidentBytes() - (int64_t)nMemoryBefore) + ", " + ofToString(nThreads) + " threads");
+}
+
+ofxOpenFace& ofxOpenFaceEngine::addStream(int nWidth, int nHeight, ofxOpenFace::CameraSettings settings, int persistenceMs, int maxDistancePx, int nMaxFacesTracked, function<void(ofxOpenFace&)> configure) {
+    if (isThreadRunning()) {
+        ofLogError("ofxOpenFaceEngine", "addStream() must be called before startThread().");
+    }
+    vStreams.push_back(unique_ptr<ofxOpenFace>(new ofxOpenFace()));
+    ofxOpenFace& stream = *vStreams.back();
+    stream.pEngine = this;
+    if (configure) {
+        configure(stream);
+    }
+    if (stream.bPipelined) {
+        ofLogWarning("ofxOpenFaceEngine", "Streams are not pipelined, the engine overlaps the streams instead.");
+        stream.setPipelined(false);
+    }
+
+    uint64_t nMemoryBefore = ofxOpenFaceMemory::getResidentBytes();
+    stream.setup(true, nWidth, nHeight, eDetectorFace, eDetectorLandmarks, settings, persistenceMs, maxDistancePx, nMaxFacesTracked);
+    ofLogNotice("ofxOpenFaceEngine", "Stream " + ofToString(vStreams.size()) + ": " + ofxOpenFaceMemory::toString((int64_t)ofxOpenFaceMemory::getResidentBytes() - (int64_t)nMemoryBefore));
+    return stream;
+}
+
+ofxOpenFace& ofxOpenFaceEngine::getStream(int nIndex) {
+    return *vStreams.at(nIndex);
+}
+
+int ofxOpenFaceEngine::getNumStreams() const {
+    return vStreams.size();
+}
+
+int ofxOpenFaceEngine::getThreads() const {
+    return nThreads;
+}
+
+LandmarkDetector::CLNF* ofxOpenFaceEngine::getModel() {
+    return pModel;
+}
+
+ofMutex& ofxOpenFaceEngine::getDetectorMutex() {
+    return mutexDetector;
+}
+
+void ofxOpenFaceEngine::setExpertEviction(int nIdleMinutes) {
+    residency.setIdleTime((uint64_t)MAX(nIdleMinutes, 0) * 60000);
+}
+
+ofxOpenFaceModelResidency::Stats ofxOpenFaceEngine::getExpertResidency() {
+    return residency.getStats();
+}
+
+ofxOpenFaceModelResidency& ofxOpenFaceEngine::getResidency() {
+    return residency;
+}
+
+void ofxOpenFaceEngine::notifyFrame() {
+    // Taking the lock makes sure the dispatcher is either waiting already or will see the change
+    mutexDispatch.lock();
+    mutexDispatch.unlock();
+    conditionDispatch.notify_all();
+}
+
+void ofxOpenFaceEngine::stop() {
+    mutexDispatch.lock();
+    bExit = true;
+    mutexDispatch.unlock();
+    conditionDispatch.notify_all();
+    waitForThread(true);
+
+    // Let the frames being processed finish
+    std::unique_lock<std::mutex> lock(mutexDispatch);
+    conditionDispatch.wait(lock, [this] { return nBusy == 0; });
+}
+
+bool ofxOpenFaceEngine::isFrameWaiting() {
+    for (auto& pStream : vStreams) {
+        if (pStream->hasNewFrame() && !pStream->bEngineBusy) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ofxOpenFaceEngine::threadedFunction() {
+    thread.setName("ofxOpenFaceEngine " + thread.name());
+    ofLogNotice("ofxOpenFaceEngine", "Thread started.");
+
+    while (!bExit) {
+        // Wait until a stream has a frame and nothing in the works
+        std::unique_lock<std::mutex> lock(mutexDispatch);
+        conditionDispatch.wait(lock, [this] { return isFrameWaiting() || bExit; });
+        lock.unlock();
+        if (bExit) {
+            break;
+        }
+
+        // One frame per stream and round. Each round starts one stream further, so no stream is always served last.
+        int nStreams = vStreams.size();
+        for (int i = 0; i < nStreams; i++) {
+            ofxOpenFace* pStream = vStreams[(nNextStream + i) % nStreams].get();
+            if (!pStream->hasNewFrame() || pStream->bEngineBusy.exchange(true)) {
+                continue;
+            }
+            nBusy++;
+            arena.enqueue([this, pStream] {
+                pStream->processNextFrame();
+                pStream->bEngineBusy = false;
+                // Under the lock, so stop() cannot return and the engine be destroyed before the notify is done
+                std::lock_guard<std::mutex> lock(mutexDispatch);
+                nBusy--;
+                conditionDispatch.notify_all();
+            });
+        }
+        nNextStream = (nNextStream + 1) % max(nStreams, 1);
+    }
+    ofLogNotice("ofxOpenFaceEngine", "Thread stopped.");
+}
@@ -0,0 +1,54 @@
+#include "ofMain.h"
+#include "ofThread.h"
+#include "ofxOpenFace.h"
+#include "tbb/task_arena.h"
+#include <atomic>
+#include <condition_variable>
+
+#pragma once
+
+// Tracks the faces of several cameras with one loaded model and one pool of worker threads.
+// Every stream is an ofxOpenFace with its own camera settings, tracker, events, fps and latency, fed with setImage() as usual.
+// Their face models share the weights of the engine's model, so each stream only adds the state of its faces.
+// The engine hands the newest frame of each stream to a tbb::task_arena, taking the streams in turn so that none waits
+// behind a busier one. A stream has at most one frame being processed at a time.
+class ofxOpenFaceEngine : public ofThread {
+public:
+    ~ofxOpenFaceEngine();
+    // Loads the model and its face detectors. nThreads: the workers shared by all streams, 0 for one per core.
+    void setup(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks, LandmarkDetector::FaceModelParameters::FaceDetector eDetectorFace, int nThreads = 0);
+    // Add the streams after setup() and before startThread(). The stream is set up here, configure is called right before that,
+    // for the settings that go before ofxOpenFace::setup() (scheduler, motion gating...).
+    ofxOpenFace& addStream(int nWidth, int nHeight, ofxOpenFace::CameraSettings settings, int persistenceMs, int maxDistancePx, int nMaxFacesTracked,
+                           function<void(ofxOpenFace&)> configure = nullptr);
+    ofxOpenFace& getStream(int nIndex);
+    int getNumStreams() const;
+    void stop(); // waits for the frames being processed
+    int getThreads() const;
+
+    LandmarkDetector::CLNF* getModel(); // the model shared by all streams
+    ofMutex& getDetectorMutex(); // the model's face detectors are used by one stream at a time
+    // See ofxOpenFace::setExpertEviction(), for the model of all the streams
+    void setExpertEviction(int nIdleMinutes);
+    ofxOpenFaceModelResidency::Stats getExpertResidency();
+    ofxOpenFaceModelResidency& getResidency(); // shared by the streams
+    void notifyFrame(); // called by the streams when they get a new frame
+
+private:
+    void threadedFunction();
+    bool isFrameWaiting(); // a stream has a new frame and no frame being processed
+
+    LandmarkDetector::CLNF*                         pModel = nullptr;
+    LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks;
+    LandmarkDetector::FaceModelParameters::FaceDetector     eDetectorFace;
+    vector<unique_ptr<ofxOpenFace>>                 vStreams; // never moved once added, the streams' addresses are handed out
+    tbb::task_arena                                 arena;
+    int                                             nThreads = 0;
+    int                                             nNextStream = 0; // where the next round starts
+    std::atomic<int>                                nBusy{0};
+    std::atomic<bool>                               bExit{false};
+    ofMutex                                         mutexDispatch; // guards the dispatcher's sleep
+    std::condition_variable                         conditionDispatch; // a new frame or a stream done
+    ofMutex                                         mutexDetector;
+    ofxOpenFaceModelResidency                       residency;
+};
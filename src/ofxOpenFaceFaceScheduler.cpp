@@ -0,0 +1,50 @@
+#include "ofxOpenFaceFaceScheduler.h"
+
+void ofxOpenFaceFaceScheduler::setBudget(int nFitsPerFrameValue, int nMaxSkipFramesValue) {
+    nFitsPerFrame = MAX(nFitsPerFrameValue, 0);
+    nMaxSkipFrames = MAX(nMaxSkipFramesValue, 1);
+}
+
+bool ofxOpenFaceFaceScheduler::isEnabled() const {
+    return nFitsPerFrame > 0;
+}
+
+void ofxOpenFaceFaceScheduler::select(const vector<Face>& vFaces, vector<bool>& vFit) const {
+    for (auto& face : vFaces) {
+        if (face.nSlot >= 0 && face.nSlot < (int)vFit.size()) {
+            vFit[face.nSlot] = !isEnabled() || (int)vFaces.size() <= nFitsPerFrame;
+        }
+    }
+    if (!isEnabled() || (int)vFaces.size() <= nFitsPerFrame) {
+        return;
+    }
+
+    // The sizes are relative to the largest face, the subject near the camera
+    float fAreaMax = 1.0f;
+    for (auto& face : vFaces) {
+        fAreaMax = MAX(fAreaMax, face.fArea);
+    }
+    vector<pair<float, int>> vUrgency; // urgency, slot
+    int nFits = 0;
+    for (auto& face : vFaces) {
+        if (face.nSlot < 0 || face.nSlot >= (int)vFit.size()) {
+            continue;
+        }
+        if (face.nFramesSinceFit >= nMaxSkipFrames) {
+            // Waited long enough, whatever the budget
+            vFit[face.nSlot] = true;
+            nFits++;
+            continue;
+        }
+        // A fast face drifts away from its extrapolation sooner, a few pixels per frame doubles its score
+        float fScore = MAX(face.fPriority, 0.0f) * (0.25f + face.fArea / fAreaMax) * (0.5f + ofClamp(face.fCertainty, 0.0f, 1.0f)) * (1.0f + face.fSpeedPx / 4.0f);
+        vUrgency.push_back(make_pair(fScore * (1 + face.nFramesSinceFit), face.nSlot));
+    }
+    std::sort(vUrgency.begin(), vUrgency.end(), [](const pair<float, int>& a, const pair<float, int>& b) {
+        return a.first > b.first;
+    });
+    for (size_t i = 0; i < vUrgency.size() && nFits < nFitsPerFrame; i++) {
+        vFit[vUrgency[i].second] = true;
+        nFits++;
+    }
+}
@@ -0,0 +1,29 @@
+#include "ofMain.h"
+
+#pragma once
+
+// Decides which tracked faces get a landmark fit on a frame when there are more faces than fits per frame.
+// Each face is ranked by its size (near faces first), its certainty, how fast it moves and a priority of the caller's,
+// and the longer it waited the more urgent it gets, so small distant faces are fitted less often but never forgotten.
+// The faces left out are extrapolated from their motion by ofxOpenFace.
+class ofxOpenFaceFaceScheduler {
+public:
+    struct Face {
+        int     nSlot = 0;
+        float   fArea = 0.0f; // of the bounding box, in pixels
+        float   fCertainty = 0.0f; // 0-1
+        float   fSpeedPx = 0.0f; // per frame
+        float   fPriority = 1.0f; // the caller's, 0 for a face that can wait as long as allowed
+        int     nFramesSinceFit = 0;
+    };
+
+    // nFitsPerFrame: tracked faces fitted per frame, 0 to fit them all. A face is never left out more than nMaxSkipFrames in a row.
+    void setBudget(int nFitsPerFrame, int nMaxSkipFrames);
+    bool isEnabled() const;
+    // The faces to fit on this frame, in vFit by slot
+    void select(const vector<Face>& vFaces, vector<bool>& vFit) const;
+
+private:
+    int     nFitsPerFrame = 0;
+    int     nMaxSkipFrames = 4;
+};
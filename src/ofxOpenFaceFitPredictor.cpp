@@ -0,0 +1,143 @@
+#include "ofxOpenFaceFitPredictor.h"
+
+constexpr float ofxOpenFaceFitPredictor::VELOCITY_GAIN;
+
+string ofxOpenFaceFitPredictor::Stats::toString() const {
+    return ofToString(getIterationsPerFit(), 1) + " iterations per fit, " + ofToString(getCheapPercent(), 0) + "% narrowed fits, "
+        + ofToString(getResidualPxMean(), 2) + " px mean prediction residual (" + ofToString(nFits) + " fits)";
+}
+
+void ofxOpenFaceFitPredictor::setup(int nSlots) {
+    vSlots.clear();
+    vSlots.resize(nSlots);
+}
+
+void ofxOpenFaceFitPredictor::setEnabled(bool bValue, float fResidualPx) {
+    fResidualPxMax = fResidualPx;
+    bEnabled = bValue;
+}
+
+bool ofxOpenFaceFitPredictor::isEnabled() const {
+    return bEnabled;
+}
+
+void ofxOpenFaceFitPredictor::reset(int nSlot) {
+    if (nSlot < 0 || nSlot >= (int)vSlots.size()) {
+        return;
+    }
+    Slot& slot = vSlots[nSlot];
+    slot.bHasState = false;
+    slot.bHasVelocity = false;
+    slot.shapePredicted.release();
+    slot.fResidualPx = -1.0f;
+}
+
+LandmarkDetector::FaceModelParameters& ofxOpenFaceFitPredictor::predict(int nSlot, int nFrames, LandmarkDetector::CLNF& model, LandmarkDetector::FaceModelParameters& params) {
+    if (nSlot < 0 || nSlot >= (int)vSlots.size()) {
+        return params;
+    }
+    Slot& slot = vSlots[nSlot];
+    slot.nFrames = MAX(nFrames, 1);
+    slot.shapePredicted.release();
+    if (!bEnabled || !slot.bHasVelocity || slot.localParams.rows != model.params_local.rows) {
+        return params;
+    }
+
+    // Where the face should be by now, the fit refines it from there
+    model.params_global = slot.globalParams + slot.globalVelocity * (float)slot.nFrames;
+    model.params_local = slot.localParams + slot.localVelocity * (float)slot.nFrames;
+    model.pdm.CalcShape2D(model.detected_landmarks, model.params_local, model.params_global);
+    slot.shapePredicted = model.detected_landmarks.clone();
+
+    // The last prediction was close, this one should be too: only the finest scale, fewer iterations
+    if (slot.fResidualPx < 0.0f || slot.fResidualPx > fResidualPxMax) {
+        return params;
+    }
+    slot.paramsCheap = params;
+    for (int i = 0; i + 1 < (int)slot.paramsCheap.window_sizes_small.size(); i++) {
+        bool bFinerScale = false;
+        for (int j = i + 1; j < (int)slot.paramsCheap.window_sizes_small.size(); j++) {
+            bFinerScale = bFinerScale || slot.paramsCheap.window_sizes_small[j] > 0;
+        }
+        if (bFinerScale) {
+            slot.paramsCheap.window_sizes_small[i] = 0;
+        }
+    }
+    slot.paramsCheap.window_sizes_current = slot.paramsCheap.window_sizes_small;
+    slot.paramsCheap.num_optimisation_iteration = MAX(params.num_optimisation_iteration / 2, 1);
+    nFitsCheap++;
+    return slot.paramsCheap;
+}
+
+void ofxOpenFaceFitPredictor::correct(int nSlot, const LandmarkDetector::CLNF& model, const LandmarkDetector::FaceModelParameters& params, bool bSuccess, bool bFitted) {
+    if (bFitted) {
+        int nScales = 0;
+        for (int nSize : params.window_sizes_current) {
+            nScales += nSize > 0 ? 1 : 0;
+        }
+        nFits++;
+        nIterations += (uint64_t)(nScales * params.num_optimisation_iteration);
+    }
+    if (nSlot < 0 || nSlot >= (int)vSlots.size()) {
+        return;
+    }
+    Slot& slot = vSlots[nSlot];
+
+    // How far off the prediction was, there is none for a face moved without a fit
+    int nLandmarks = model.detected_landmarks.rows / 2;
+    if (!slot.shapePredicted.empty() && slot.shapePredicted.rows == model.detected_landmarks.rows && nLandmarks > 0) {
+        double fSum = 0.0;
+        for (int i = 0; i < nLandmarks; i++) {
+            float dx = model.detected_landmarks(i) - slot.shapePredicted(i);
+            float dy = model.detected_landmarks(i + nLandmarks) - slot.shapePredicted(i + nLandmarks);
+            fSum += sqrt(dx * dx + dy * dy);
+        }
+        slot.fResidualPx = fSum / nLandmarks;
+        nPredictions++;
+        nResidualMilliPx += (uint64_t)(slot.fResidualPx * 1000.0f);
+    } else if (bFitted) {
+        slot.fResidualPx = -1.0f;
+    }
+    slot.shapePredicted.release();
+
+    // A failed fit says nothing about the motion
+    if (!bSuccess) {
+        reset(nSlot);
+        return;
+    }
+    if (slot.bHasState && slot.localParams.rows == model.params_local.rows) {
+        float fFrames = (float)MAX(slot.nFrames, 1);
+        cv::Vec6f globalMeasured = (model.params_global - slot.globalParams) * (1.0f / fFrames);
+        cv::Mat_<float> localMeasured = (model.params_local - slot.localParams) * (1.0f / fFrames);
+        if (slot.bHasVelocity) {
+            slot.globalVelocity += (globalMeasured - slot.globalVelocity) * VELOCITY_GAIN;
+            slot.localVelocity += (localMeasured - slot.localVelocity) * VELOCITY_GAIN;
+        } else {
+            slot.globalVelocity = globalMeasured;
+            slot.localVelocity = localMeasured;
+            slot.bHasVelocity = true;
+        }
+    }
+    slot.globalParams = model.params_global;
+    model.params_local.copyTo(slot.localParams);
+    slot.bHasState = true;
+    slot.nFrames = 1;
+}
+
+ofxOpenFaceFitPredictor::Stats ofxOpenFaceFitPredictor::getStats() const {
+    Stats stats;
+    stats.nFits = nFits;
+    stats.nFitsCheap = nFitsCheap;
+    stats.nIterations = nIterations;
+    stats.nPredictions = nPredictions;
+    stats.fResidualPxSum = nResidualMilliPx / 1000.0;
+    return stats;
+}
+
+void ofxOpenFaceFitPredictor::resetStats() {
+    nFits = 0;
+    nFitsCheap = 0;
+    nIterations = 0;
+    nPredictions = 0;
+    nResidualMilliPx = 0;
+}
@@ -0,0 +1,64 @@
+#include "ofMain.h"
+#include "LandmarkCoreIncludes.h"
+#include <atomic>
+
+#pragma once
+
+// Seeds the landmark fit of each tracked face with a constant velocity prediction of its PDM parameters (the rigid pose and the
+// non-rigid shape), instead of last frame's result. When the prediction of the previous frame landed within fResidualPx of the
+// fitted landmarks, the fit only searches at the finest scale with fewer iterations: slow faces get cheaper, fast ones start closer.
+// Counts the optimisation iterations either way, so runs with and without prediction can be compared.
+// Each slot is only used by one thread at a time, the stats can be read from any thread.
+class ofxOpenFaceFitPredictor {
+public:
+    struct Stats {
+        uint64_t    nFits = 0; // landmark fits of the main model
+        uint64_t    nFitsCheap = 0; // of them, narrowed down thanks to the prediction
+        uint64_t    nIterations = 0; // optimisation iterations the fits were given: iterations per scale times scales
+        uint64_t    nPredictions = 0;
+        double      fResidualPxSum = 0.0; // mean distance between the predicted and the fitted landmarks, summed over the predictions
+        float getIterationsPerFit() const { return nFits > 0 ? (float)nIterations / nFits : 0.0f; }
+        float getCheapPercent() const { return nFits > 0 ? 100.0f * nFitsCheap / nFits : 0.0f; }
+        float getResidualPxMean() const { return nPredictions > 0 ? (float)(fResidualPxSum / nPredictions) : 0.0f; }
+        string toString() const;
+    };
+
+    void setup(int nSlots);
+    void setEnabled(bool bValue, float fResidualPx);
+    bool isEnabled() const;
+    // A new face, or a face lost: the next fit starts without a velocity
+    void reset(int nSlot);
+    // Before tracking the face of nSlot, nFrames after its last fit: moves model to the prediction when enabled.
+    // Returns the parameters to fit with, params itself or a narrowed copy of it.
+    LandmarkDetector::FaceModelParameters& predict(int nSlot, int nFrames, LandmarkDetector::CLNF& model, LandmarkDetector::FaceModelParameters& params);
+    // After every fit, new faces included, with the parameters it used. bFitted false: the face was moved without a fit (optical flow),
+    // its motion still counts for the velocity but not as a fit, and the last fit's residual stays.
+    void correct(int nSlot, const LandmarkDetector::CLNF& model, const LandmarkDetector::FaceModelParameters& params, bool bSuccess, bool bFitted = true);
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    static constexpr float VELOCITY_GAIN = 0.5f; // share of the new velocity measurement taken over the old velocity
+
+    struct Slot {
+        bool                                    bHasState = false;
+        bool                                    bHasVelocity = false;
+        cv::Vec6f                               globalParams; // the last fitted ones
+        cv::Vec6f                               globalVelocity; // per frame
+        cv::Mat_<float>                         localParams;
+        cv::Mat_<float>                         localVelocity;
+        cv::Mat_<float>                         shapePredicted; // 2D landmarks of the last prediction, empty without one
+        float                                   fResidualPx = -1.0f; // of the last prediction, -1 without one
+        int                                     nFrames = 1; // since the last fit, at the last prediction
+        LandmarkDetector::FaceModelParameters   paramsCheap;
+    };
+
+    vector<Slot>                vSlots;
+    std::atomic<bool>           bEnabled{false};
+    float                       fResidualPxMax = 1.5f;
+    std::atomic<uint64_t>       nFits{0};
+    std::atomic<uint64_t>       nFitsCheap{0};
+    std::atomic<uint64_t>       nIterations{0};
+    std::atomic<uint64_t>       nPredictions{0};
+    std::atomic<uint64_t>       nResidualMilliPx{0}; // summed, in thousandths of a pixel
+};
@@ -0,0 +1,133 @@
+#include "ofxOpenFaceFlowTracker.h"
+
+constexpr int ofxOpenFaceFlowTracker::PATCH_WIDTH;
+constexpr float ofxOpenFaceFlowTracker::MAX_FORWARD_BACKWARD_PX;
+constexpr float ofxOpenFaceFlowTracker::MIN_INLIERS;
+
+void ofxOpenFaceFlowTracker::setup(int nSlots) {
+    vSlots.clear();
+    vSlots.resize(nSlots);
+}
+
+void ofxOpenFaceFlowTracker::setEnabled(bool bValue, int nRefitFramesValue, float fMinCertaintyValue) {
+    nRefitFrames = MAX(nRefitFramesValue, 1);
+    fMinCertainty = fMinCertaintyValue;
+    bEnabled = bValue;
+}
+
+bool ofxOpenFaceFlowTracker::isEnabled() const {
+    return bEnabled;
+}
+
+void ofxOpenFaceFlowTracker::reset(int nSlot) {
+    if (nSlot < 0 || nSlot >= (int)vSlots.size()) {
+        return;
+    }
+    vSlots[nSlot].patch.release();
+    vSlots[nSlot].nFramesSinceFit = 0;
+}
+
+bool ofxOpenFaceFlowTracker::track(int nSlot, const cv::Mat_<uchar>& gray, LandmarkDetector::CLNF& model) {
+    if (!bEnabled || nSlot < 0 || nSlot >= (int)vSlots.size()) {
+        return false;
+    }
+    Slot& slot = vSlots[nSlot];
+    int nLandmarks = model.detected_landmarks.rows / 2;
+    if (slot.patch.empty() || slot.nFramesSinceFit + 1 >= nRefitFrames || model.detection_certainty < fMinCertainty || nLandmarks < 8 ||
+        (slot.rRoi & cv::Rect(0, 0, gray.cols, gray.rows)) != slot.rRoi) {
+        return false;
+    }
+
+    // The same region of this frame, at the same scale
+    cv::Mat_<uchar> patch;
+    cv::resize(gray(slot.rRoi), patch, slot.patch.size(), 0, 0, cv::INTER_AREA);
+    vector<cv::Point2f> vPrevious(nLandmarks);
+    for (int i = 0; i < nLandmarks; i++) {
+        vPrevious[i] = cv::Point2f((model.detected_landmarks(i) - slot.rRoi.x) * slot.fScale, (model.detected_landmarks(i + nLandmarks) - slot.rRoi.y) * slot.fScale);
+    }
+
+    // Forward and back, only the points that return where they came from count
+    vector<cv::Point2f> vNext, vBack;
+    vector<uchar> vStatus, vStatusBack;
+    vector<float> vError;
+    cv::calcOpticalFlowPyrLK(slot.patch, patch, vPrevious, vNext, vStatus, vError, cv::Size(15, 15), 2);
+    cv::calcOpticalFlowPyrLK(patch, slot.patch, vNext, vBack, vStatusBack, vError, cv::Size(15, 15), 2);
+    vector<cv::Point2f> vFrom, vTo;
+    for (int i = 0; i < nLandmarks; i++) {
+        if (vStatus[i] && vStatusBack[i] && cv::norm(vBack[i] - vPrevious[i]) <= MAX_FORWARD_BACKWARD_PX) {
+            vFrom.push_back(vPrevious[i]);
+            vTo.push_back(vNext[i]);
+        }
+    }
+    if (vFrom.size() < MIN_INLIERS * nLandmarks) {
+        return false;
+    }
+    vector<uchar> vInliers;
+    cv::Mat M = cv::estimateAffinePartial2D(vFrom, vTo, vInliers, cv::RANSAC, 1.0);
+    if (M.empty() || cv::countNonZero(vInliers) < MIN_INLIERS * nLandmarks) {
+        return false;
+    }
+
+    // From the patch back to the image: x' = A x + t, with the patch's origin and scale folded into t
+    cv::Matx22f A((float)M.at<double>(0, 0), (float)M.at<double>(0, 1), (float)M.at<double>(1, 0), (float)M.at<double>(1, 1));
+    cv::Vec2f o((float)slot.rRoi.x, (float)slot.rRoi.y);
+    cv::Vec2f t = cv::Vec2f((float)M.at<double>(0, 2), (float)M.at<double>(1, 2)) * (1.0f / slot.fScale) + o - A * o;
+    transform(model, A, t);
+    slot.nFramesSinceFit++;
+    return true;
+}
+
+void ofxOpenFaceFlowTracker::update(int nSlot, const cv::Mat_<uchar>& gray, const LandmarkDetector::CLNF& model, bool bFitted) {
+    if (!bEnabled || nSlot < 0 || nSlot >= (int)vSlots.size()) {
+        return;
+    }
+    Slot& slot = vSlots[nSlot];
+    if (bFitted) {
+        slot.nFramesSinceFit = 0;
+    }
+    int nLandmarks = model.detected_landmarks.rows / 2;
+    if (nLandmarks == 0 || gray.empty()) {
+        slot.patch.release();
+        return;
+    }
+
+    // Around the landmarks with a margin for the motion, clipped to the image
+    double fMinX, fMaxX, fMinY, fMaxY;
+    cv::minMaxLoc(model.detected_landmarks.rowRange(0, nLandmarks), &fMinX, &fMaxX);
+    cv::minMaxLoc(model.detected_landmarks.rowRange(nLandmarks, 2 * nLandmarks), &fMinY, &fMaxY);
+    float fMargin = 0.25f * (float)MAX(fMaxX - fMinX, fMaxY - fMinY);
+    cv::Rect rRoi = cv::Rect(cv::Point((int)(fMinX - fMargin), (int)(fMinY - fMargin)), cv::Point((int)(fMaxX + fMargin), (int)(fMaxY + fMargin))) & cv::Rect(0, 0, gray.cols, gray.rows);
+    if (rRoi.width < 16 || rRoi.height < 16) {
+        slot.patch.release();
+        return;
+    }
+    slot.rRoi = rRoi;
+    slot.fScale = MIN(1.0f, (float)PATCH_WIDTH / rRoi.width);
+    cv::resize(gray(rRoi), slot.patch, cv::Size(), slot.fScale, slot.fScale, cv::INTER_AREA);
+}
+
+void ofxOpenFaceFlowTracker::shift(int nSlot, LandmarkDetector::CLNF& model, const cv::Vec2f& t) {
+    if (model.detected_landmarks.rows > 0) {
+        transform(model, cv::Matx22f::eye(), t);
+    }
+    reset(nSlot);
+}
+
+void ofxOpenFaceFlowTracker::transform(LandmarkDetector::CLNF& model, const cv::Matx22f& A, const cv::Vec2f& t) {
+    // The PDM projects with scale * the first rows of the rotation, plus the translation: the similarity composes with them exactly,
+    // its rotation turning the head about the camera axis
+    float fScale = sqrt(MAX(A(0, 0) * A(1, 1) - A(0, 1) * A(1, 0), 0.0f));
+    float fAngle = atan2(A(1, 0), A(0, 0));
+    cv::Matx33f Rz(cos(fAngle), -sin(fAngle), 0.0f, sin(fAngle), cos(fAngle), 0.0f, 0.0f, 0.0f, 1.0f);
+    cv::Vec3f euler = Utilities::RotationMatrix2Euler(Rz * Utilities::Euler2RotationMatrix(cv::Vec3f(model.params_global[1], model.params_global[2], model.params_global[3])));
+    cv::Vec2f translation = A * cv::Vec2f(model.params_global[4], model.params_global[5]) + t;
+    model.params_global = cv::Vec6f(model.params_global[0] * fScale, euler[0], euler[1], euler[2], translation[0], translation[1]);
+    model.pdm.CalcShape2D(model.detected_landmarks, model.params_local, model.params_global);
+
+    // The eyes and other parts follow, they feed the gaze
+    for (auto& part : model.hierarchical_models) {
+        if (!part.params_local.empty()) {
+            transform(part, A, t);
+        }
+    }
+}
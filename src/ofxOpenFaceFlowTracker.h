@@ -0,0 +1,50 @@
+#include "ofMain.h"
+#include "LandmarkCoreIncludes.h"
+#include <RotationHelpers.h>
+#include <atomic>
+#include <opencv2/video/tracking.hpp>
+#include <opencv2/calib3d.hpp>
+
+#pragma once
+
+// A fast path for the tracked faces that barely move, like seated users: the landmarks of the last frame are followed with sparse
+// pyramidal optical flow on a downscaled patch of the face, and the similarity transform they agree on moves the face model
+// (its rigid pose, and the eyes and other parts of the hierarchy) instead of a patch expert fit.
+// Only while the flow is confident and the last fit's certainty is high, with a full fit at least every nRefitFrames frames.
+// Each slot is only used by one thread at a time.
+class ofxOpenFaceFlowTracker {
+public:
+    void setup(int nSlots);
+    // nRefitFrames: frames after which a full fit is forced. fMinCertainty: of the last fit, 0-1.
+    void setEnabled(bool bValue, int nRefitFrames, float fMinCertainty);
+    bool isEnabled() const;
+    // A new face, or a face lost
+    void reset(int nSlot);
+    // Tries to move model from the last frame to gray, returns false when the face needs a full fit
+    bool track(int nSlot, const cv::Mat_<uchar>& gray, LandmarkDetector::CLNF& model);
+    // After every frame the face of nSlot was fitted or tracked on, keeps its patch of gray for the next frame
+    void update(int nSlot, const cv::Mat_<uchar>& gray, const LandmarkDetector::CLNF& model, bool bFitted);
+    // Moves the face of nSlot by t (image pixels) without looking at the image, when it is extrapolated instead of fitted.
+    // Its patch no longer matches the landmarks, the next frame is fitted.
+    void shift(int nSlot, LandmarkDetector::CLNF& model, const cv::Vec2f& t);
+
+private:
+    static constexpr int PATCH_WIDTH = 96; // of the downscaled face, in pixels
+    static constexpr float MAX_FORWARD_BACKWARD_PX = 0.5f; // a point flowing back elsewhere than it came from is dropped, in patch pixels
+    static constexpr float MIN_INLIERS = 0.7f; // of the landmarks, to agree on the transform
+
+    struct Slot {
+        cv::Mat_<uchar>     patch; // of the last frame, empty without one
+        cv::Rect            rRoi; // of the patch, in the image
+        float               fScale = 1.0f; // patch pixels per image pixel
+        int                 nFramesSinceFit = 0;
+    };
+
+    // Applies the 2D similarity A, t (image pixels) to a face model's pose and landmarks
+    static void transform(LandmarkDetector::CLNF& model, const cv::Matx22f& A, const cv::Vec2f& t);
+
+    vector<Slot>                vSlots;
+    std::atomic<bool>           bEnabled{false};
+    int                         nRefitFrames = 5;
+    float                       fMinCertainty = 0.7f;
+};
@@ -0,0 +1,47 @@
+#include "ofxOpenFaceFrameMailbox.h"
+
+void ofxOpenFaceFrameMailbox::allocate(int nWidth, int nHeight, int nType) {
+    for (auto& f : frames) {
+        f.mat.create(nHeight, nWidth, nType);
+    }
+}
+
+void ofxOpenFaceFrameMailbox::publish(const cv::Mat& img, uint64_t nFrameNumber, const vector<cv::Rect>& vRegions) {
+    // Fill the back slot, this only allocates if the size or type changed
+    Frame& f = frames[nBack];
+    img.copyTo(f.mat);
+    f.nTimeSetUs = ofGetElapsedTimeMicros();
+    f.nFrameNumber = nFrameNumber > 0 ? nFrameNumber : nFramesPublished + 1;
+    f.vRegions = vRegions;
+
+    // Swap it with the middle slot, the previous middle slot becomes our new back slot
+    int nPrevious = nMiddle.exchange(nBack | NEW_FRAME_BIT, std::memory_order_acq_rel);
+    nBack = nPrevious & SLOT_MASK;
+    nFramesPublished++;
+    if (nPrevious & NEW_FRAME_BIT) {
+        // The consumer never saw that one
+        nFramesSuperseded++;
+    }
+}
+
+bool ofxOpenFaceFrameMailbox::hasNewFrame() const {
+    return (nMiddle.load(std::memory_order_acquire) & NEW_FRAME_BIT) != 0;
+}
+
+const ofxOpenFaceFrameMailbox::Frame* ofxOpenFaceFrameMailbox::consume() {
+    if (!hasNewFrame()) {
+        return nullptr;
+    }
+    // Swap the front slot with the newest published one
+    int nPrevious = nMiddle.exchange(nFront, std::memory_order_acq_rel);
+    nFront = nPrevious & SLOT_MASK;
+    return &frames[nFront];
+}
+
+uint64_t ofxOpenFaceFrameMailbox::getFramesPublished() const {
+    return nFramesPublished;
+}
+
+uint64_t ofxOpenFaceFrameMailbox::getFramesSuperseded() const {
+    return nFramesSuperseded;
+}
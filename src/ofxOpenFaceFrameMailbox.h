@@ -0,0 +1,36 @@
+#include "ofMain.h"
+#include "ofxCv.h"
+#include <atomic>
+
+#pragma once
+
+// A triple-buffered, lock-free mailbox handing frames from one producer thread to one consumer thread.
+// The producer copies into a preallocated free slot and publishes it atomically, the consumer always takes the newest frame.
+class ofxOpenFaceFrameMailbox {
+public:
+    struct Frame {
+        cv::Mat     mat;
+        uint64_t    nTimeSetUs = 0; // when the frame was published, in ofGetElapsedTimeMicros() time
+        uint64_t    nFrameNumber = 0; // the producer's, or 1 for the first published frame
+        vector<cv::Rect> vRegions; // of the image, published and consumed with it
+    };
+
+    void allocate(int nWidth, int nHeight, int nType); // preallocate all slots, optional
+    // Producer only: copies img, the caller keeps ownership of its buffer. nFrameNumber 0 numbers the frames in publishing order.
+    void publish(const cv::Mat& img, uint64_t nFrameNumber = 0, const vector<cv::Rect>& vRegions = vector<cv::Rect>());
+    bool hasNewFrame() const;
+    const Frame* consume(); // consumer only: nullptr if nothing new. The frame stays valid until the next consume()
+    uint64_t getFramesPublished() const;
+    uint64_t getFramesSuperseded() const; // frames overwritten by a newer one before the consumer took them
+
+private:
+    static const int        SLOT_MASK = 3;
+    static const int        NEW_FRAME_BIT = 4;
+
+    Frame                   frames[3];
+    int                     nBack = 0; // the slot the producer writes into
+    int                     nFront = 1; // the slot the consumer reads from
+    std::atomic<int>        nMiddle{2}; // the published slot, with NEW_FRAME_BIT set until consumed
+    std::atomic<uint64_t>   nFramesPublished{0};
+    std::atomic<uint64_t>   nFramesSuperseded{0};
+};
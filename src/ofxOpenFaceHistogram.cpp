@@ -0,0 +1,93 @@
+#include "ofxOpenFaceHistogram.h"
+
+ofxOpenFaceHistogram::ofxOpenFaceHistogram() {
+    reset();
+}
+
+int ofxOpenFaceHistogram::getBucket(uint64_t nMicros) {
+    if (nMicros < LINEAR_BUCKETS) {
+        return (int)nMicros;
+    }
+    // The highest bit gives the power of two, the next SUB_BUCKET_BITS bits the position within it
+    int nMagnitude = 63;
+    while (!(nMicros >> nMagnitude)) {
+        nMagnitude--;
+    }
+    if (nMagnitude >= MAX_MAGNITUDE) {
+        return BUCKETS - 1;
+    }
+    int nSub = (nMicros >> (nMagnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return LINEAR_BUCKETS + (nMagnitude - 5) * SUB_BUCKETS + nSub;
+}
+
+uint64_t ofxOpenFaceHistogram::getBucketMiddle(int nBucket) {
+    if (nBucket < LINEAR_BUCKETS) {
+        return nBucket;
+    }
+    int nMagnitude = (nBucket - LINEAR_BUCKETS) / SUB_BUCKETS + 5;
+    int nSub = (nBucket - LINEAR_BUCKETS) % SUB_BUCKETS;
+    int nShift = nMagnitude - SUB_BUCKET_BITS;
+    return ((uint64_t)(SUB_BUCKETS + nSub) << nShift) + ((uint64_t)1 << nShift) / 2;
+}
+
+void ofxOpenFaceHistogram::record(uint64_t nMicros) {
+    nBuckets[getBucket(nMicros)].fetch_add(1, std::memory_order_relaxed);
+    nCount.fetch_add(1, std::memory_order_relaxed);
+    nSumUs.fetch_add(nMicros, std::memory_order_relaxed);
+    uint64_t nMax = nMaxUs.load(std::memory_order_relaxed);
+    while (nMicros > nMax && !nMaxUs.compare_exchange_weak(nMax, nMicros, std::memory_order_relaxed)) {
+    }
+}
+
+ofxOpenFaceHistogram::Summary ofxOpenFaceHistogram::getSummary() const {
+    Summary summary;
+    // Count from the buckets, so that the percentiles add up even while others record
+    uint64_t nTotal = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        nTotal += nBuckets[i].load(std::memory_order_relaxed);
+    }
+    summary.nCount = nTotal;
+    if (nTotal == 0) {
+        return summary;
+    }
+    uint64_t nRecorded = MAX(nCount.load(std::memory_order_relaxed), (uint64_t)1);
+    summary.fMeanMs = nSumUs.load(std::memory_order_relaxed) / (1000.0f * nRecorded);
+    summary.fP50Ms = getPercentileMs(50.0f, nTotal);
+    summary.fP95Ms = getPercentileMs(95.0f, nTotal);
+    summary.fP99Ms = getPercentileMs(99.0f, nTotal);
+    summary.fMaxMs = nMaxUs.load(std::memory_order_relaxed) / 1000.0f;
+    return summary;
+}
+
+float ofxOpenFaceHistogram::getPercentileMs(float fPercentile) const {
+    uint64_t nTotal = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        nTotal += nBuckets[i].load(std::memory_order_relaxed);
+    }
+    return getPercentileMs(fPercentile, nTotal);
+}
+
+float ofxOpenFaceHistogram::getPercentileMs(float fPercentile, uint64_t nTotal) const {
+    if (nTotal == 0) {
+        return 0.0f;
+    }
+    uint64_t nRank = MAX((uint64_t)ceil(ofClamp(fPercentile, 0.0f, 100.0f) / 100.0f * nTotal), (uint64_t)1);
+    uint64_t nSeen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        nSeen += nBuckets[i].load(std::memory_order_relaxed);
+        if (nSeen >= nRank) {
+            // Never report more than the largest value recorded
+            return MIN(getBucketMiddle(i), nMaxUs.load(std::memory_order_relaxed)) / 1000.0f;
+        }
+    }
+    return nMaxUs.load(std::memory_order_relaxed) / 1000.0f;
+}
+
+void ofxOpenFaceHistogram::reset() {
+    for (int i = 0; i < BUCKETS; i++) {
+        nBuckets[i].store(0, std::memory_order_relaxed);
+    }
+    nCount = 0;
+    nSumUs = 0;
+    nMaxUs = 0;
+}
@@ -0,0 +1,41 @@
+#include "ofMain.h"
+#include <atomic>
+
+#pragma once
+
+// A lock-free histogram of durations in microseconds, with HDR-style log-linear buckets:
+// exact below 32 us, then 16 buckets per power of two (about 6% resolution) up to about 38 hours.
+// Any number of threads can record at the same time, reading while they do gives a close but not exact picture.
+class ofxOpenFaceHistogram {
+public:
+    struct Summary {
+        uint64_t    nCount = 0;
+        float       fMeanMs = 0.0f;
+        float       fP50Ms = 0.0f;
+        float       fP95Ms = 0.0f;
+        float       fP99Ms = 0.0f;
+        float       fMaxMs = 0.0f;
+    };
+
+    ofxOpenFaceHistogram();
+    void record(uint64_t nMicros);
+    Summary getSummary() const;
+    float getPercentileMs(float fPercentile) const; // fPercentile in 0-100
+    void reset();
+
+private:
+    static const int    LINEAR_BUCKETS = 32;
+    static const int    SUB_BUCKET_BITS = 4;
+    static const int    SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int    MAX_MAGNITUDE = 37; // 2^37 us
+    static const int    BUCKETS = LINEAR_BUCKETS + (MAX_MAGNITUDE - 5) * SUB_BUCKETS;
+
+    static int getBucket(uint64_t nMicros);
+    static uint64_t getBucketMiddle(int nBucket);
+    float getPercentileMs(float fPercentile, uint64_t nCount) const;
+
+    std::atomic<uint64_t>   nBuckets[BUCKETS];
+    std::atomic<uint64_t>   nCount{0};
+    std::atomic<uint64_t>   nSumUs{0};
+    std::atomic<uint64_t>   nMaxUs{0};
+};
@@ -0,0 +1,89 @@
+#include "ofxOpenFaceMemory.h"
+
+#if defined(TARGET_OSX)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#elif defined(TARGET_LINUX)
+#include <unistd.h>
+#include <sys/resource.h>
+#elif defined(TARGET_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+uint64_t ofxOpenFaceMemory::getResidentBytes() {
+#if defined(TARGET_OSX)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS) {
+        return info.resident_size;
+    }
+#elif defined(TARGET_LINUX)
+    // The second field of statm is the resident size in pages
+    ifstream statm("/proc/self/statm");
+    uint64_t nSizePages = 0, nResidentPages = 0;
+    if (statm >> nSizePages >> nResidentPages) {
+        return nResidentPages * (uint64_t)sysconf(_SC_PAGESIZE);
+    }
+#elif defined(TARGET_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return pmc.WorkingSetSize;
+    }
+#endif
+    return 0;
+}
+
+uint64_t ofxOpenFaceMemory::getPeakResidentBytes() {
+#if defined(TARGET_OSX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return (uint64_t)usage.ru_maxrss; // bytes on macOS
+    }
+#elif defined(TARGET_LINUX)
+    // VmHWM follows resetPeakResidentBytes(), ru_maxrss never goes down
+    ifstream status("/proc/self/status");
+    string sLine;
+    while (getline(status, sLine)) {
+        if (sLine.compare(0, 6, "VmHWM:") == 0) {
+            istringstream value(sLine.substr(6)); // "   123 kB"
+            uint64_t nKilobytes = 0;
+            if (value >> nKilobytes) {
+                return nKilobytes * 1024;
+            }
+        }
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return (uint64_t)usage.ru_maxrss * 1024; // kilobytes on Linux
+    }
+#elif defined(TARGET_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return pmc.PeakWorkingSetSize;
+    }
+#endif
+    return 0;
+}
+
+bool ofxOpenFaceMemory::resetPeakResidentBytes() {
+#if defined(TARGET_LINUX)
+    // Writing 5 resets VmHWM to the current resident size
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return clearRefs.good();
+#else
+    return false;
+#endif
+}
+
+string ofxOpenFaceMemory::toString(int64_t nBytes) {
+    double fAbs = std::abs((double)nBytes);
+    if (fAbs >= 1024.0 * 1024.0) {
+        return ofToString(nBytes / (1024.0 * 1024.0), 1) + " MB";
+    } else if (fAbs >= 1024.0) {
+        return ofToString(nBytes / 1024.0, 1) + " KB";
+    }
+    return ofToString(nBytes) + " B";
+}
@@ -0,0 +1,12 @@
+#include "ofMain.h"
+
+#pragma once
+
+// Process memory figures, used to report what models and face slots cost
+class ofxOpenFaceMemory {
+public:
+    static uint64_t getResidentBytes(); // current resident set size, 0 if unknown on this platform
+    static uint64_t getPeakResidentBytes(); // peak resident set size since the process started or the last reset, 0 if unknown
+    static bool resetPeakResidentBytes(); // starts the peak over from the current size, false where the platform cannot (only Linux can)
+    static string toString(int64_t nBytes); // e.g. "1.5 MB"
+};
@@ -0,0 +1,593 @@
+#include "ofxOpenFaceModelBundle.h"
+#include <sys/stat.h>
+
+#if !defined(TARGET_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// The file: a header, the layout (every size, scalar and matrix header of the model, in the order the fields are visited below)
+// and the weights, every matrix starting on a 64 byte boundary.
+namespace {
+
+const char      BUNDLE_MAGIC[8] = {'O', 'F', 'X', 'O', 'F', 'M', 'B', '\0'};
+const uint32_t  BUNDLE_BYTE_ORDER = 0x01020304;
+const uint64_t  BUNDLE_ALIGNMENT = 64;
+
+struct BundleHeader {
+    char        sMagic[8];
+    uint32_t    nVersion;
+    uint32_t    nByteOrder; // bundles are only read on machines of the byte order they were written on
+    uint64_t    nLayoutOffset;
+    uint64_t    nLayoutSize;
+    uint64_t    nWeightsOffset;
+    uint64_t    nWeightsSize;
+    uint64_t    nLayoutChecksum;
+    uint64_t    nWeightsChecksum;
+};
+
+struct BundleMatrix {
+    int32_t     nRows;
+    int32_t     nCols;
+    int32_t     nType;
+    int32_t     nPadding;
+    uint64_t    nOffset; // into the weights
+};
+
+uint64_t align(uint64_t n) {
+    return (n + BUNDLE_ALIGNMENT - 1) / BUNDLE_ALIGNMENT * BUNDLE_ALIGNMENT;
+}
+
+// FNV-1a over 64 bit words, fast enough to check the weights at disk speed
+uint64_t getChecksum(const char* pData, uint64_t nSize) {
+    uint64_t nHash = 14695981039346656037ull;
+    uint64_t i = 0;
+    for (; i + 8 <= nSize; i += 8) {
+        uint64_t nWord;
+        memcpy(&nWord, pData + i, 8);
+        nHash = (nHash ^ nWord) * 1099511628211ull;
+    }
+    for (; i < nSize; i++) {
+        nHash = (nHash ^ (uint8_t)pData[i]) * 1099511628211ull;
+    }
+    return nHash;
+}
+
+class BundleWriter {
+public:
+    void raw(void* pValue, size_t nSize) {
+        const char* p = (const char*)pValue;
+        vLayout.insert(vLayout.end(), p, p + nSize);
+    }
+
+    void matrix(cv::Mat& m) {
+        if (m.dims > 2) {
+            bOk = false;
+            return;
+        }
+        cv::Mat continuous = m.isContinuous() ? m : m.clone();
+        BundleMatrix header = {continuous.rows, continuous.cols, continuous.type(), 0, 0};
+        if (!continuous.empty()) {
+            vWeights.resize(align(vWeights.size()), 0);
+            header.nOffset = vWeights.size();
+            const char* p = (const char*)continuous.data;
+            vWeights.insert(vWeights.end(), p, p + continuous.total() * continuous.elemSize());
+        }
+        raw(&header, sizeof(header));
+    }
+
+    // The model being written already has its elements
+    template<class T> void resize(vector<T>& v, uint64_t nSize) {
+    }
+
+    uint64_t getRemaining() const {
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    bool isReading() const {
+        return false;
+    }
+
+    vector<char>    vLayout;
+    vector<char>    vWeights;
+    bool            bOk = true;
+};
+
+class BundleReader {
+public:
+    BundleReader(const char* pLayoutValue, uint64_t nLayoutSizeValue, const char* pWeightsValue, uint64_t nWeightsSizeValue) {
+        pLayout = pLayoutValue;
+        nLayoutSize = nLayoutSizeValue;
+        pWeights = pWeightsValue;
+        nWeightsSize = nWeightsSizeValue;
+    }
+
+    void raw(void* pValue, size_t nSize) {
+        if (!bOk || nPosition + nSize > nLayoutSize) {
+            bOk = false;
+            memset(pValue, 0, nSize);
+            return;
+        }
+        memcpy(pValue, pLayout + nPosition, nSize);
+        nPosition += nSize;
+    }
+
+    void matrix(cv::Mat& m) {
+        BundleMatrix header;
+        raw(&header, sizeof(header));
+        if (!bOk || header.nRows < 0 || header.nCols < 0) {
+            bOk = false;
+            m = cv::Mat();
+            return;
+        }
+        if (header.nRows == 0 || header.nCols == 0) {
+            m = cv::Mat(header.nRows, header.nCols, header.nType);
+            return;
+        }
+        uint64_t nBytes = (uint64_t)header.nRows * header.nCols * CV_ELEM_SIZE(header.nType);
+        if (header.nOffset + nBytes > nWeightsSize) {
+            bOk = false;
+            m = cv::Mat();
+            return;
+        }
+        // No copy, the mapping is private: a model writing into its weights gets its own copy of the page
+        m = cv::Mat(header.nRows, header.nCols, header.nType, (void*)(pWeights + header.nOffset));
+    }
+
+    template<class T> void resize(vector<T>& v, uint64_t nSize) {
+        v.clear();
+        v.resize(nSize);
+    }
+
+    // The default constructor of CLNF loads the default model from disk, new models are copies of an empty one
+    void resize(vector<LandmarkDetector::CLNF>& v, uint64_t nSize) {
+        v.clear();
+        v.reserve(nSize);
+        for (uint64_t i = 0; i < nSize; i++) {
+            v.push_back(getEmptyModel());
+        }
+    }
+
+    const LandmarkDetector::CLNF& getEmptyModel() {
+        if (!pEmptyModel) {
+            pEmptyModel.reset(new LandmarkDetector::CLNF(string()));
+        }
+        return *pEmptyModel;
+    }
+
+    // A corrupt size must not allocate more than the layout could describe
+    uint64_t getRemaining() const {
+        return nLayoutSize - nPosition;
+    }
+
+    bool isReading() const {
+        return true;
+    }
+
+    bool                                bOk = true;
+
+private:
+    const char*                         pLayout;
+    uint64_t                            nLayoutSize;
+    uint64_t                            nPosition = 0;
+    const char*                         pWeights;
+    uint64_t                            nWeightsSize;
+    unique_ptr<LandmarkDetector::CLNF>  pEmptyModel;
+};
+
+// Every field of a model, the same code writes and reads the bundle.
+// Declared up front, the overloads call each other.
+template<class A, class T> typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type field(A& a, T& value);
+template<class A> void field(A& a, cv::Mat& m);
+template<class A, class T> void field(A& a, cv::Mat_<T>& m);
+template<class A, class T, int n> void field(A& a, cv::Vec<T, n>& v);
+template<class A, class T> void field(A& a, cv::Point_<T>& p);
+template<class A> void field(A& a, string& s);
+template<class A, class T, class U> void field(A& a, pair<T, U>& p);
+template<class A, class T> void field(A& a, vector<T>& v);
+template<class A> void field(A& a, LandmarkDetector::PDM& pdm);
+template<class A> void field(A& a, LandmarkDetector::SVR_patch_expert& expert);
+template<class A> void field(A& a, LandmarkDetector::Multi_SVR_patch_expert& expert);
+template<class A> void field(A& a, LandmarkDetector::CCNF_neuron& neuron);
+template<class A> void field(A& a, LandmarkDetector::CCNF_patch_expert& expert);
+template<class A> void field(A& a, LandmarkDetector::CEN_patch_expert& expert);
+template<class A> void field(A& a, LandmarkDetector::Patch_experts& experts);
+template<class A> void field(A& a, LandmarkDetector::PAW& paw);
+template<class A> void field(A& a, LandmarkDetector::DetectionValidator& validator);
+template<class A> void field(A& a, LandmarkDetector::FaceModelParameters& params);
+template<class A> void field(A& a, LandmarkDetector::CLNF& model);
+
+template<class A, class T> typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type field(A& a, T& value) {
+    a.raw(&value, sizeof(T));
+}
+
+template<class A> void field(A& a, cv::Mat& m) {
+    a.matrix(m);
+}
+
+template<class A, class T> void field(A& a, cv::Mat_<T>& m) {
+    cv::Mat mat = m;
+    a.matrix(mat);
+    m = mat;
+}
+
+template<class A, class T, int n> void field(A& a, cv::Vec<T, n>& v) {
+    a.raw(v.val, sizeof(v.val));
+}
+
+template<class A, class T> void field(A& a, cv::Point_<T>& p) {
+    field(a, p.x);
+    field(a, p.y);
+}
+
+template<class A> void field(A& a, string& s) {
+    uint64_t nSize = s.size();
+    field(a, nSize);
+    if (a.isReading() && nSize > a.getRemaining()) {
+        a.bOk = false;
+        return;
+    }
+    if (a.isReading()) {
+        s.assign(nSize, '\0');
+    }
+    if (!s.empty()) {
+        a.raw(&s[0], s.size());
+    }
+}
+
+template<class A, class T, class U> void field(A& a, pair<T, U>& p) {
+    field(a, p.first);
+    field(a, p.second);
+}
+
+template<class A, class T> void field(A& a, vector<T>& v) {
+    uint64_t nSize = v.size();
+    field(a, nSize);
+    if (a.isReading() && nSize > a.getRemaining()) {
+        a.bOk = false;
+        return;
+    }
+    a.resize(v, nSize);
+    for (auto& element : v) {
+        field(a, element);
+    }
+}
+
+template<class A> void field(A& a, LandmarkDetector::PDM& pdm) {
+    field(a, pdm.mean_shape);
+    field(a, pdm.princ_comp);
+    field(a, pdm.eigen_values);
+}
+
+template<class A> void field(A& a, LandmarkDetector::SVR_patch_expert& expert) {
+    field(a, expert.type);
+    field(a, expert.scaling);
+    field(a, expert.bias);
+    field(a, expert.weights);
+    field(a, expert.confidence);
+    // weights_dfts is a cache filled while tracking
+}
+
+template<class A> void field(A& a, LandmarkDetector::Multi_SVR_patch_expert& expert) {
+    field(a, expert.width);
+    field(a, expert.height);
+    field(a, expert.svr_patch_experts);
+}
+
+template<class A> void field(A& a, LandmarkDetector::CCNF_neuron& neuron) {
+    field(a, neuron.neuron_type);
+    field(a, neuron.norm_weights);
+    field(a, neuron.bias);
+    field(a, neuron.weights);
+    field(a, neuron.alpha);
+}
+
+template<class A> void field(A& a, LandmarkDetector::CCNF_patch_expert& expert) {
+    field(a, expert.width);
+    field(a, expert.height);
+    field(a, expert.neurons);
+    field(a, expert.window_sizes);
+    field(a, expert.Sigmas); // computed from the sigma components while reading the text files
+    field(a, expert.betas);
+    field(a, expert.weight_matrix);
+    field(a, expert.patch_confidence);
+}
+
+template<class A> void field(A& a, LandmarkDetector::CEN_patch_expert& expert) {
+    field(a, expert.width_support);
+    field(a, expert.height_support);
+    field(a, expert.biases);
+    field(a, expert.weights);
+    field(a, expert.activation_function);
+    field(a, expert.confidence);
+}
+
+template<class A> void field(A& a, LandmarkDetector::Patch_experts& experts) {
+    field(a, experts.svr_expert_intensity);
+    field(a, experts.ccnf_expert_intensity);
+    field(a, experts.sigma_components);
+    field(a, experts.cen_expert_intensity);
+    field(a, experts.patch_scaling);
+    field(a, experts.centers);
+    field(a, experts.visibilities);
+    field(a, experts.mirror_inds);
+    field(a, experts.mirror_views);
+    field(a, experts.early_term_weights);
+    field(a, experts.early_term_biases);
+    field(a, experts.early_term_cutoffs);
+    // preallocated_im2col is scratch space
+}
+
+template<class A> void field(A& a, LandmarkDetector::PAW& paw) {
+    field(a, paw.number_of_pixels);
+    field(a, paw.min_x);
+    field(a, paw.min_y);
+    field(a, paw.destination_landmarks);
+    field(a, paw.source_landmarks);
+    field(a, paw.triangulation);
+    field(a, paw.triangle_id);
+    field(a, paw.pixel_mask);
+    field(a, paw.coefficients);
+    field(a, paw.alpha);
+    field(a, paw.beta);
+    field(a, paw.map_x);
+    field(a, paw.map_y);
+}
+
+template<class A> void field(A& a, LandmarkDetector::DetectionValidator& validator) {
+    field(a, validator.orientations);
+    field(a, validator.paws);
+    field(a, validator.cnn_convolutional_layers);
+    field(a, validator.cnn_convolutional_layers_weights);
+    field(a, validator.cnn_convolutional_layers_im2col_precomp);
+    field(a, validator.cnn_subsampling_layers);
+    field(a, validator.cnn_fully_connected_layers_weights);
+    field(a, validator.cnn_fully_connected_layers_biases);
+    field(a, validator.cnn_layer_types);
+    field(a, validator.mean_images);
+    field(a, validator.standard_deviations);
+}
+
+template<class A> void field(A& a, LandmarkDetector::FaceModelParameters& params) {
+    field(a, params.num_optimisation_iteration);
+    field(a, params.limit_pose);
+    field(a, params.validate_detections);
+    field(a, params.validation_boundary);
+    field(a, params.window_sizes_small);
+    field(a, params.window_sizes_init);
+    field(a, params.window_sizes_current);
+    field(a, params.face_template_scale);
+    field(a, params.use_face_template);
+    field(a, params.model_location);
+    field(a, params.sigma);
+    field(a, params.reg_factor);
+    field(a, params.weight_factor);
+    field(a, params.multi_view);
+    field(a, params.curr_landmark_detector);
+    field(a, params.reinit_video_every);
+    field(a, params.haar_face_detector_location);
+    field(a, params.mtcnn_face_detector_location);
+    field(a, params.curr_face_detector);
+    field(a, params.quiet_mode);
+    field(a, params.refine_hierarchical);
+    field(a, params.refine_parameters);
+}
+
+template<class A> void field(A& a, LandmarkDetector::CLNF& model) {
+    // The weights
+    field(a, model.pdm);
+    field(a, model.patch_experts);
+    field(a, model.landmark_validator);
+    field(a, model.triangulations);
+    field(a, model.hierarchical_models);
+    field(a, model.hierarchical_model_names);
+    field(a, model.hierarchical_mapping);
+    field(a, model.hierarchical_params);
+    field(a, model.eye_model);
+    field(a, model.loaded_successfully);
+
+    // The tracking state as reading the text files left it. It is written while tracking, it gets memory of its own.
+    field(a, model.params_local);
+    field(a, model.params_global);
+    field(a, model.detected_landmarks);
+    field(a, model.landmark_likelihoods);
+    field(a, model.detection_success);
+    field(a, model.tracking_initialised);
+    field(a, model.detection_certainty);
+    field(a, model.model_likelihood);
+    field(a, model.failures_in_a_row);
+    field(a, model.preference_det);
+    field(a, model.view_used);
+    if (a.isReading()) {
+        model.params_local = model.params_local.clone();
+        model.detected_landmarks = model.detected_landmarks.clone();
+        model.landmark_likelihoods = model.landmark_likelihoods.clone();
+    }
+}
+
+struct BundleMapping {
+    const char* pData = nullptr;
+    uint64_t    nSize = 0;
+};
+
+// Never unmapped, see load()
+std::mutex mutexMappings;
+map<string, BundleMapping> mappings;
+
+BundleMapping mapFile(const string& sPath, int64_t nModifiedTime) {
+    std::lock_guard<std::mutex> lock(mutexMappings);
+    string sKey = sPath + "@" + ofToString(nModifiedTime);
+    auto it = mappings.find(sKey);
+    if (it != mappings.end()) {
+        return it->second;
+    }
+
+    BundleMapping mapping;
+#if defined(TARGET_WIN32)
+    // No mapping here, the file is read in one go: still no parsing
+    ofBuffer buffer = ofBufferFromFile(sPath, true);
+    if (buffer.size() > 0) {
+        char* pData = new char[buffer.size()];
+        memcpy(pData, buffer.getData(), buffer.size());
+        mapping.pData = pData;
+        mapping.nSize = buffer.size();
+    }
+#else
+    int nFile = open(sPath.c_str(), O_RDONLY);
+    if (nFile < 0) {
+        return mapping;
+    }
+    struct stat info;
+    if (fstat(nFile, &info) == 0 && info.st_size > 0) {
+        // Private and writable: pages stay shared with the file and the other processes until someone writes to one
+        void* pData = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, nFile, 0);
+        if (pData != MAP_FAILED) {
+            mapping.pData = (const char*)pData;
+            mapping.nSize = info.st_size;
+        }
+    }
+    close(nFile);
+#endif
+    if (mapping.pData != nullptr) {
+        mappings[sKey] = mapping;
+    }
+    return mapping;
+}
+
+int64_t getModifiedTime(const string& sPath) {
+    struct stat info;
+    if (stat(sPath.c_str(), &info) != 0) {
+        return -1;
+    }
+    return (int64_t)info.st_mtime;
+}
+
+}
+
+const uint32_t ofxOpenFaceModelBundle::VERSION;
+
+bool ofxOpenFaceModelBundle::write(LandmarkDetector::CLNF& model, const string& sPath) {
+    BundleWriter writer;
+    field(writer, model);
+    if (!writer.bOk) {
+        ofLogError("ofxOpenFace", "The model has matrices the bundle cannot hold.");
+        return false;
+    }
+
+    BundleHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.sMagic, BUNDLE_MAGIC, sizeof(header.sMagic));
+    header.nVersion = VERSION;
+    header.nByteOrder = BUNDLE_BYTE_ORDER;
+    header.nLayoutOffset = align(sizeof(header));
+    header.nLayoutSize = writer.vLayout.size();
+    header.nWeightsOffset = align(header.nLayoutOffset + header.nLayoutSize);
+    header.nWeightsSize = writer.vWeights.size();
+    header.nLayoutChecksum = getChecksum(writer.vLayout.data(), writer.vLayout.size());
+    header.nWeightsChecksum = getChecksum(writer.vWeights.data(), writer.vWeights.size());
+
+    // Written next to the destination first, a process mapping the old bundle keeps its pages
+    string sPathTemporary = sPath + ".tmp";
+    ofstream file(sPathTemporary, ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        ofLogError("ofxOpenFace", "Could not write the model bundle '" + sPath + "'");
+        return false;
+    }
+    vector<char> vPadding(BUNDLE_ALIGNMENT, 0);
+    file.write((const char*)&header, sizeof(header));
+    file.write(vPadding.data(), header.nLayoutOffset - sizeof(header));
+    file.write(writer.vLayout.data(), writer.vLayout.size());
+    file.write(vPadding.data(), header.nWeightsOffset - header.nLayoutOffset - header.nLayoutSize);
+    file.write(writer.vWeights.data(), writer.vWeights.size());
+    file.close();
+    if (file.fail() || std::rename(sPathTemporary.c_str(), sPath.c_str()) != 0) {
+        ofLogError("ofxOpenFace", "Could not write the model bundle '" + sPath + "'");
+        std::remove(sPathTemporary.c_str());
+        return false;
+    }
+    ofLogNotice("ofxOpenFace", "Wrote the model bundle '" + sPath + "': " + ofToString(header.nLayoutSize / 1024) + " KB of layout, "
+                + ofToString(header.nWeightsSize / (1024 * 1024)) + " MB of weights");
+    return true;
+}
+
+LandmarkDetector::CLNF* ofxOpenFaceModelBundle::load(const string& sPath, bool bVerifyWeights) {
+    int64_t nModifiedTime = getModifiedTime(sPath);
+    if (nModifiedTime < 0) {
+        return nullptr;
+    }
+    BundleMapping mapping = mapFile(sPath, nModifiedTime);
+    if (mapping.pData == nullptr || mapping.nSize < sizeof(BundleHeader)) {
+        ofLogError("ofxOpenFace", "Could not map the model bundle '" + sPath + "'");
+        return nullptr;
+    }
+
+    BundleHeader header;
+    memcpy(&header, mapping.pData, sizeof(header));
+    if (memcmp(header.sMagic, BUNDLE_MAGIC, sizeof(header.sMagic)) != 0 || header.nByteOrder != BUNDLE_BYTE_ORDER) {
+        ofLogError("ofxOpenFace", "'" + sPath + "' is not a model bundle of this machine.");
+        return nullptr;
+    }
+    if (header.nVersion != VERSION) {
+        ofLogWarning("ofxOpenFace", "The model bundle '" + sPath + "' is of version " + ofToString(header.nVersion) + ", not " + ofToString(VERSION) + ". Compile it again.");
+        return nullptr;
+    }
+    if (header.nLayoutOffset > mapping.nSize || header.nLayoutSize > mapping.nSize - header.nLayoutOffset
+        || header.nWeightsOffset > mapping.nSize || header.nWeightsSize > mapping.nSize - header.nWeightsOffset) {
+        ofLogError("ofxOpenFace", "The model bundle '" + sPath + "' is truncated.");
+        return nullptr;
+    }
+    const char* pLayout = mapping.pData + header.nLayoutOffset;
+    const char* pWeights = mapping.pData + header.nWeightsOffset;
+    if (getChecksum(pLayout, header.nLayoutSize) != header.nLayoutChecksum
+        || (bVerifyWeights && getChecksum(pWeights, header.nWeightsSize) != header.nWeightsChecksum)) {
+        ofLogError("ofxOpenFace", "The model bundle '" + sPath + "' is corrupt.");
+        return nullptr;
+    }
+
+    BundleReader reader(pLayout, header.nLayoutSize, pWeights, header.nWeightsSize);
+    LandmarkDetector::CLNF* pModel = new LandmarkDetector::CLNF(reader.getEmptyModel());
+    field(reader, *pModel);
+    if (!reader.bOk || reader.getRemaining() != 0) {
+        ofLogError("ofxOpenFace", "The model bundle '" + sPath + "' does not match its layout.");
+        delete pModel;
+        return nullptr;
+    }
+    // Built from data compiled into dlib, not read from the model files
+    pModel->face_detector_HOG = dlib::get_frontal_face_detector();
+    return pModel;
+}
+
+LandmarkDetector::CLNF* ofxOpenFaceModelBundle::loadModel(const string& sModelPath) {
+    string sBundlePath = getBundlePath(sModelPath);
+    if (isUpToDate(sBundlePath, sModelPath)) {
+        uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+        LandmarkDetector::CLNF* pModel = load(sBundlePath);
+        if (pModel != nullptr) {
+            ofLogNotice("ofxOpenFace", "Mapped the model bundle '" + sBundlePath + "' in " + ofToString((ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f, 1) + " ms");
+            return pModel;
+        }
+    } else if (ofFile::doesFileExist(sBundlePath, false)) {
+        ofLogWarning("ofxOpenFace", "The model bundle '" + sBundlePath + "' is older than its model, reading the model instead. Compile it again.");
+    }
+    return new LandmarkDetector::CLNF(sModelPath);
+}
+
+bool ofxOpenFaceModelBundle::isMapped(const void* pData) {
+    std::lock_guard<std::mutex> lock(mutexMappings);
+    for (auto& mapping : mappings) {
+        if ((const char*)pData >= mapping.second.pData && (const char*)pData < mapping.second.pData + mapping.second.nSize) {
+            return true;
+        }
+    }
+    return false;
+}
+
+string ofxOpenFaceModelBundle::getBundlePath(const string& sModelPath) {
+    return ofFilePath::removeExt(sModelPath) + ".bundle";
+}
+
+bool ofxOpenFaceModelBundle::isUpToDate(const string& sBundlePath, const string& sModelPath) {
+    int64_t nBundleTime = getModifiedTime(sBundlePath);
+    return nBundleTime >= 0 && nBundleTime >= getModifiedTime(sModelPath);
+}
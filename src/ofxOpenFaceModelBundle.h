@@ -0,0 +1,29 @@
+#include "ofMain.h"
+#include "LandmarkCoreIncludes.h"
+
+#pragma once
+
+// A landmark model compiled into a single file, so that loading it maps one file instead of parsing dozens of text files.
+// The weights are stored aligned and the cv::Mat headers of the loaded model point straight into the mapping:
+// nothing is copied, and the processes loading the same bundle share its pages.
+// The file is versioned, its layout and its weights have checksums of their own.
+// The face detectors are not part of it, the prebuilt OpenFace libraries keep the MTCNN networks private.
+class ofxOpenFaceModelBundle {
+public:
+    static const uint32_t VERSION = 1; // bundles of another version are ignored
+
+    // Compiles a model freshly loaded with LandmarkDetector::CLNF(path) into sPath
+    static bool write(LandmarkDetector::CLNF& model, const string& sPath);
+    // Maps sPath and builds a model on it, nullptr when the bundle is missing, of another version or corrupt.
+    // The layout is always checked, bVerifyWeights also checksums the weights, which reads all of them from disk.
+    // Mappings stay for the life of the process, as long as any model or face model may point into them.
+    static LandmarkDetector::CLNF* load(const string& sPath, bool bVerifyWeights = false);
+    // Loads the bundle of sModelPath when there is an up to date one, otherwise the model's text files
+    static LandmarkDetector::CLNF* loadModel(const string& sModelPath);
+    // True when pData points into a mapped bundle, whose pages can be handed back to the OS and read again
+    static bool isMapped(const void* pData);
+    // model/main_ceclm_general.txt -> model/main_ceclm_general.bundle
+    static string getBundlePath(const string& sModelPath);
+    // True when sBundlePath exists and is newer than the main file of the model it was compiled from
+    static bool isUpToDate(const string& sBundlePath, const string& sModelPath);
+};
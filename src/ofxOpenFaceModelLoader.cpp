@@ -0,0 +1,159 @@
+#include "ofxOpenFaceModelLoader.h"
+#include "ofxOpenFace.h"
+#include "tbb/flow_graph.h"
+
+string ofxOpenFaceModelLoader::ComponentToString(Component eComponent) {
+    switch (eComponent) {
+        case COMPONENT_LANDMARKS:
+            return "Landmark model";
+        case COMPONENT_HAAR:
+            return "HAAR detector";
+        case COMPONENT_MTCNN:
+            return "MTCNN detector";
+        case COMPONENT_FACE_ANALYSER:
+            return "Face analyser";
+        default:
+            return "Unknown";
+    }
+}
+
+string ofxOpenFaceModelLoader::Report::toString() const {
+    string sResult;
+    float fSumMs = 0.0f;
+    for (int i = 0; i < COMPONENT_COUNT; i++) {
+        if (fComponentMs[i] > 0.0f) {
+            sResult += ComponentToString((Component)i) + ": " + ofToString(fComponentMs[i], 1) + " ms, ";
+            fSumMs += fComponentMs[i];
+        }
+    }
+    return sResult + "total: " + ofToString(fTotalMs, 1) + " ms (" + ofToString(fSumMs, 1) + " ms one after the other)";
+}
+
+void ofxOpenFaceModelLoader::setProgressCallback(function<void(const Progress&)> callback) {
+    progressCallback = callback;
+}
+
+void ofxOpenFaceModelLoader::setComponents(bool bLandmarksValue, bool bDetectorsValue, bool bFaceAnalyserValue) {
+    if (bDetectorsValue && !bLandmarksValue) {
+        ofLogError("ofxOpenFace", "The face detectors are handed to the landmark model, they can't be loaded without it. Not loading them.");
+        bDetectorsValue = false;
+    }
+    bLandmarks = bLandmarksValue;
+    bDetectors = bDetectorsValue;
+    bFaceAnalyser = bFaceAnalyserValue;
+}
+
+void ofxOpenFaceModelLoader::load(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks) {
+    string sModelPath;
+    if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CLNF_DETECTOR) {
+        sModelPath = OFX_OPENFACE_MODEL_CLNF;
+    } else if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CLM_DETECTOR) {
+        sModelPath = OFX_OPENFACE_MODEL_SVRCLM;
+    } else if (eDetectorLandmarks == LandmarkDetector::FaceModelParameters::LandmarkDetector::CECLM_DETECTOR) {
+        sModelPath = OFX_OPENFACE_MODEL_CECLM;
+    } else {
+        ofLogError("ofxOpenFace", "Unknown landmark detector '" + ofToString((int)eDetectorLandmarks) + "'. Defaulting to CLNF");
+        sModelPath = OFX_OPENFACE_MODEL_CLNF;
+    }
+    // Resolved here, the loading threads must not depend on the data path
+    sModelPath = ofFile(sModelPath).getAbsolutePath();
+    string sHaarPath = ofFile(OFX_OPENFACE_DETECTOR_HAAR).getAbsolutePath();
+    string sMtcnnPath = ofFile(OFX_OPENFACE_DETECTOR_MTCNN).getAbsolutePath();
+    string sRootDir = ofFilePath::getAbsolutePath("");
+
+    nDone = 0;
+    nTotal = (bLandmarks ? 1 : 0) + (bDetectors ? 2 : 0) + (bFaceAnalyser ? 1 : 0);
+    report = Report();
+    if (nTotal == 0) {
+        return;
+    }
+    cv::CascadeClassifier haar;
+    LandmarkDetector::FaceDetectorMTCNN mtcnn;
+
+    // Every part hangs off the start node, the detectors join the landmark model at the end
+    uint64_t nTimeStartUs = ofGetElapsedTimeMicros();
+    typedef tbb::flow::continue_node<tbb::flow::continue_msg> Node;
+    tbb::flow::graph graph;
+    tbb::flow::broadcast_node<tbb::flow::continue_msg> nodeStart(graph);
+    Node nodeLandmarks(graph, [&](const tbb::flow::continue_msg&) {
+        uint64_t nTimeUs = ofGetElapsedTimeMicros();
+        pModel = ofxOpenFaceModelBundle::loadModel(sModelPath);
+        done(COMPONENT_LANDMARKS, nTimeUs);
+    });
+    Node nodeHaar(graph, [&](const tbb::flow::continue_msg&) {
+        uint64_t nTimeUs = ofGetElapsedTimeMicros();
+        if (!haar.load(sHaarPath)) {
+            ofLogError("ofxOpenFace", "Could not load the HAAR detector '" + sHaarPath + "'");
+        }
+        done(COMPONENT_HAAR, nTimeUs);
+    });
+    Node nodeMtcnn(graph, [&](const tbb::flow::continue_msg&) {
+        uint64_t nTimeUs = ofGetElapsedTimeMicros();
+        mtcnn.Read(sMtcnnPath);
+        done(COMPONENT_MTCNN, nTimeUs);
+    });
+    Node nodeFaceAnalyser(graph, [&](const tbb::flow::continue_msg&) {
+        uint64_t nTimeUs = ofGetElapsedTimeMicros();
+        pFaceAnalysisParams = new FaceAnalysis::FaceAnalyserParameters(sRootDir);
+        pFaceAnalysisParams->OptimizeForImages();
+        pFaceAnalyser = new FaceAnalysis::FaceAnalyser(*pFaceAnalysisParams);
+        done(COMPONENT_FACE_ANALYSER, nTimeUs);
+    });
+    Node nodeDetectors(graph, [&](const tbb::flow::continue_msg&) {
+        // The MTCNN copy constructor clones its networks, its implicit assignment only copies cv::Mat headers
+        pModel->face_detector_HAAR = haar;
+        pModel->haar_face_detector_location = sHaarPath;
+        pModel->face_detector_MTCNN = mtcnn;
+        pModel->mtcnn_face_detector_location = sMtcnnPath;
+    });
+
+    if (bLandmarks) {
+        tbb::flow::make_edge(nodeStart, nodeLandmarks);
+    }
+    if (bDetectors) {
+        tbb::flow::make_edge(nodeStart, nodeHaar);
+        tbb::flow::make_edge(nodeStart, nodeMtcnn);
+        tbb::flow::make_edge(nodeLandmarks, nodeDetectors);
+        tbb::flow::make_edge(nodeHaar, nodeDetectors);
+        tbb::flow::make_edge(nodeMtcnn, nodeDetectors);
+    }
+    if (bFaceAnalyser) {
+        tbb::flow::make_edge(nodeStart, nodeFaceAnalyser);
+    }
+    nodeStart.try_put(tbb::flow::continue_msg());
+    graph.wait_for_all();
+    report.fTotalMs = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f;
+    ofLogNotice("ofxOpenFace", "Loaded " + report.toString());
+
+    if (pModel != nullptr) {
+        if (!pModel->loaded_successfully) {
+            ofLogError("ofxOpenFace", "The face model was not loaded successfully.");
+        }
+        if (!pModel->eye_model) {
+            ofLogError("ofxOpenFace", "No eye model found.");
+        }
+    }
+    if (pFaceAnalyser != nullptr) {
+        ofLogNotice("ofxOpenFace", "Face analysis model location: '" + pFaceAnalysisParams->getModelLoc() + "'");
+        if (pFaceAnalyser->GetAUClassNames().size() == 0) {
+            ofLogWarning("ofxOpenFace", "No Action Unit models found.");
+        }
+    }
+}
+
+ofxOpenFaceModelLoader::Report ofxOpenFaceModelLoader::getReport() const {
+    return report;
+}
+
+void ofxOpenFaceModelLoader::done(Component eComponent, uint64_t nTimeStartUs) {
+    std::lock_guard<ofMutex> lock(mutexProgress);
+    Progress progress;
+    progress.eComponent = eComponent;
+    progress.nDone = ++nDone;
+    progress.nTotal = nTotal;
+    progress.fMs = (ofGetElapsedTimeMicros() - nTimeStartUs) / 1000.0f;
+    report.fComponentMs[eComponent] = progress.fMs;
+    if (progressCallback) {
+        progressCallback(progress);
+    }
+}
@@ -0,0 +1,60 @@
+#include "ofMain.h"
+#include "LandmarkCoreIncludes.h"
+#include <FaceAnalyser.h>
+
+#pragma once
+
+// Loads the landmark model, its face detectors and the face analyser as a task graph on TBB: the parts are independent,
+// so they are read at the same time and the setup takes as long as the slowest part instead of all of them.
+// The face detectors are handed to the landmark model once all three are loaded.
+// The parts of a landmark model read from its text files (patch experts, validator, hierarchical models) are loaded
+// by the prebuilt OpenFace libraries in one go, a model bundle (see ofxOpenFaceModelBundle) makes that part short instead.
+class ofxOpenFaceModelLoader {
+public:
+    enum Component {
+        COMPONENT_LANDMARKS = 0,
+        COMPONENT_HAAR,
+        COMPONENT_MTCNN,
+        COMPONENT_FACE_ANALYSER,
+        COMPONENT_COUNT
+    };
+
+    struct Progress {
+        Component   eComponent; // the part just loaded
+        int         nDone = 0;
+        int         nTotal = 0;
+        float       fMs = 0.0f; // what it took
+    };
+
+    struct Report {
+        float       fComponentMs[COMPONENT_COUNT] = {}; // 0 for the parts not loaded
+        float       fTotalMs = 0.0f; // wall time of the whole graph
+        string toString() const;
+    };
+
+    static string ComponentToString(Component eComponent);
+
+    // Called from the loading threads, one call at a time, after each part is loaded
+    void setProgressCallback(function<void(const Progress&)> callback);
+    // What to load, all but the face analyser by default. The detectors need the landmark model, they are not loaded without it.
+    void setComponents(bool bLandmarks, bool bDetectors, bool bFaceAnalyser);
+    // Blocks until everything is loaded. The caller owns what was loaded.
+    void load(LandmarkDetector::FaceModelParameters::LandmarkDetector eDetectorLandmarks);
+    Report getReport() const;
+
+    LandmarkDetector::CLNF*                     pModel = nullptr; // with its face detectors when they were loaded too
+    FaceAnalysis::FaceAnalyserParameters*       pFaceAnalysisParams = nullptr; // the face analyser keeps a reference to them
+    FaceAnalysis::FaceAnalyser*                 pFaceAnalyser = nullptr;
+
+private:
+    void done(Component eComponent, uint64_t nTimeStartUs);
+
+    function<void(const Progress&)>     progressCallback;
+    bool                                bLandmarks = true;
+    bool                                bDetectors = true;
+    bool                                bFaceAnalyser = false;
+    int                                 nDone = 0;
+    int                                 nTotal = 0;
+    ofMutex                             mutexProgress;
+    Report                              report;
+};
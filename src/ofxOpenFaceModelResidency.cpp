@@ -0,0 +1,220 @@
+#include "ofxOpenFaceModelResidency.h"
+#include "ofxOpenFaceModelBundle.h"
+#include "ofxOpenFaceMemory.h"
+
+#if !defined(TARGET_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Hands pages back without losing them: clean pages are read again from the bundle, written ones go to swap.
+// Only MADV_PAGEOUT reclaims them right away. MADV_COLD and macOS' MADV_DONTNEED only make them the first to go under memory
+// pressure: the bundle is a writable private mapping, and what drops pages on Darwin (msync(MS_INVALIDATE), MADV_FREE_REUSABLE)
+// could also drop the pages written since mapping it. The eviction is advisory there, mincore() tells what actually left.
+#if defined(TARGET_LINUX) && defined(MADV_PAGEOUT)
+#define OFX_OPENFACE_EVICT_ADVICE MADV_PAGEOUT
+#elif defined(TARGET_LINUX) && defined(MADV_COLD)
+#define OFX_OPENFACE_EVICT_ADVICE MADV_COLD
+#elif defined(TARGET_OSX)
+#define OFX_OPENFACE_EVICT_ADVICE MADV_DONTNEED
+#endif
+
+#if defined(TARGET_WIN32)
+uint64_t ofxOpenFaceModelResidency::nPageSize = 4096;
+#else
+uint64_t ofxOpenFaceModelResidency::nPageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+
+string ofxOpenFaceModelResidency::Stats::toString() const {
+    return "Patch experts: " + ofxOpenFaceMemory::toString(nResidentBytes) + " of " + ofxOpenFaceMemory::toString(nTotalBytes) + " in memory, "
+        + ofToString(nViewsUsed) + " of " + ofToString(nViews) + " scales and views used, " + ofToString(nEvictions) + " evicted ("
+        + ofxOpenFaceMemory::toString(nEvictedBytes) + " left memory)"
+        + (bMapped ? "" : " (read from text files, not evictable)");
+}
+
+ofxOpenFaceModelResidency::~ofxOpenFaceModelResidency() {
+    delete[] pLastUsedMs;
+}
+
+void ofxOpenFaceModelResidency::setup(const LandmarkDetector::CLNF& model) {
+    pExperts = &model.patch_experts;
+    vViews.clear();
+    vViewIndices.clear();
+
+    // The experts are laid out scale -> view -> landmark, the views are the same for every kind of expert at a scale
+    const LandmarkDetector::Patch_experts& experts = model.patch_experts;
+    size_t nScales = experts.centers.size();
+    vViewIndices.resize(nScales);
+    for (size_t s = 0; s < nScales; s++) {
+        for (int v = 0; v < experts.nViews(s); v++) {
+            View view;
+            view.nScale = s;
+            view.nView = v;
+            if (s < experts.svr_expert_intensity.size() && v < (int)experts.svr_expert_intensity[s].size()) {
+                for (auto& expert : experts.svr_expert_intensity[s][v]) {
+                    for (auto& svr : expert.svr_patch_experts) {
+                        addPages(svr.weights, view.vPages);
+                    }
+                }
+            }
+            if (s < experts.ccnf_expert_intensity.size() && v < (int)experts.ccnf_expert_intensity[s].size()) {
+                for (auto& expert : experts.ccnf_expert_intensity[s][v]) {
+                    for (auto& neuron : expert.neurons) {
+                        addPages(neuron.weights, view.vPages);
+                    }
+                    for (auto& sigma : expert.Sigmas) {
+                        addPages(sigma, view.vPages);
+                    }
+                    addPages(expert.weight_matrix, view.vPages);
+                }
+            }
+            if (s < experts.cen_expert_intensity.size() && v < (int)experts.cen_expert_intensity[s].size()) {
+                for (auto& expert : experts.cen_expert_intensity[s][v]) {
+                    for (auto& m : expert.weights) {
+                        addPages(m, view.vPages);
+                    }
+                    for (auto& m : expert.biases) {
+                        addPages(m, view.vPages);
+                    }
+                }
+            }
+
+            // Merge the runs of pages, the experts of a view mostly follow each other
+            std::sort(view.vPages.begin(), view.vPages.end());
+            vector<pair<uintptr_t, size_t>> vMerged;
+            for (auto& run : view.vPages) {
+                if (!vMerged.empty() && run.first <= vMerged.back().first + vMerged.back().second * nPageSize) {
+                    uintptr_t nEnd = MAX(vMerged.back().first + vMerged.back().second * nPageSize, run.first + run.second * nPageSize);
+                    vMerged.back().second = (nEnd - vMerged.back().first) / nPageSize;
+                } else {
+                    vMerged.push_back(run);
+                }
+            }
+            view.vPages.swap(vMerged);
+            for (auto& run : view.vPages) {
+                view.nPages += run.second;
+            }
+            vViewIndices[s].push_back(vViews.size());
+            vViews.push_back(view);
+        }
+    }
+    delete[] pLastUsedMs;
+    pLastUsedMs = new std::atomic<uint64_t>[MAX(vViews.size(), (size_t)1)];
+    for (size_t i = 0; i < vViews.size(); i++) {
+        pLastUsedMs[i] = 0;
+    }
+
+    bMapped = !vViews.empty() && !vViews[0].vPages.empty() && ofxOpenFaceModelBundle::isMapped((const void*)vViews[0].vPages[0].first);
+#if !defined(TARGET_WIN32)
+    if (bMapped) {
+        // Read a view's pages when a face needs them, not its neighbours' along with them
+        for (auto& view : vViews) {
+            for (auto& run : view.vPages) {
+                madvise((void*)run.first, run.second * nPageSize, MADV_RANDOM);
+            }
+        }
+    }
+#endif
+    Stats stats = getStats();
+    ofLogNotice("ofxOpenFace", stats.toString());
+}
+
+void ofxOpenFaceModelResidency::setIdleTime(uint64_t nIdleMsValue) {
+    nIdleMs = nIdleMsValue;
+}
+
+void ofxOpenFaceModelResidency::touch(const LandmarkDetector::CLNF& faceModel, const LandmarkDetector::FaceModelParameters& params) {
+    if (pExperts == nullptr) {
+        return;
+    }
+    // The fitting skips the scales with a window size of 0
+    uint64_t nNowMs = ofGetElapsedTimeMillis() + 1;
+    for (size_t s = 0; s < vViewIndices.size(); s++) {
+        if (s < params.window_sizes_current.size() && params.window_sizes_current[s] <= 0) {
+            continue;
+        }
+        int nView = pExperts->GetViewIdx(faceModel.params_global, s);
+        if (nView >= 0 && nView < (int)vViewIndices[s].size()) {
+            pLastUsedMs[vViewIndices[s][nView]].store(nNowMs, std::memory_order_relaxed);
+        }
+    }
+}
+
+void ofxOpenFaceModelResidency::evictIdle() {
+    if (nIdleMs == 0 || !bMapped) {
+        return;
+    }
+    uint64_t nNowMs = ofGetElapsedTimeMillis() + 1;
+    uint64_t nLastMs = nLastEvictionMs.load(std::memory_order_relaxed);
+    if (nNowMs - nLastMs < 1000 || !nLastEvictionMs.compare_exchange_strong(nLastMs, nNowMs)) {
+        return;
+    }
+#if defined(OFX_OPENFACE_EVICT_ADVICE)
+    for (size_t i = 0; i < vViews.size(); i++) {
+        uint64_t nUsedMs = pLastUsedMs[i].load(std::memory_order_relaxed);
+        // A face turning that way meanwhile keeps it, and only reads the pages again if they were already gone
+        if (nUsedMs == 0 || nNowMs - nUsedMs < nIdleMs || !pLastUsedMs[i].compare_exchange_strong(nUsedMs, 0)) {
+            continue;
+        }
+        uint64_t nResidentBefore = getResidentPages(vViews[i]);
+        for (auto& run : vViews[i].vPages) {
+            madvise((void*)run.first, run.second * nPageSize, OFX_OPENFACE_EVICT_ADVICE);
+        }
+        uint64_t nResidentAfter = getResidentPages(vViews[i]);
+        nEvictedBytes += (nResidentBefore - MIN(nResidentAfter, nResidentBefore)) * nPageSize;
+        nEvictions++;
+    }
+#endif
+}
+
+ofxOpenFaceModelResidency::Stats ofxOpenFaceModelResidency::getStats() const {
+    Stats stats;
+    stats.bMapped = bMapped;
+    stats.nViews = vViews.size();
+    stats.nEvictions = nEvictions;
+    stats.nEvictedBytes = nEvictedBytes;
+    uint64_t nNowMs = ofGetElapsedTimeMillis() + 1;
+    for (size_t i = 0; i < vViews.size(); i++) {
+        stats.nTotalBytes += vViews[i].nPages * nPageSize;
+        stats.nResidentBytes += getResidentPages(vViews[i]) * nPageSize;
+        uint64_t nUsedMs = pLastUsedMs[i].load(std::memory_order_relaxed);
+        if (nUsedMs != 0 && (nIdleMs == 0 || nNowMs - nUsedMs < nIdleMs)) {
+            stats.nViewsUsed++;
+        }
+    }
+    return stats;
+}
+
+void ofxOpenFaceModelResidency::addPages(const cv::Mat& m, vector<pair<uintptr_t, size_t>>& vPages) {
+    if (m.empty()) {
+        return;
+    }
+    uintptr_t nStart = (uintptr_t)m.datastart;
+    uintptr_t nEnd = (uintptr_t)m.dataend;
+    uintptr_t nFirstPage = nStart & ~(uintptr_t)(nPageSize - 1);
+    uintptr_t nLastPage = (nEnd - 1) & ~(uintptr_t)(nPageSize - 1);
+    vPages.push_back(make_pair(nFirstPage, (size_t)((nLastPage - nFirstPage) / nPageSize + 1)));
+}
+
+uint64_t ofxOpenFaceModelResidency::getResidentPages(const View& view) {
+#if defined(TARGET_WIN32)
+    return view.nPages;
+#else
+    uint64_t nResident = 0;
+#if defined(TARGET_OSX)
+    vector<char> vResident;
+#else
+    vector<unsigned char> vResident;
+#endif
+    for (auto& run : view.vPages) {
+        vResident.resize(run.second);
+        if (mincore((void*)run.first, run.second * nPageSize, vResident.data()) != 0) {
+            continue;
+        }
+        for (auto c : vResident) {
+            nResident += (c & 1) ? 1 : 0;
+        }
+    }
+    return nResident;
+#endif
+}
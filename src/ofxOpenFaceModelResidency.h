@@ -0,0 +1,57 @@
+#include "ofMain.h"
+#include "LandmarkCoreIncludes.h"
+#include <atomic>
+
+#pragma once
+
+// Keeps track of which patch experts (per scale and view) of a landmark model the faces use, and how much of them is in memory.
+// With a model bundle the experts are read from disk page by page the first time a face needs them, so a frontal camera never
+// reads the profile views. The experts of a scale and view that no face used for a while can be handed back to the OS,
+// they are read again from the bundle when a face turns that way; on macOS that only marks them first to go under memory pressure.
+// Models read from text files are only measured.
+// Only the experts of the main model are tracked, not those of its hierarchical parts.
+class ofxOpenFaceModelResidency {
+public:
+    struct Stats {
+        uint64_t    nTotalBytes = 0; // of all the patch experts, in whole pages
+        uint64_t    nResidentBytes = 0; // of them in memory
+        int         nViews = 0; // scale and view pairs
+        int         nViewsUsed = 0; // used by a face within the idle time (or ever, without eviction)
+        uint64_t    nEvictions = 0; // scale and view pairs handed back
+        uint64_t    nEvictedBytes = 0; // of them, out of memory right after, by mincore(). Advisory on macOS, little or nothing.
+        bool        bMapped = false; // the model comes from a bundle, its experts can be evicted
+        string toString() const;
+    };
+
+    ~ofxOpenFaceModelResidency();
+    void setup(const LandmarkDetector::CLNF& model);
+    // Experts unused for nIdleMs are evicted, 0 to keep everything once read
+    void setIdleTime(uint64_t nIdleMs);
+    // After a face model was fitted with params, thread safe
+    void touch(const LandmarkDetector::CLNF& faceModel, const LandmarkDetector::FaceModelParameters& params);
+    // Evicts what went unused for the idle time, at most once per second however often it is called
+    void evictIdle();
+    Stats getStats() const;
+
+private:
+    struct View {
+        int                         nScale = 0;
+        int                         nView = 0;
+        vector<pair<uintptr_t, size_t>> vPages; // runs of pages: first page address, number of pages
+        uint64_t                    nPages = 0;
+    };
+
+    static void addPages(const cv::Mat& m, vector<pair<uintptr_t, size_t>>& vPages);
+    static uint64_t getResidentPages(const View& view);
+
+    const LandmarkDetector::Patch_experts*  pExperts = nullptr;
+    vector<View>                            vViews;
+    vector<vector<int>>                     vViewIndices; // scale, view -> index in vViews
+    std::atomic<uint64_t>*                  pLastUsedMs = nullptr; // per view, 0 for never or evicted
+    uint64_t                                nIdleMs = 0;
+    std::atomic<uint64_t>                   nLastEvictionMs{0};
+    std::atomic<uint64_t>                   nEvictions{0};
+    std::atomic<uint64_t>                   nEvictedBytes{0};
+    bool                                    bMapped = false;
+    static uint64_t                         nPageSize;
+};
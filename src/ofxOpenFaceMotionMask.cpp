@@ -0,0 +1,97 @@
+#include "ofxOpenFaceMotionMask.h"
+
+void ofxOpenFaceMotionMask::setup(int nWidth, int nHeight, int nTileSizePx, float fThresholdValue) {
+    nTileSizePx = MAX(THUMB_PER_TILE, nTileSizePx);
+    fThreshold = fThresholdValue;
+    sizeTiles = cv::Size((nWidth + nTileSizePx - 1) / nTileSizePx, (nHeight + nTileSizePx - 1) / nTileSizePx);
+    sizeThumb = cv::Size(sizeTiles.width * THUMB_PER_TILE, sizeTiles.height * THUMB_PER_TILE);
+    tiles = Tiles();
+    tiles.fTileWidth = nWidth / (float)sizeTiles.width;
+    tiles.fTileHeight = nHeight / (float)sizeTiles.height;
+    tiles.mask.release();
+    tilesSinceDetection = tiles;
+    matThumbPrevious.release();
+}
+
+const ofxOpenFaceMotionMask::Tiles& ofxOpenFaceMotionMask::update(const cv::Mat& rgb) {
+    // Shrink first, convert after: only the thumbnail gets converted to grayscale
+    cv::resize(rgb, matThumbColor, sizeThumb, 0, 0, cv::INTER_AREA);
+    ofxCv::copyGray(matThumbColor, matThumb);
+
+    // A new mask for every frame, the tiles handed out before stay as they were
+    tiles.mask.release();
+    if (matThumbPrevious.size() != matThumb.size()) {
+        tiles.mask = cv::Mat(sizeTiles, CV_8U, cv::Scalar(255));
+        tiles.fMotion = 255.0f;
+        tiles.fMovingFraction = 1.0f;
+    } else {
+        cv::absdiff(matThumb, matThumbPrevious, matDiff);
+        tiles.fMotion = cv::mean(matDiff)[0];
+        // Averages exactly THUMB_PER_TILE x THUMB_PER_TILE pixels per tile
+        cv::resize(matDiff, matTileDiff, sizeTiles, 0, 0, cv::INTER_AREA);
+        cv::threshold(matTileDiff, tiles.mask, fThreshold, 255, cv::THRESH_BINARY);
+        tiles.fMovingFraction = cv::countNonZero(tiles.mask) / (float)tiles.mask.total();
+    }
+    cv::swap(matThumb, matThumbPrevious);
+
+    // A new mask here too, for the same reason
+    cv::Mat matSince;
+    if (tilesSinceDetection.mask.empty()) {
+        matSince = tiles.mask.clone();
+        tilesSinceDetection.fMotion = tiles.fMotion;
+    } else {
+        cv::bitwise_or(tilesSinceDetection.mask, tiles.mask, matSince);
+        tilesSinceDetection.fMotion = MAX(tilesSinceDetection.fMotion, tiles.fMotion);
+    }
+    tilesSinceDetection.mask = matSince;
+    tilesSinceDetection.fMovingFraction = cv::countNonZero(matSince) / (float)matSince.total();
+    return tiles;
+}
+
+const ofxOpenFaceMotionMask::Tiles& ofxOpenFaceMotionMask::getTiles() const {
+    return tiles;
+}
+
+const ofxOpenFaceMotionMask::Tiles& ofxOpenFaceMotionMask::getTilesSinceDetection() const {
+    return tilesSinceDetection;
+}
+
+void ofxOpenFaceMotionMask::clearSinceDetection() {
+    tilesSinceDetection.mask.release();
+    tilesSinceDetection.fMotion = 0.0f;
+    tilesSinceDetection.fMovingFraction = 0.0f;
+}
+
+bool ofxOpenFaceMotionMask::Tiles::isMoving(const cv::Rect_<float>& r) const {
+    if (mask.empty()) {
+        return true;
+    }
+    int x0 = ofClamp(floor(r.x / fTileWidth), 0, mask.cols - 1);
+    int y0 = ofClamp(floor(r.y / fTileHeight), 0, mask.rows - 1);
+    int x1 = ofClamp(ceil((r.x + r.width) / fTileWidth), x0 + 1, mask.cols);
+    int y1 = ofClamp(ceil((r.y + r.height) / fTileHeight), y0 + 1, mask.rows);
+    return cv::countNonZero(mask(cv::Rect(x0, y0, x1 - x0, y1 - y0))) > 0;
+}
+
+void ofxOpenFaceMotionMask::Tiles::getMovingRegions(vector<cv::Rect>& vRegions, int nMarginTiles) const {
+    vRegions.clear();
+    if (mask.empty()) {
+        return;
+    }
+    // Grow the moving tiles so that a face partly on static tiles stays whole, then take the groups of tiles
+    cv::Mat matGrown, matLabels, matStats, matCentroids;
+    if (nMarginTiles > 0) {
+        cv::dilate(mask, matGrown, cv::Mat(), cv::Point(-1, -1), nMarginTiles);
+    } else {
+        matGrown = mask;
+    }
+    int nLabels = cv::connectedComponentsWithStats(matGrown, matLabels, matStats, matCentroids, 8, CV_32S);
+    cv::Rect rFrame(0, 0, round(mask.cols * fTileWidth), round(mask.rows * fTileHeight));
+    for (int i = 1; i < nLabels; i++) { // 0 is the background
+        cv::Rect r(floor(matStats.at<int>(i, cv::CC_STAT_LEFT) * fTileWidth),
+                   floor(matStats.at<int>(i, cv::CC_STAT_TOP) * fTileHeight),
+                   ceil(matStats.at<int>(i, cv::CC_STAT_WIDTH) * fTileWidth),
+                   ceil(matStats.at<int>(i, cv::CC_STAT_HEIGHT) * fTileHeight));
+        vRegions.push_back(r & rFrame);
+    }
+}
@@ -0,0 +1,43 @@
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#pragma once
+
+// Cheap frame differencing on a downscaled copy of the frames, summarised as one moving/static flag per tile.
+// Besides the motion of each frame, it keeps the tiles that moved on any frame since the last face detection:
+// a face that walked in between two detections and stood still is still searched for at the next one.
+// Call update() with the frames in order, from one thread.
+class ofxOpenFaceMotionMask {
+public:
+    // The result for one frame, a small value that can travel with the frame
+    struct Tiles {
+        cv::Mat     mask; // CV_8U, one pixel per tile, 255 where it moved
+        float       fTileWidth = 1.0f; // tile size in frame pixels
+        float       fTileHeight = 1.0f;
+        float       fMotion = 0.0f; // mean absolute difference over the frame (0-255)
+        float       fMovingFraction = 1.0f; // share of moving tiles
+
+        bool isMoving(const cv::Rect_<float>& r) const; // any moving tile under r, r in frame pixels
+        void getMovingRegions(vector<cv::Rect>& vRegions, int nMarginTiles = 1) const; // bounding boxes of groups of moving tiles
+    };
+
+    void setup(int nWidth, int nHeight, int nTileSizePx = 32, float fThreshold = 6.0f);
+    const Tiles& update(const cv::Mat& rgb); // the first frame after setup() moves everywhere
+    const Tiles& getTiles() const;
+    const Tiles& getTilesSinceDetection() const; // every tile that moved since clearSinceDetection(), fMotion is the largest
+    void clearSinceDetection(); // after each detector run
+
+private:
+    static const int    THUMB_PER_TILE = 4; // thumbnail pixels per tile side
+
+    float       fThreshold = 6.0f; // mean difference of a tile above which it counts as moving
+    cv::Size    sizeTiles;
+    cv::Size    sizeThumb;
+    cv::Mat     matThumbColor;
+    cv::Mat     matThumb;
+    cv::Mat     matThumbPrevious;
+    cv::Mat     matDiff;
+    cv::Mat     matTileDiff;
+    Tiles       tiles;
+    Tiles       tilesSinceDetection;
+};
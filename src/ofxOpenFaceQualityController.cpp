@@ -0,0 +1,134 @@
+#include "ofxOpenFaceQualityController.h"
+
+constexpr float ofxOpenFaceQualityController::HEADROOM;
+
+string ofxOpenFaceQualityController::LevelToString(int nLevel) {
+    switch (nLevel) {
+        case 0:
+            return "Full quality";
+        case 1:
+            return "No multi-view initialisation";
+        case 2:
+            return "Fewer iterations";
+        case 3:
+            return "No hierarchical refinement";
+        case 4:
+            return "No coarsest scale";
+        case 5:
+            return "No validation";
+        default:
+            return "Unknown";
+    }
+}
+
+void ofxOpenFaceQualityController::apply(const LandmarkDetector::FaceModelParameters& paramsFull, int nLevel, LandmarkDetector::FaceModelParameters& params) {
+    params = paramsFull;
+    if (nLevel >= 1) {
+        params.multi_view = false;
+    }
+    if (nLevel >= 2) {
+        params.num_optimisation_iteration = MIN(paramsFull.num_optimisation_iteration, 3);
+    }
+    if (nLevel >= 3) {
+        params.refine_hierarchical = false;
+    }
+    if (nLevel >= 4) {
+        // The tracking windows go from the coarsest scale to the finest, a 0 skips a scale. Keep at least one.
+        int nScales = 0;
+        for (int nSize : params.window_sizes_small) {
+            nScales += nSize > 0 ? 1 : 0;
+        }
+        for (size_t i = 0; i < params.window_sizes_small.size() && nScales > 1; i++) {
+            if (params.window_sizes_small[i] > 0) {
+                params.window_sizes_small[i] = 0;
+                break;
+            }
+        }
+        params.window_sizes_current = params.window_sizes_small;
+    }
+    if (nLevel >= 5) {
+        params.validate_detections = false;
+    }
+}
+
+void ofxOpenFaceQualityController::setup(const LandmarkDetector::FaceModelParameters& paramsFullValue, int nSlots) {
+    paramsFull = paramsFullValue;
+    vLevels.assign(nSlots, 0);
+    fAverageMs = 0.0f;
+    nFramesSinceChange = 0;
+}
+
+void ofxOpenFaceQualityController::setTargetFrameMs(float fMs) {
+    fTargetMs = MAX(fMs, 0.0f);
+}
+
+float ofxOpenFaceQualityController::getTargetFrameMs() const {
+    return fTargetMs;
+}
+
+void ofxOpenFaceQualityController::update(float fFrameMs, const vector<tbb::atomic<bool>>& vActive, vector<LandmarkDetector::FaceModelParameters>& vParams) {
+    float fAverage = fAverageMs;
+    fAverage = fAverage > 0.0f ? fAverage * 0.8f + fFrameMs * 0.2f : fFrameMs;
+    fAverageMs = fAverage;
+    nFramesSinceChange++;
+    int nSlots = MIN(MIN(vLevels.size(), vActive.size()), vParams.size());
+
+    // Without a target, everyone goes back to full quality at once
+    float fTarget = fTargetMs;
+    if (fTarget <= 0.0f) {
+        for (int i = 0; i < nSlots; i++) {
+            if (vLevels[i] != 0) {
+                setLevel(i, 0, vParams);
+            }
+        }
+        return;
+    }
+    if (nFramesSinceChange < SETTLE_FRAMES) {
+        return;
+    }
+
+    // Late: the face at the best quality gives up a level. Early enough: the face at the worst quality gets one back.
+    int nSlotChanged = -1;
+    if (fAverage > fTarget) {
+        for (int i = 0; i < nSlots; i++) {
+            if (vActive[i] && vLevels[i] < LEVEL_COUNT - 1 && (nSlotChanged < 0 || vLevels[i] < vLevels[nSlotChanged])) {
+                nSlotChanged = i;
+            }
+        }
+        if (nSlotChanged >= 0) {
+            setLevel(nSlotChanged, vLevels[nSlotChanged] + 1, vParams);
+        }
+    } else if (fAverage < fTarget * HEADROOM) {
+        for (int i = 0; i < nSlots; i++) {
+            if (vLevels[i] > 0 && (nSlotChanged < 0 || vLevels[i] > vLevels[nSlotChanged])) {
+                nSlotChanged = i;
+            }
+        }
+        if (nSlotChanged >= 0) {
+            setLevel(nSlotChanged, vLevels[nSlotChanged] - 1, vParams);
+        }
+    }
+    if (nSlotChanged >= 0) {
+        nFramesSinceChange = 0;
+    }
+}
+
+void ofxOpenFaceQualityController::resetSlot(int nSlot, vector<LandmarkDetector::FaceModelParameters>& vParams) {
+    if (nSlot >= 0 && nSlot < (int)MIN(vLevels.size(), vParams.size()) && vLevels[nSlot] != 0) {
+        setLevel(nSlot, 0, vParams);
+    }
+}
+
+int ofxOpenFaceQualityController::getLevel(int nSlot) const {
+    return nSlot >= 0 && nSlot < (int)vLevels.size() ? vLevels[nSlot] : 0;
+}
+
+float ofxOpenFaceQualityController::getFrameMsAverage() const {
+    return fAverageMs;
+}
+
+void ofxOpenFaceQualityController::setLevel(int nSlot, int nLevel, vector<LandmarkDetector::FaceModelParameters>& vParams) {
+    vLevels[nSlot] = nLevel;
+    apply(paramsFull, nLevel, vParams[nSlot]);
+    ofLogVerbose("ofxOpenFace", "Face slot " + ofToString(nSlot + 1) + ": " + LevelToString(nLevel) + " (frames " + ofToString(fAverageMs.load(), 1) + " ms for " + ofToString(fTargetMs.load(), 1) + " ms)");
+}
@@ -0,0 +1,45 @@
+#include "ofMain.h"
+#include "LandmarkCoreIncludes.h"
+#include "tbb/atomic.h"
+#include <atomic>
+
+#pragma once
+
+// Holds a target frame time when the number of faces swings: while the frames take longer than the target, it lowers the fitting
+// quality of the faces one level of one face at a time, and raises it back the same way once there is headroom again.
+// Each level gives up a little more than the previous one, the cheapest losses first:
+// 1 no multi-view initialisation of new faces, 2 fewer optimisation iterations, 3 no hierarchical refinement (eyes...),
+// 4 no search at the coarsest tracking scale, 5 no validation of the fitted landmarks (lost faces are dropped later).
+class ofxOpenFaceQualityController {
+public:
+    static const int LEVEL_COUNT = 6; // 0 is full quality
+
+    static string LevelToString(int nLevel);
+    // params at level nLevel, from params at full quality
+    static void apply(const LandmarkDetector::FaceModelParameters& paramsFull, int nLevel, LandmarkDetector::FaceModelParameters& params);
+
+    // paramsFull: the parameters of every face at full quality
+    void setup(const LandmarkDetector::FaceModelParameters& paramsFull, int nSlots);
+    // 0 to keep full quality, the faces go back to it. Thread safe.
+    void setTargetFrameMs(float fMs);
+    float getTargetFrameMs() const;
+    // After each frame, before the next fitting: how long the frame took, which slots hold a face and their parameters
+    void update(float fFrameMs, const vector<tbb::atomic<bool>>& vActive, vector<LandmarkDetector::FaceModelParameters>& vParams);
+    // The face of nSlot is lost, the next face in the slot starts at full quality
+    void resetSlot(int nSlot, vector<LandmarkDetector::FaceModelParameters>& vParams);
+    int getLevel(int nSlot) const;
+    // Thread safe
+    float getFrameMsAverage() const;
+
+private:
+    static const int SETTLE_FRAMES = 5; // frames to wait after a change, before judging it
+    static constexpr float HEADROOM = 0.7f; // frames under that share of the target leave room for more quality
+
+    void setLevel(int nSlot, int nLevel, vector<LandmarkDetector::FaceModelParameters>& vParams);
+
+    LandmarkDetector::FaceModelParameters   paramsFull;
+    vector<int>                             vLevels; // per slot
+    std::atomic<float>                      fTargetMs{0.0f};
+    std::atomic<float>                      fAverageMs{0.0f}; // exponential moving average of the frame time
+    int                                     nFramesSinceChange = 0;
+};
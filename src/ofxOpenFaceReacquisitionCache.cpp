@@ -0,0 +1,169 @@
+#include "ofxOpenFaceReacquisitionCache.h"
+
+string ofxOpenFaceReacquisitionCache::Stats::toString() const {
+    return ofToString(getHitPercent(), 0) + "% re-acquired (" + ofToString(nHits) + " of " + ofToString(nLookups) + " new faces, "
+        + ofToString(nExpired) + " of " + ofToString(nStored) + " lost faces expired), " + ofToString(getHitMsMean(), 1) + " ms per re-acquisition, "
+        + ofToString(getMissMsMean(), 1) + " ms per initialisation";
+}
+
+void ofxOpenFaceReacquisitionCache::setup(int nSlots) {
+    vSlots.clear();
+    vSlots.resize(nSlots);
+    std::lock_guard<std::mutex> lock(mutex);
+    vLabels.assign(nSlots, -1);
+    vEntries.clear();
+}
+
+void ofxOpenFaceReacquisitionCache::setEnabled(bool bValue, int nLifetimeMsValue, float fMaxDistanceValue) {
+    std::lock_guard<std::mutex> lock(mutex);
+    nLifetimeMs = MAX(nLifetimeMsValue, 0);
+    fMaxDistance = MAX(fMaxDistanceValue, 0.0f);
+    bEnabled = bValue;
+    if (!bEnabled) {
+        vEntries.clear();
+    }
+}
+
+bool ofxOpenFaceReacquisitionCache::isEnabled() const {
+    return bEnabled;
+}
+
+void ofxOpenFaceReacquisitionCache::setLabels(const vector<ofxOpenFaceDataSingleFace>& vFaces, const vector<unsigned int>& vLabelsTracked) {
+    if (!bEnabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < MIN(MIN(vFaces.size(), vLabelsTracked.size()), vLabels.size()); i++) {
+        if (vFaces[i].detected) {
+            vLabels[i] = vLabelsTracked[i];
+        }
+    }
+}
+
+void ofxOpenFaceReacquisitionCache::remember(int nSlot, const LandmarkDetector::CLNF& model, const cv::Rect_<float>& rBox) {
+    if (!bEnabled || nSlot < 0 || nSlot >= (int)vSlots.size()) {
+        return;
+    }
+    Slot& slot = vSlots[nSlot];
+    slot.last.rotation = cv::Vec3f(model.params_global[1], model.params_global[2], model.params_global[3]);
+    model.params_local.copyTo(slot.last.localParams);
+    slot.last.rBox = rBox;
+    slot.last.face_template = model.face_template;
+    slot.bHasShape = true;
+}
+
+void ofxOpenFaceReacquisitionCache::store(int nSlot, uint64_t nNowMs) {
+    if (nSlot < 0 || nSlot >= (int)vSlots.size()) {
+        return;
+    }
+    Slot& slot = vSlots[nSlot];
+    bool bHasShape = slot.bHasShape;
+    slot.bHasShape = false;
+    std::lock_guard<std::mutex> lock(mutex);
+    int nLabel = vLabels[nSlot];
+    vLabels[nSlot] = -1;
+    if (!bEnabled || !bHasShape || nLabel < 0) {
+        return;
+    }
+
+    // One entry per label, the latest loss
+    expire(nNowMs);
+    for (size_t i = 0; i < vEntries.size(); i++) {
+        if (vEntries[i].nLabel == nLabel) {
+            vEntries.erase(vEntries.begin() + i);
+            break;
+        }
+    }
+    vEntries.push_back(slot.last);
+    vEntries.back().nLabel = nLabel;
+    vEntries.back().nLostMs = nNowMs;
+    slot.last = Entry(); // the template belongs to the entry now
+    nStored++;
+}
+
+bool ofxOpenFaceReacquisitionCache::restore(const cv::Rect_<float>& rDetection, uint64_t nNowMs, LandmarkDetector::CLNF& model) {
+    if (!bEnabled) {
+        return false;
+    }
+    nLookups++;
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        expire(nNowMs);
+
+        // The nearest lost face of about the same size
+        cv::Point2f ptDetection(rDetection.x + rDetection.width / 2.0f, rDetection.y + rDetection.height / 2.0f);
+        int nNearest = -1;
+        float fNearest = 0.0f;
+        for (int i = 0; i < (int)vEntries.size(); i++) {
+            const cv::Rect_<float>& r = vEntries[i].rBox;
+            float fScale = r.width > 0.0f ? rDetection.width / r.width : 0.0f;
+            float fDistance = cv::norm(ptDetection - cv::Point2f(r.x + r.width / 2.0f, r.y + r.height / 2.0f));
+            if (fScale >= 0.5f && fScale <= 2.0f && fDistance <= fMaxDistance * r.width && (nNearest < 0 || fDistance < fNearest)) {
+                nNearest = i;
+                fNearest = fDistance;
+            }
+        }
+        if (nNearest < 0) {
+            return false;
+        }
+        entry = vEntries[nNearest];
+        vEntries.erase(vEntries.begin() + nNearest);
+    }
+
+    // Its last good shape and head rotation, placed on the detection. The face template corrects the position at the first fit.
+    model.Reset();
+    if (entry.localParams.rows != model.params_local.rows) {
+        return false;
+    }
+    entry.localParams.copyTo(model.params_local);
+    model.pdm.CalcParams(model.params_global, rDetection, model.params_local, entry.rotation);
+    model.pdm.CalcShape2D(model.detected_landmarks, model.params_local, model.params_global);
+    model.face_template = entry.face_template;
+    model.tracking_initialised = true;
+    model.detection_success = true; // the small windows
+    nHits++;
+    return true;
+}
+
+void ofxOpenFaceReacquisitionCache::recordFit(bool bHit, float fMs) {
+    if (!bEnabled) {
+        return;
+    }
+    if (bHit) {
+        nHitUs += (uint64_t)(fMs * 1000.0f);
+    } else {
+        nMissUs += (uint64_t)(fMs * 1000.0f);
+    }
+}
+
+ofxOpenFaceReacquisitionCache::Stats ofxOpenFaceReacquisitionCache::getStats() const {
+    Stats stats;
+    stats.nLookups = nLookups;
+    stats.nHits = nHits;
+    stats.nStored = nStored;
+    stats.nExpired = nExpired;
+    stats.fHitMsSum = nHitUs / 1000.0;
+    stats.fMissMsSum = nMissUs / 1000.0;
+    return stats;
+}
+
+void ofxOpenFaceReacquisitionCache::resetStats() {
+    nLookups = 0;
+    nHits = 0;
+    nStored = 0;
+    nExpired = 0;
+    nHitUs = 0;
+    nMissUs = 0;
+}
+
+void ofxOpenFaceReacquisitionCache::expire(uint64_t nNowMs) {
+    for (size_t i = 0; i < vEntries.size();) {
+        if (nNowMs - vEntries[i].nLostMs > (uint64_t)nLifetimeMs) {
+            vEntries.erase(vEntries.begin() + i);
+            nExpired++;
+        } else {
+            i++;
+        }
+    }
+}
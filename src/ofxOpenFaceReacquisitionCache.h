@@ -0,0 +1,75 @@
+#include "ofMain.h"
+#include "LandmarkCoreIncludes.h"
+#include "ofxOpenFaceDataSingleFace.h"
+#include <atomic>
+#include <mutex>
+
+#pragma once
+
+// Remembers the last good shape of the faces lost a moment ago, by their tracker label: the rotation and non-rigid PDM parameters,
+// the bounding box and the face template. A new detection near one of them starts tracking from that shape with the small windows,
+// instead of a wide window initialisation from scratch, so people turning away or occluded for a moment are locked again sooner.
+// The slots are written by the fitting, the labels by the tracker's thread.
+class ofxOpenFaceReacquisitionCache {
+public:
+    struct Stats {
+        uint64_t    nLookups = 0; // new faces looked up
+        uint64_t    nHits = 0; // of them, re-acquired from a lost face
+        uint64_t    nStored = 0; // lost faces remembered
+        uint64_t    nExpired = 0; // of them, forgotten before coming back
+        double      fHitMsSum = 0.0; // landmark fits of the new faces, re-acquired ones
+        double      fMissMsSum = 0.0; // and initialised from scratch
+        float getHitPercent() const { return nLookups > 0 ? 100.0f * nHits / nLookups : 0.0f; }
+        float getHitMsMean() const { return nHits > 0 ? (float)(fHitMsSum / nHits) : 0.0f; }
+        float getMissMsMean() const { return nLookups > nHits ? (float)(fMissMsSum / (nLookups - nHits)) : 0.0f; }
+        string toString() const;
+    };
+
+    void setup(int nSlots);
+    // nLifetimeMs: how long a lost face is remembered. fMaxDistance: how far from it a detection may land, in face widths.
+    void setEnabled(bool bValue, int nLifetimeMs, float fMaxDistance);
+    bool isEnabled() const;
+    // The tracker's labels of the published faces, by slot. Only the detected faces count.
+    void setLabels(const vector<ofxOpenFaceDataSingleFace>& vFaces, const vector<unsigned int>& vLabels);
+    // After a successful fit of the face of nSlot, rBox around its landmarks
+    void remember(int nSlot, const LandmarkDetector::CLNF& model, const cv::Rect_<float>& rBox);
+    // The face of nSlot is lost: its last good shape is kept under its label
+    void store(int nSlot, uint64_t nNowMs);
+    // For a new face in rDetection: when a lost face was there, resets model to that face's shape placed on rDetection, ready to be
+    // tracked, and returns true. Leaves model alone otherwise.
+    bool restore(const cv::Rect_<float>& rDetection, uint64_t nNowMs, LandmarkDetector::CLNF& model);
+    // The landmark fit of a new face took fMs
+    void recordFit(bool bHit, float fMs);
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    struct Entry {
+        int                 nLabel = -1;
+        uint64_t            nLostMs = 0;
+        cv::Vec3f           rotation;
+        cv::Mat_<float>     localParams;
+        cv::Rect_<float>    rBox;
+        cv::Mat_<uchar>     face_template; // shared with the face model, which replaces it rather than writing into it
+    };
+    struct Slot {
+        bool    bHasShape = false;
+        Entry   last; // the last good shape
+    };
+
+    void expire(uint64_t nNowMs); // with the mutex locked
+
+    vector<Slot>                vSlots; // written by the fitting only
+    vector<int>                 vLabels; // by slot, -1 without one
+    vector<Entry>               vEntries; // the lost faces
+    std::mutex                  mutex; // of the labels and the lost faces
+    std::atomic<bool>           bEnabled{false};
+    int                         nLifetimeMs = 2000;
+    float                       fMaxDistance = 0.5f;
+    std::atomic<uint64_t>       nLookups{0};
+    std::atomic<uint64_t>       nHits{0};
+    std::atomic<uint64_t>       nStored{0};
+    std::atomic<uint64_t>       nExpired{0};
+    std::atomic<uint64_t>       nHitUs{0};
+    std::atomic<uint64_t>       nMissUs{0};
+};
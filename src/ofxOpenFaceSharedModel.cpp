@@ -0,0 +1,265 @@
+#include "ofxOpenFaceSharedModel.h"
+
+void ofxOpenFaceSharedModel::appendFaceModels(LandmarkDetector::CLNF& master, int nCount, vector<LandmarkDetector::CLNF>& vFaceModels) {
+    vFaceModels.reserve(vFaceModels.size() + nCount);
+
+    // Take the weights out of the master, so that copying it only copies the tracking state
+    Weights weights;
+    swapWeights(master, weights);
+    size_t nFirst = vFaceModels.size();
+    for (int i = 0; i < nCount; i++) {
+        vFaceModels.emplace_back(master);
+    }
+    swapWeights(master, weights);
+
+    // Point the copies to the master's weights
+    for (size_t i = nFirst; i < vFaceModels.size(); i++) {
+        shareWeights(master, vFaceModels[i]);
+    }
+}
+
+void ofxOpenFaceSharedModel::appendFaceModels(LandmarkDetector::CLNF& master, LandmarkDetector::CLNF& face, int nCount, vector<LandmarkDetector::CLNF>& vFaceModels) {
+    vFaceModels.reserve(vFaceModels.size() + nCount);
+
+    // The face model only holds references to the weights, but its copy constructor would clone them all the same
+    Weights weights;
+    swapWeights(face, weights);
+    size_t nFirst = vFaceModels.size();
+    for (int i = 0; i < nCount; i++) {
+        vFaceModels.emplace_back(face);
+    }
+    swapWeights(face, weights);
+
+    for (size_t i = nFirst; i < vFaceModels.size(); i++) {
+        vFaceModels[i].Reset();
+        shareWeights(master, vFaceModels[i], &face);
+    }
+}
+
+void ofxOpenFaceSharedModel::warmUp(LandmarkDetector::CLNF& master, const cv::Mat_<uchar>& gray, const cv::Rect_<float>& rFace, const LandmarkDetector::FaceModelParameters& params) {
+    // The fitting picks the view closest to the pose, starting at each view's own orientation reaches all of them
+    if (!master.patch_experts.centers.empty()) {
+        for (auto& center : master.patch_experts.centers[0]) {
+            fit(master, gray, rFace, cv::Vec3f(center[0], center[1], center[2]), params);
+        }
+    }
+    master.Reset();
+}
+
+void ofxOpenFaceSharedModel::warmUpFace(LandmarkDetector::CLNF& face, const cv::Mat_<uchar>& gray, const cv::Rect_<float>& rFace, const LandmarkDetector::FaceModelParameters& params) {
+    fit(face, gray, rFace, cv::Vec3f(0.0f, 0.0f, 0.0f), params);
+    face.Reset();
+}
+
+void ofxOpenFaceSharedModel::fit(LandmarkDetector::CLNF& model, const cv::Mat_<uchar>& gray, const cv::Rect_<float>& rFace, const cv::Vec3f& rotation, const LandmarkDetector::FaceModelParameters& params) {
+    // A new face uses the initial window sizes, a tracked one the small ones
+    LandmarkDetector::FaceModelParameters paramsFit = params;
+    for (auto& vWindowSizes : {params.window_sizes_init, params.window_sizes_small}) {
+        model.params_local.setTo(0.0f);
+        model.pdm.CalcParams(model.params_global, rFace, model.params_local, rotation);
+        paramsFit.window_sizes_current = vWindowSizes;
+        model.DetectLandmarks(gray, paramsFit);
+    }
+}
+
+void ofxOpenFaceSharedModel::shareCaches(const LandmarkDetector::CLNF& master, LandmarkDetector::CLNF& face) {
+    auto& svrMaster = master.patch_experts.svr_expert_intensity;
+    auto& svrFace = face.patch_experts.svr_expert_intensity;
+    for (size_t scale = 0; scale < MIN(svrMaster.size(), svrFace.size()); scale++) {
+        for (size_t view = 0; view < MIN(svrMaster[scale].size(), svrFace[scale].size()); view++) {
+            for (size_t landmark = 0; landmark < MIN(svrMaster[scale][view].size(), svrFace[scale][view].size()); landmark++) {
+                auto& vMaster = svrMaster[scale][view][landmark].svr_patch_experts;
+                auto& vFace = svrFace[scale][view][landmark].svr_patch_experts;
+                for (size_t i = 0; i < MIN(vMaster.size(), vFace.size()); i++) {
+                    vFace[i].weights_dfts = vMaster[i].weights_dfts;
+                }
+            }
+        }
+    }
+    auto& ccnfMaster = master.patch_experts.ccnf_expert_intensity;
+    auto& ccnfFace = face.patch_experts.ccnf_expert_intensity;
+    for (size_t scale = 0; scale < MIN(ccnfMaster.size(), ccnfFace.size()); scale++) {
+        for (size_t view = 0; view < MIN(ccnfMaster[scale].size(), ccnfFace[scale].size()); view++) {
+            for (size_t landmark = 0; landmark < MIN(ccnfMaster[scale][view].size(), ccnfFace[scale][view].size()); landmark++) {
+                auto& vMaster = ccnfMaster[scale][view][landmark].neurons;
+                auto& vFace = ccnfFace[scale][view][landmark].neurons;
+                for (size_t i = 0; i < MIN(vMaster.size(), vFace.size()); i++) {
+                    vFace[i].weights_dfts = vMaster[i].weights_dfts;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < MIN(master.hierarchical_models.size(), face.hierarchical_models.size()); i++) {
+        shareCaches(master.hierarchical_models[i], face.hierarchical_models[i]);
+    }
+}
+
+uint64_t ofxOpenFaceSharedModel::getWeightBytes(const LandmarkDetector::CLNF& model) {
+    uint64_t nBytes = getBytes(model.pdm.mean_shape) + getBytes(model.pdm.princ_comp) + getBytes(model.pdm.eigen_values);
+    for (auto& scale : model.patch_experts.svr_expert_intensity) {
+        for (auto& view : scale) {
+            for (auto& expert : view) {
+                for (auto& svr : expert.svr_patch_experts) {
+                    nBytes += getBytes(svr.weights);
+                }
+            }
+        }
+    }
+    for (auto& scale : model.patch_experts.ccnf_expert_intensity) {
+        for (auto& view : scale) {
+            for (auto& expert : view) {
+                for (auto& neuron : expert.neurons) {
+                    nBytes += getBytes(neuron.weights);
+                }
+                for (auto& sigma : expert.Sigmas) {
+                    nBytes += getBytes(sigma);
+                }
+                nBytes += getBytes(expert.weight_matrix);
+            }
+        }
+    }
+    for (auto& scale : model.patch_experts.cen_expert_intensity) {
+        for (auto& view : scale) {
+            for (auto& expert : view) {
+                for (size_t i = 0; i < expert.weights.size(); i++) {
+                    nBytes += getBytes(expert.weights[i]);
+                }
+                for (size_t i = 0; i < expert.biases.size(); i++) {
+                    nBytes += getBytes(expert.biases[i]);
+                }
+            }
+        }
+    }
+    const LandmarkDetector::DetectionValidator& validator = model.landmark_validator;
+    for (auto& view : validator.cnn_convolutional_layers) {
+        for (auto& layer : view) {
+            for (auto& input : layer) {
+                for (auto& kernel : input) {
+                    nBytes += getBytes(kernel);
+                }
+            }
+        }
+    }
+    for (auto& vLayers : {validator.cnn_convolutional_layers_weights, validator.cnn_fully_connected_layers_weights, validator.cnn_fully_connected_layers_biases}) {
+        for (auto& view : vLayers) {
+            for (auto& mat : view) {
+                nBytes += getBytes(mat);
+            }
+        }
+    }
+    for (size_t i = 0; i < validator.mean_images.size(); i++) {
+        nBytes += getBytes(validator.mean_images[i]) + getBytes(validator.standard_deviations[i]);
+    }
+    for (auto& part : model.hierarchical_models) {
+        nBytes += getWeightBytes(part);
+    }
+    return nBytes;
+}
+
+bool ofxOpenFaceSharedModel::hasDetectors(LandmarkDetector::CLNF& model) {
+    return !model.face_detector_MTCNN.empty() || model.face_detector_HOG.num_detectors() > 0;
+}
+
+uint64_t ofxOpenFaceSharedModel::getBytes(const cv::Mat& mat) {
+    return mat.empty() ? 0 : (uint64_t)(mat.total() * mat.elemSize());
+}
+
+void ofxOpenFaceSharedModel::swapWeights(LandmarkDetector::CLNF& model, Weights& weights) {
+    model.patch_experts.svr_expert_intensity.swap(weights.svr_expert_intensity);
+    model.patch_experts.ccnf_expert_intensity.swap(weights.ccnf_expert_intensity);
+    model.patch_experts.cen_expert_intensity.swap(weights.cen_expert_intensity);
+    model.landmark_validator.cnn_convolutional_layers.swap(weights.cnn_convolutional_layers);
+    model.landmark_validator.cnn_convolutional_layers_weights.swap(weights.cnn_convolutional_layers_weights);
+    model.landmark_validator.cnn_fully_connected_layers_weights.swap(weights.cnn_fully_connected_layers_weights);
+    model.landmark_validator.cnn_fully_connected_layers_biases.swap(weights.cnn_fully_connected_layers_biases);
+    model.hierarchical_models.swap(weights.hierarchical_models);
+    std::swap(model.face_detector_HOG, weights.face_detector_HOG);
+
+    // The MTCNN copy constructor clones its networks, its implicit assignment only copies cv::Mat headers
+    LandmarkDetector::FaceDetectorMTCNN mtcnn;
+    mtcnn = model.face_detector_MTCNN;
+    model.face_detector_MTCNN = weights.face_detector_MTCNN;
+    weights.face_detector_MTCNN = mtcnn;
+}
+
+void ofxOpenFaceSharedModel::shareWeights(LandmarkDetector::CLNF& master, LandmarkDetector::CLNF& face, LandmarkDetector::CLNF* pSource) {
+    // Implicit assignments copy cv::Mat headers, the data stays with the master
+    face.pdm = master.pdm;
+    face.triangulations = master.triangulations;
+    shareWeights(master.patch_experts, face.patch_experts);
+    shareWeights(master.landmark_validator, face.landmark_validator);
+
+    // The hierarchical parts (eyes, inner face...) are landmark models of their own
+    face.hierarchical_models.clear();
+    face.hierarchical_models.reserve(master.hierarchical_models.size());
+    for (size_t i = 0; i < master.hierarchical_models.size(); i++) {
+        if (pSource != nullptr && i < pSource->hierarchical_models.size()) {
+            appendFaceModels(master.hierarchical_models[i], pSource->hierarchical_models[i], 1, face.hierarchical_models);
+        } else {
+            appendFaceModels(master.hierarchical_models[i], 1, face.hierarchical_models);
+        }
+    }
+}
+
+void ofxOpenFaceSharedModel::shareWeights(const LandmarkDetector::Patch_experts& master, LandmarkDetector::Patch_experts& face) {
+    shareExperts(master.svr_expert_intensity, face.svr_expert_intensity);
+    shareExperts(master.ccnf_expert_intensity, face.ccnf_expert_intensity);
+    shareExperts(master.cen_expert_intensity, face.cen_expert_intensity);
+    face.sigma_components = master.sigma_components;
+    // preallocated_im2col is written by every response computation, each face keeps its own
+}
+
+void ofxOpenFaceSharedModel::shareWeights(const LandmarkDetector::DetectionValidator& master, LandmarkDetector::DetectionValidator& face) {
+    face.cnn_convolutional_layers = master.cnn_convolutional_layers;
+    face.cnn_convolutional_layers_weights = master.cnn_convolutional_layers_weights;
+    face.cnn_fully_connected_layers_weights = master.cnn_fully_connected_layers_weights;
+    face.cnn_fully_connected_layers_biases = master.cnn_fully_connected_layers_biases;
+    face.mean_images = master.mean_images;
+    face.standard_deviations = master.standard_deviations;
+    // The piecewise affine warps and the im2col buffers are written by every check, each face keeps its own
+}
+
+void ofxOpenFaceSharedModel::shareWeights(const LandmarkDetector::CCNF_patch_expert& master, LandmarkDetector::CCNF_patch_expert& face) {
+    face.width = master.width;
+    face.height = master.height;
+    // Assigning the neurons one by one avoids their cloning copy constructor.
+    // Each face gets its own map of weight DFTs, starting with the ones the master computed so far.
+    face.neurons.resize(master.neurons.size());
+    for (size_t i = 0; i < master.neurons.size(); i++) {
+        face.neurons[i] = master.neurons[i];
+    }
+    face.window_sizes = master.window_sizes;
+    face.Sigmas = master.Sigmas;
+    face.betas = master.betas;
+    face.weight_matrix = master.weight_matrix;
+    face.patch_confidence = master.patch_confidence;
+}
+
+void ofxOpenFaceSharedModel::shareWeights(const LandmarkDetector::Multi_SVR_patch_expert& master, LandmarkDetector::Multi_SVR_patch_expert& face) {
+    face.width = master.width;
+    face.height = master.height;
+    face.svr_patch_experts.resize(master.svr_patch_experts.size());
+    for (size_t i = 0; i < master.svr_patch_experts.size(); i++) {
+        face.svr_patch_experts[i] = master.svr_patch_experts[i];
+    }
+}
+
+void ofxOpenFaceSharedModel::shareWeights(const LandmarkDetector::CEN_patch_expert& master, LandmarkDetector::CEN_patch_expert& face) {
+    // Only cv::Mat and plain members
+    face = master;
+}
+
+template<class T>
+void ofxOpenFaceSharedModel::shareExperts(const vector<vector<vector<T>>>& master, vector<vector<vector<T>>>& face) {
+    // Experts are stored per scale, per view and per landmark
+    face.resize(master.size());
+    for (size_t scale = 0; scale < master.size(); scale++) {
+        face[scale].resize(master[scale].size());
+        for (size_t view = 0; view < master[scale].size(); view++) {
+            face[scale][view].resize(master[scale][view].size());
+            for (size_t landmark = 0; landmark < master[scale][view].size(); landmark++) {
+                shareWeights(master[scale][view][landmark], face[scale][view][landmark]);
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#include "ofMain.h"
+#include "LandmarkCoreIncludes.h"
+
+#pragma once
+
+// Builds per-face landmark models that share the read-only weights of one loaded master model.
+// Copying a LandmarkDetector::CLNF clones every patch expert, the validator CNN, the hierarchical models and the detectors.
+// The face models built here only own their tracking state (parameters, landmarks, template, caches, scratch buffers),
+// their weights point to the master's cv::Mat buffers, which OpenCV reference counts.
+class ofxOpenFaceSharedModel {
+public:
+    // Append nCount face models sharing the weights of master to vFaceModels.
+    // The face models get no face detectors, use them with FaceModelParameters::reinit_video_every <= 0.
+    // vFaceModels must not reallocate afterwards: copying a face model makes it own its weights again.
+    static void appendFaceModels(LandmarkDetector::CLNF& master, int nCount, vector<LandmarkDetector::CLNF>& vFaceModels);
+    // Same, copying face, one of master's face models, instead of master, which is left alone: its face detectors and hierarchical
+    // models stay in use meanwhile. The new face models start reset, with the scratch buffers face has built so far.
+    static void appendFaceModels(LandmarkDetector::CLNF& master, LandmarkDetector::CLNF& face, int nCount, vector<LandmarkDetector::CLNF>& vFaceModels);
+    // Fits master once at every view of its patch experts, with both window sizes of params, so that its experts build
+    // the caches they otherwise fill on the first frames (the DFTs of their weights). shareCaches() hands them to the face models.
+    // Setup only: it writes master's caches unsynchronised, nothing may append face models from master meanwhile.
+    static void warmUp(LandmarkDetector::CLNF& master, const cv::Mat_<uchar>& gray, const cv::Rect_<float>& rFace, const LandmarkDetector::FaceModelParameters& params);
+    // Fits a face model once with both window sizes, for the buffers each face model keeps (im2col, KDE responses), then resets it
+    static void warmUpFace(LandmarkDetector::CLNF& face, const cv::Mat_<uchar>& gray, const cv::Rect_<float>& rFace, const LandmarkDetector::FaceModelParameters& params);
+    // The face model's experts start from the caches of the master's, sharing their memory
+    static void shareCaches(const LandmarkDetector::CLNF& master, LandmarkDetector::CLNF& face);
+    // Bytes of the weights a copy of model would clone: patch experts, validator, PDM and hierarchical models (not the face detectors,
+    // whose networks are private). A face model built here shares them instead.
+    static uint64_t getWeightBytes(const LandmarkDetector::CLNF& model);
+    // Whether model carries HOG or MTCNN face detectors of its own, the face models built here must not
+    static bool hasDetectors(LandmarkDetector::CLNF& model);
+
+private:
+    // The heavy parts of a CLNF, moved out of the master while it is being copied
+    struct Weights {
+        vector<vector<vector<LandmarkDetector::Multi_SVR_patch_expert>>>  svr_expert_intensity;
+        vector<vector<vector<LandmarkDetector::CCNF_patch_expert>>>       ccnf_expert_intensity;
+        vector<vector<vector<LandmarkDetector::CEN_patch_expert>>>        cen_expert_intensity;
+        vector<vector<vector<vector<cv::Mat_<float>>>>>                   cnn_convolutional_layers;
+        vector<vector<cv::Mat_<float>>>                                   cnn_convolutional_layers_weights;
+        vector<vector<cv::Mat_<float>>>                                   cnn_fully_connected_layers_weights;
+        vector<vector<cv::Mat_<float>>>                                   cnn_fully_connected_layers_biases;
+        vector<LandmarkDetector::CLNF>                                    hierarchical_models;
+        dlib::frontal_face_detector                                       face_detector_HOG;
+        LandmarkDetector::FaceDetectorMTCNN                               face_detector_MTCNN;
+    };
+
+    static void fit(LandmarkDetector::CLNF& model, const cv::Mat_<uchar>& gray, const cv::Rect_<float>& rFace, const cv::Vec3f& rotation, const LandmarkDetector::FaceModelParameters& params);
+    static void swapWeights(LandmarkDetector::CLNF& model, Weights& weights);
+    static void shareWeights(LandmarkDetector::CLNF& master, LandmarkDetector::CLNF& face, LandmarkDetector::CLNF* pSource = nullptr);
+    static void shareWeights(const LandmarkDetector::Patch_experts& master, LandmarkDetector::Patch_experts& face);
+    static void shareWeights(const LandmarkDetector::DetectionValidator& master, LandmarkDetector::DetectionValidator& face);
+    static void shareWeights(const LandmarkDetector::CCNF_patch_expert& master, LandmarkDetector::CCNF_patch_expert& face);
+    static void shareWeights(const LandmarkDetector::Multi_SVR_patch_expert& master, LandmarkDetector::Multi_SVR_patch_expert& face);
+    static void shareWeights(const LandmarkDetector::CEN_patch_expert& master, LandmarkDetector::CEN_patch_expert& face);
+    template<class T> static void shareExperts(const vector<vector<vector<T>>>& master, vector<vector<vector<T>>>& face);
+    static uint64_t getBytes(const cv::Mat& mat);
+};
@@ -0,0 +1,49 @@
+#include "ofxOpenFaceStats.h"
+
+void ofxOpenFaceStats::record(Stage eStage, uint64_t nMicros) {
+    histograms[eStage].record(nMicros);
+}
+
+void ofxOpenFaceStats::recordSince(Stage eStage, uint64_t nTimeStartUs) {
+    uint64_t nTimeUs = ofGetElapsedTimeMicros();
+    histograms[eStage].record(nTimeUs > nTimeStartUs ? nTimeUs - nTimeStartUs : 0);
+}
+
+ofxOpenFaceStats::Snapshot ofxOpenFaceStats::getSnapshot() const {
+    Snapshot snapshot;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        snapshot.stages[i] = histograms[i].getSummary();
+    }
+    return snapshot;
+}
+
+void ofxOpenFaceStats::reset() {
+    for (auto& h : histograms) {
+        h.reset();
+    }
+}
+
+string ofxOpenFaceStats::StageToString(Stage eStage) {
+    switch (eStage) {
+        case STAGE_FRAME_WAIT: return "Frame wait";
+        case STAGE_GRAY: return "Grayscale";
+        case STAGE_DETECTION: return "Detection";
+        case STAGE_LANDMARKS: return "Landmarks";
+        case STAGE_GAZE: return "Gaze";
+        case STAGE_POSE: return "Pose";
+        case STAGE_TRACKER: return "Tracker";
+        case STAGE_EVENTS: return "Events";
+        case STAGE_FRAME: return "Frame";
+        default: return "Unknown";
+    }
+}
+
+string ofxOpenFaceStats::Snapshot::toString() const {
+    string s;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const ofxOpenFaceHistogram::Summary& h = stages[i];
+        s += StageToString((Stage)i) + ": " + ofToString(h.nCount) + " x, p50 " + ofToString(h.fP50Ms, 2) + " ms, p95 " + ofToString(h.fP95Ms, 2)
+            + " ms, p99 " + ofToString(h.fP99Ms, 2) + " ms, max " + ofToString(h.fMaxMs, 2) + " ms\n";
+    }
+    return s;
+}
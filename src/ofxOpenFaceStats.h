@@ -0,0 +1,37 @@
+#include "ofMain.h"
+#include "ofxOpenFaceHistogram.h"
+
+#pragma once
+
+// Wall clock timings of the processing stages of one ofxOpenFace, one histogram per stage
+class ofxOpenFaceStats {
+public:
+    enum Stage {
+        STAGE_FRAME_WAIT = 0, // from setImage() to the worker picking the frame up
+        STAGE_GRAY, // grayscale conversion
+        STAGE_DETECTION, // one face detector run, on whichever thread it ran
+        STAGE_LANDMARKS, // one DetectLandmarksInVideo() call, per face
+        STAGE_GAZE, // eye landmarks and both gaze estimates, per face
+        STAGE_POSE, // head pose, per face
+        STAGE_TRACKER, // tracker update
+        STAGE_EVENTS, // event dispatch, including the listeners
+        STAGE_FRAME, // from setImage() to the end of the events
+        STAGE_COUNT
+    };
+
+    struct Snapshot {
+        ofxOpenFaceHistogram::Summary   stages[STAGE_COUNT];
+        const ofxOpenFaceHistogram::Summary& operator[](Stage eStage) const { return stages[eStage]; }
+        string toString() const; // one line per stage
+    };
+
+    void record(Stage eStage, uint64_t nMicros); // lock-free, from any thread
+    void recordSince(Stage eStage, uint64_t nTimeStartUs); // record the time since nTimeStartUs, in ofGetElapsedTimeMicros() time
+    Snapshot getSnapshot() const;
+    void reset();
+
+    static string StageToString(Stage eStage);
+
+private:
+    ofxOpenFaceHistogram    histograms[STAGE_COUNT];
+};
@@ -0,0 +1,105 @@
+#include "ofxOpenFaceTrace.h"
+
+ofxOpenFaceTrace::Scope::Scope(ofxOpenFaceTrace& trace, const char* pNameValue, uint64_t nFrameNumberValue, int nSlotValue) {
+    pTrace = trace.isEnabled() ? &trace : nullptr;
+    pName = pNameValue;
+    nFrameNumber = nFrameNumberValue;
+    nSlot = nSlotValue;
+    nStartUs = pTrace != nullptr ? ofGetElapsedTimeMicros() : 0;
+}
+
+ofxOpenFaceTrace::Scope::~Scope() {
+    if (pTrace != nullptr) {
+        pTrace->record(pName, nStartUs, ofGetElapsedTimeMicros(), nFrameNumber, nSlot);
+    }
+}
+
+ofxOpenFaceTrace::~ofxOpenFaceTrace() {
+    delete[] pEntries;
+}
+
+void ofxOpenFaceTrace::setEnabled(bool bValue, int nCapacityValue) {
+    if (bValue && pEntries == nullptr) {
+        nCapacity = MAX(nCapacityValue, 1);
+        pEntries = new Entry[nCapacity];
+        ofLogNotice("ofxOpenFace", "Tracing up to " + ofToString(nCapacity) + " spans.");
+    }
+    // The buffer is in place before anyone sees the flag
+    bEnabled.store(bValue, std::memory_order_release);
+}
+
+bool ofxOpenFaceTrace::isEnabled() const {
+    return bEnabled.load(std::memory_order_acquire);
+}
+
+void ofxOpenFaceTrace::record(const char* pName, uint64_t nStartUs, uint64_t nEndUs, uint64_t nFrameNumber, int nSlot) {
+    if (!isEnabled()) {
+        return;
+    }
+    uint64_t nIndex = nNext.fetch_add(1, std::memory_order_relaxed);
+    Entry& e = pEntries[nIndex % nCapacity];
+    // Readers skip the entry until it is complete again
+    e.nSequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.span.pName = pName;
+    e.span.nStartUs = nStartUs;
+    e.span.nDurationUs = nEndUs > nStartUs ? nEndUs - nStartUs : 0;
+    e.span.nFrameNumber = nFrameNumber;
+    e.span.nSlot = nSlot;
+    e.span.nThread = getThreadIndex();
+    e.nSequence.store(nIndex + 1, std::memory_order_release);
+}
+
+void ofxOpenFaceTrace::getSpans(vector<Span>& vSpans) const {
+    vSpans.clear();
+    if (pEntries == nullptr) {
+        return;
+    }
+    uint64_t nEnd = nNext.load(std::memory_order_acquire);
+    uint64_t nStart = MAX(nFirst.load(), nEnd > (uint64_t)nCapacity ? nEnd - nCapacity : 0);
+    vSpans.reserve(nEnd - nStart);
+    for (uint64_t i = nStart; i < nEnd; i++) {
+        const Entry& e = pEntries[i % nCapacity];
+        if (e.nSequence.load(std::memory_order_acquire) != i + 1) {
+            continue;
+        }
+        Span span = e.span;
+        // Overwritten while we copied it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.nSequence.load(std::memory_order_relaxed) != i + 1) {
+            continue;
+        }
+        vSpans.push_back(span);
+    }
+}
+
+bool ofxOpenFaceTrace::save(const string& sPath, const string& sProcessName) const {
+    vector<Span> vSpans;
+    getSpans(vSpans);
+
+    ofstream file(ofToDataPath(sPath, true));
+    if (!file.is_open()) {
+        ofLogError("ofxOpenFace", "Could not write the trace to " + sPath);
+        return false;
+    }
+    // Complete events ("X"), one per span. The frame and the face slot show up in the arguments of each span.
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" << sProcessName << "\"}}";
+    for (auto& s : vSpans) {
+        file << ",\n{\"name\":\"" << s.pName << "\",\"cat\":\"ofxOpenFace\",\"ph\":\"X\",\"pid\":1,\"tid\":" << s.nThread
+             << ",\"ts\":" << s.nStartUs << ",\"dur\":" << s.nDurationUs << ",\"args\":{\"frame\":" << s.nFrameNumber << ",\"slot\":" << s.nSlot << "}}";
+    }
+    file << "\n]}\n";
+    ofLogNotice("ofxOpenFace", "Saved " + ofToString(vSpans.size()) + " spans to " + sPath);
+    return true;
+}
+
+void ofxOpenFaceTrace::clear() {
+    nFirst = nNext.load(std::memory_order_acquire);
+}
+
+int ofxOpenFaceTrace::getThreadIndex() {
+    static std::atomic<int> nThreads{0};
+    thread_local int nIndex = ++nThreads;
+    return nIndex;
+}
@@ -0,0 +1,55 @@
+#include "ofMain.h"
+#include <atomic>
+
+#pragma once
+
+// Records timed spans of the processing stages into a preallocated ring buffer and saves them as Chrome trace JSON,
+// to be opened in chrome://tracing or ui.perfetto.dev. Recording is lock-free and allocates nothing, from any thread.
+// When the buffer is full the oldest spans are overwritten.
+class ofxOpenFaceTrace {
+public:
+    struct Span {
+        const char*     pName = nullptr; // a string literal, only the pointer is kept
+        uint64_t        nStartUs = 0; // in ofGetElapsedTimeMicros() time
+        uint64_t        nDurationUs = 0;
+        uint64_t        nFrameNumber = 0; // 0 when not tied to a frame
+        int             nSlot = -1; // the face slot, -1 for the whole frame
+        int             nThread = 0; // see getThreadIndex()
+    };
+
+    // Times the scope it lives in, nothing is done when tracing is off
+    class Scope {
+    public:
+        Scope(ofxOpenFaceTrace& trace, const char* pName, uint64_t nFrameNumber, int nSlot = -1);
+        ~Scope();
+    private:
+        ofxOpenFaceTrace*   pTrace;
+        const char*         pName;
+        uint64_t            nFrameNumber;
+        int                 nSlot;
+        uint64_t            nStartUs;
+    };
+
+    ~ofxOpenFaceTrace();
+    // The buffer is allocated the first time tracing is turned on, nCapacity is ignored after that
+    void setEnabled(bool bValue, int nCapacity = 65536);
+    bool isEnabled() const;
+    void record(const char* pName, uint64_t nStartUs, uint64_t nEndUs, uint64_t nFrameNumber, int nSlot = -1);
+    void getSpans(vector<Span>& vSpans) const; // oldest first, spans being written are left out
+    bool save(const string& sPath, const string& sProcessName = "ofxOpenFace") const;
+    void clear();
+
+    static int getThreadIndex(); // a small number per thread, in the order the threads first recorded
+
+private:
+    struct Entry {
+        std::atomic<uint64_t>   nSequence{0}; // 1 + the index of the span held, 0 while written
+        Span                    span;
+    };
+
+    Entry*                      pEntries = nullptr;
+    int                         nCapacity = 0;
+    std::atomic<bool>           bEnabled{false};
+    std::atomic<uint64_t>       nNext{0};
+    std::atomic<uint64_t>       nFirst{0}; // spans before this one were cleared
+};